@@ -15,6 +15,8 @@
  */
 
 #include "HmdpEngine.h"
+#include "Metrics.h"
+#include "BspTreeStore.h"
 
 /* parser structures */
 #include "states.h"
@@ -36,19 +38,34 @@ using namespace ppddl_parser;
 DEFINE_string(ppddl_file,"model.ppddl","PPDDL model input file");
 DEFINE_string(output_prefix,"","Prefix of output files, prefix+model.dat, ...");
 DEFINE_bool(with_convol,false,"Uses convolutions to compute the reachable continuous space within every discrete state (slower)");
-DEFINE_string(vf_output_formats,"dat","Comma-separated list of value function output formats, from 'dat' (default, point-based from the dynamically discretized vf), 'mat' (Matlab, point-based), 'vrml' and 'box' (1D or 2D only, tile-based output for gnuplot)");
+DEFINE_string(vf_output_formats,"dat","Comma-separated list of value function output formats, from 'dat' (default, point-based from the dynamically discretized vf), 'mat' (Matlab, point-based), 'bin' (binary, point-based, header and array of doubles), 'vrml' and 'box' (1D or 2D only, tile-based output for gnuplot)");
 DEFINE_double(prec,1e-20,"Numerical precision (below which tiles are merged), default is 1e-20");
 DEFINE_bool(output_first_state_only,true,"Outputs the value function of the initial state only (default is true)");
 DEFINE_bool(show_discrete_states,false,"Whether to output the discrete state value for every state (default is false)");
 DEFINE_string(point_based_output_step,"","Comma-separated list of stepsizes for point-based discretized output of value functions in dat and mat format (default is 1.0 in every dimension)");
 DEFINE_bool(print_world,false,"Prints full MDP world loaded from PPDDL (default is false)");
 DEFINE_bool(truncate_negative_ct_outcomes,false,"Truncates the negative part of continuous transition outcomes: this is useful when continuous spate-space models non-replenishable resources");
-DEFINE_string(algo,"dfs","Algorithm for value function approximation among dfs (default, depth-first search for finite-horizon and resource problems), vi (value iteration), psvi (prioritized sweeping value iteration)");
-DEFINE_int32(T,-1,"Horizon for value iteration (-1 for infinite is default)");
+DEFINE_string(algo,"dfs","Algorithm for value function approximation among dfs (default, depth-first search for finite-horizon and resource problems), vi (value iteration), psvi (prioritized sweeping value iteration), tvi (topological value iteration, over the strongly connected components of the state graph), hao (heuristic search, over the states reached by the greedy policy)");
+DEFINE_int32(T,-1,"Horizon for value iteration, or maximum number of sweeps of a cyclic component with tvi (-1 for infinite is default)");
 DEFINE_bool(one_time_reward,false,"Whether reward can only be reaped once (can be part of the model, here to simplify testing and modeling");
 DEFINE_double(gamma,1.0,"Discount factor");
 DEFINE_double(vi_epsilon,1e-3,"Precision on value iteration convergence");
-DEFINE_int32(max_dfs_recur,-1,"Maximum number of depth first search recursive calls in the discrete state-space (useful when discovering states of an infinite-horizon problem before applying value iteration");
+DEFINE_int32(max_dfs_recur,-1,"Maximum number of states visited by the depth first search in the discrete state-space with dfs, and maximum number of discovered states with vi, psvi and tvi, if max_states is not set");
+DEFINE_int32(max_depth,-1,"Maximum number of steps from the initial state when discovering states with dfs, or before vi, psvi and tvi (-1 for unlimited is default)");
+DEFINE_int64(max_states,-1,"Maximum number of states discovered with dfs, or before vi, psvi and tvi (-1 for unlimited is default)");
+DEFINE_int64(max_memory_mb,0,"Maximum estimated memory of the states discovered with dfs, or before vi, psvi and tvi, in MB (0 for unlimited is default)");
+DEFINE_int32(backup_threads,1,"Number of threads for backing up actions and their outcomes concurrently within a state backup (default is 1, sequential)");
+DEFINE_int32(vi_threads,1,"Number of threads for backing up states concurrently within value iteration sweeps (vi), or popped from the priority queue (psvi), or components that do not depend on each other (tvi) (default is 1, sequential)");
+DEFINE_int32(output_threads,1,"Number of threads for filling and formatting point-based value function outputs (default is 1)");
+DEFINE_string(vi_mode,"gauss-seidel","Value iteration sweeps, among gauss-seidel (default, backups use the latest value functions) and jacobi (backups use the previous sweep value functions)");
+DEFINE_double(hao_min_mass,1e-3,"Probability mass over resources under which a state reached by the greedy policy is not expanded, with hao (default is 1e-3)");
+DEFINE_double(hao_heuristic,-1.0,"Upper bound on the value of any state, used as heuristic with hao (default is -1, computed from the goals rewards if discounted or with one-time rewards)");
+DEFINE_string(metrics_out,"","Output file of solver metrics snapshots: time per phase, counters, value function sizes and allocation volume (default is empty, no metrics)");
+DEFINE_string(metrics_format,"json","Format of the metrics snapshots, among json (default, one object per line) and csv");
+DEFINE_double(metrics_interval,1.0,"Seconds between metrics snapshots, 0 for a final snapshot only (default is 1.0)");
+DEFINE_bool(hash_consing,false,"Stores identical subtrees of the states value functions and q-values once, shared with reference counts, with values equal up to the numerical tolerance (default is false)");
+DEFINE_bool(masked_backups,false,"Computes the value function of a state only where its distribution over resources has mass, with dfs and with_convol, and with tvi: distributions are propagated over the discovered states first, states in or after a cycle are not masked (default is false)");
+DEFINE_bool(bound_pruning,true,"Keeps lower and upper bounds on the values of the subtrees of value functions, and skips the parts of the max over actions where a q-value dominates the others (default is true)");
 
 std::vector<std::string> &split(const std::string &s, char delim, std::vector<std::string> &elems) {
   std::stringstream ss(s);
@@ -76,6 +93,7 @@ int main (int argc, char *argv[])
   /*
    * Read pddl file and convert to hmdp structures.
    */
+  BspTreeOperations::m_asymetricOperators = FLAGS_bound_pruning;  /* before rewards are loaded. */
   HmdpWorld::loadWorld (FLAGS_ppddl_file.c_str());
 
   /* visualize results */
@@ -88,23 +106,66 @@ int main (int argc, char *argv[])
   BspTreeOperations::m_piecesMergingByAction = false;
   BspTreeOperations::m_piecesMergingEquality = true;
   BspTreeOperations::m_bspBalance = false;
+  BspTreeStore::enable (FLAGS_hash_consing);
+  HmdpEngine::setBackupThreads (FLAGS_backup_threads);
+  HmdpEngine::setValueIterationThreads (FLAGS_vi_threads);
+  HmdpEngine::setMaskedBackups (FLAGS_masked_backups);
   
+  DiscoveryLimits limits;
+  limits.m_maxDepth = FLAGS_max_depth;
+  limits.m_maxStates = FLAGS_max_states;
+  if (limits.m_maxStates < 0 && FLAGS_max_dfs_recur != -1)
+    limits.m_maxStates = FLAGS_max_dfs_recur;
+  limits.m_maxMemory = static_cast<size_t> (FLAGS_max_memory_mb) * 1024 * 1024;
+
+  if (!FLAGS_metrics_out.empty())
+    {
+      MetricsFormat metrics_format = METRICS_JSON;
+      if (FLAGS_metrics_format == "csv")
+	metrics_format = METRICS_CSV;
+      else if (FLAGS_metrics_format != "json")
+	{
+	  std::cout << "Error: unknown metrics format " << FLAGS_metrics_format << ". Exiting\n";
+	  exit(1);
+	}
+      if (!Metrics::startOutput(FLAGS_metrics_out,metrics_format,FLAGS_metrics_interval))
+	exit(1);
+    }
+
   clock_t backup_start, backup_stop;
   backup_start = clock ();
   if (FLAGS_algo == "dfs")
     {
       HmdpEngine::DepthFirstSearchBackupCSD (HmdpWorld::getFirstInitialState (),true,FLAGS_with_convol,
-					     false,FLAGS_max_dfs_recur);
+					     false,limits);
     }
   else if (FLAGS_algo == "vi")
     {
+      ValueIterationMode vi_mode = VI_GAUSS_SEIDEL;
+      if (FLAGS_vi_mode == "jacobi")
+	vi_mode = VI_JACOBI;
+      else if (FLAGS_vi_mode != "gauss-seidel")
+	{
+	  std::cout << "Error: unknown value iteration mode " << FLAGS_vi_mode << ". Exiting\n";
+	  exit(1);
+	}
       HmdpEngine::ValueIteration(HmdpWorld::getFirstInitialState(),FLAGS_gamma,FLAGS_vi_epsilon,FLAGS_T,
-				 FLAGS_max_dfs_recur);
+				 limits,vi_mode);
     }
   else if (FLAGS_algo == "psvi")
     {
       HmdpEngine::prioritizedValueIteration(HmdpWorld::getFirstInitialState(),FLAGS_gamma,FLAGS_vi_epsilon,
-					    FLAGS_T,FLAGS_max_dfs_recur);
+					    FLAGS_T,limits);
+    }
+  else if (FLAGS_algo == "tvi")
+    {
+      HmdpEngine::TopologicalValueIteration(HmdpWorld::getFirstInitialState(),FLAGS_gamma,FLAGS_vi_epsilon,
+					    FLAGS_T,limits);
+    }
+  else if (FLAGS_algo == "hao")
+    {
+      HmdpEngine::HeuristicSearch(HmdpWorld::getFirstInitialState(),FLAGS_gamma,FLAGS_vi_epsilon,
+				  FLAGS_T,FLAGS_hao_min_mass,FLAGS_hao_heuristic);
     }
   else
     {
@@ -112,6 +173,7 @@ int main (int argc, char *argv[])
       exit(1);
     }
   backup_stop = clock ();
+  Metrics::stopOutput ();
   double time = (double) (backup_stop - backup_start) / (double) (CLOCKS_PER_SEC);
   std::cout << "\nbackup ";
   if (FLAGS_with_convol)
@@ -119,6 +181,9 @@ int main (int argc, char *argv[])
   std::cout << "time: " << time << std::endl;
   std::cout << "expected value: " << HmdpWorld::getFirstInitialState()->getVF()->computeExpectation(HmdpWorld::getFirstInitialState()->getCSD(),HmdpWorld::getRscLowBounds(),HmdpWorld::getRscHighBounds()) << std::endl;
   std::cout << "total number of discrete states (dfs): " << HmdpEngine::getNStates () << std::endl;
+  if (FLAGS_hash_consing)
+    std::cout << "shared value function nodes: " << BspTreeStore::getNNodes ()
+	      << " (" << BspTreeStore::getNHits () << " interned nodes found in store)" << std::endl;
 
   // discretization for point based vf output (dat & mat).
   std::string output_file_head = FLAGS_output_prefix + FLAGS_ppddl_file;
@@ -138,11 +203,15 @@ int main (int argc, char *argv[])
 	}
     }
 
-  std::unordered_map<unsigned int,HmdpState*>::const_iterator it;
-  for (it = HmdpEngine::m_states.begin (); 
-       it != HmdpEngine::m_states.end (); it++)
+  ThreadPool *output_pool = NULL;
+  if (FLAGS_output_threads > 1)
+    output_pool = new ThreadPool (FLAGS_output_threads);
+
+  std::vector<HmdpState*> states;
+  HmdpEngine::m_stateGraph.getExpandedStates (states);
+  for (size_t s=0; s<states.size (); s++)
     {
-      HmdpState *hst = (*it).second;
+      HmdpState *hst = states[s];
       std::string numstr = std::to_string(hst->getStateIndex());
       std::string state_filename = FLAGS_output_prefix + FLAGS_ppddl_file + "_state_" + numstr;
 
@@ -171,7 +240,7 @@ int main (int argc, char *argv[])
 	      ofstream output_state0_values_gp (state_filename_dat.c_str(), ios::out);
 	      hst->getVF ()->plotNDPointValues (output_state0_values_gp, &step[0],
 						HmdpWorld::getRscLowBounds (),
-						HmdpWorld::getRscHighBounds ());
+						HmdpWorld::getRscHighBounds (), output_pool);
 	      std::cout << "written file " << state_filename_dat << std::endl;
 	    }
 	  
@@ -182,9 +251,20 @@ int main (int argc, char *argv[])
 	      ofstream output_state0_values_mat (state_filename_mat.c_str(), ios::out);
 	      hst->getVF ()->plotNDPointValues (output_state0_values_mat, &step[0],
 						HmdpWorld::getRscLowBounds (),
-						HmdpWorld::getRscHighBounds ());
+						HmdpWorld::getRscHighBounds (), output_pool);
 	      std::cout << "written file " << state_filename_mat << std::endl;
 	    }
+
+	  if (FLAGS_vf_output_formats.find("bin") != std::string::npos)
+	    {
+	      std::string state_filename_bin = state_filename + ".bin";
+	      BspTree::m_plotPointFormat = BinaryF;
+	      ofstream output_state0_values_bin (state_filename_bin.c_str(), ios::out | ios::binary);
+	      hst->getVF ()->plotNDPointValues (output_state0_values_bin, &step[0],
+						HmdpWorld::getRscLowBounds (),
+						HmdpWorld::getRscHighBounds (), output_pool);
+	      std::cout << "written file " << state_filename_bin << std::endl;
+	    }
 	  
 	  if (FLAGS_vf_output_formats.find("vrml") != std::string::npos)
 	    {
@@ -241,7 +321,7 @@ int main (int argc, char *argv[])
 		  ofstream output_state_values_mat (state_conv_fn_mat.c_str (), ios::out);
 		  hst->getCSD ()->plotNDPointValues (output_state_values_mat, &step[0],
 						     HmdpWorld::getRscLowBounds (),
-						     HmdpWorld::getRscHighBounds ());
+						     HmdpWorld::getRscHighBounds (), output_pool);
 		  std::cout << "written file " << state_conv_fn_mat << std::endl;
 		}
 	      
@@ -252,13 +332,25 @@ int main (int argc, char *argv[])
 		  ofstream output_state_values_dat (state_conv_fn_gp.c_str (), ios::out);
 		  hst->getCSD ()->plotNDPointValues (output_state_values_dat, &step[0],
 						     HmdpWorld::getRscLowBounds (),
-						     HmdpWorld::getRscHighBounds ());
+						     HmdpWorld::getRscHighBounds (), output_pool);
 		  std::cout << "written file " << state_conv_fn_gp << std::endl;
 		}
+
+	      if (FLAGS_vf_output_formats.find("bin") != std::string::npos)
+		{
+		  BspTree::m_plotPointFormat = BinaryF;
+		  std::string state_conv_fn_bin = output_file_head + "_state_" + numstr + "_csd.bin";
+		  ofstream output_state_values_bin (state_conv_fn_bin.c_str (), ios::out | ios::binary);
+		  hst->getCSD ()->plotNDPointValues (output_state_values_bin, &step[0],
+						     HmdpWorld::getRscLowBounds (),
+						     HmdpWorld::getRscHighBounds (), output_pool);
+		  std::cout << "written file " << state_conv_fn_bin << std::endl;
+		}
 	    }
 	}
 
       if (FLAGS_show_discrete_states)
 	hst->print (std::cout);
     }
+  delete output_pool;
 }
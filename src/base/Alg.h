@@ -20,6 +20,7 @@
 #include "config.h"
 #include <math.h>
 #include <vector>
+#include <functional>
 
 namespace hmdp_base
 {
@@ -66,6 +67,20 @@ class Alg
    */
   static bool eqVectorInt (const std::vector<int> &v1, const std::vector<int> &v2);
 
+  /* hashing */
+  /**
+   * \brief mixes a hash value into a hash.
+   */
+  static void hashCombine (size_t &h, const size_t &v)
+    { h ^= v + 0x9e3779b9 + (h << 6) + (h >> 2); }
+
+  /**
+   * \brief hash of a double rounded to a multiple of e, so that values that are
+   *        equal up to e mostly hash alike (values near a rounding boundary do not).
+   */
+  static size_t hashDouble (const double &x, const double &e)
+    { return std::hash<double> () (e > 0.0 ? floor (x / e + 0.5) : x); }
+
  protected:
  private:
   
@@ -28,13 +28,15 @@ namespace hmdp_base
 AlphaVector::AlphaVector (const int &size)
   : m_size (size)
 {
-  m_alpha = (double *) calloc (m_size, sizeof (double));
+  m_alpha = static_cast<double*> (MemoryPool::allocate (m_size * sizeof (double)));
+  for (int i=0; i<m_size; i++)
+    m_alpha[i] = 0.0;
 }
 
 AlphaVector::AlphaVector (const int &size, double alph[])
   : m_size (size)
 {
-  m_alpha = (double *) malloc (m_size * sizeof (double));
+  m_alpha = static_cast<double*> (MemoryPool::allocate (m_size * sizeof (double)));
   for (int i=0; i<m_size; i++)
     m_alpha[i] = alph[i];
 }
@@ -42,14 +44,14 @@ AlphaVector::AlphaVector (const int &size, double alph[])
 AlphaVector::AlphaVector (const double &val)
   : m_size (1)
 {
-  m_alpha = (double *) malloc (m_size * sizeof (double));
+  m_alpha = static_cast<double*> (MemoryPool::allocate (m_size * sizeof (double)));
   m_alpha[0] = val;
 }
 
 AlphaVector::AlphaVector (const AlphaVector &av)
   : m_size (av.getSize ()) 
 {
-  m_alpha = (double *) malloc (m_size * sizeof (double));
+  m_alpha = static_cast<double*> (MemoryPool::allocate (m_size * sizeof (double)));
   for (int i=0; i<m_size; i++)
     m_alpha[i] = av.getAlphaNth (i);
   if (av.m_actions.size ())
@@ -58,7 +60,7 @@ AlphaVector::AlphaVector (const AlphaVector &av)
 
 AlphaVector::~AlphaVector ()
 {
-  free (m_alpha);
+  MemoryPool::deallocate (m_alpha, m_size * sizeof (double));
 }
 
 void AlphaVector::simpleSumAlphaVectors (const std::vector<AlphaVector*> &vav1, const std::vector<AlphaVector*> &vav2, std::vector<AlphaVector*> *res)
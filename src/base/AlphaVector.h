@@ -18,6 +18,7 @@
 #define ALPHAVECTOR_H
 
 #include "config.h"
+#include "MemoryPool.h"
 #include <vector>
 #include <set>
 #include <ostream>
@@ -65,6 +66,13 @@ class AlphaVector
    */
   ~AlphaVector ();
 
+  /**
+   * \brief vectors and their elements are allocated from the memory pool.
+   * @sa MemoryPool
+   */
+  static void* operator new (size_t size) { return MemoryPool::allocate (size); }
+  static void operator delete (void *p, size_t size) { MemoryPool::deallocate (p, size); }
+
  protected:
  private:
 
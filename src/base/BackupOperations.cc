@@ -21,15 +21,14 @@ namespace hmdp_base
  
 ValueFunction* BackupOperations::selectCachedTree (const ValueFunction &vf, const ContinuousTransition &ct)
 {
-  BspTreeOperations::m_currentOutputType = vf.getType ();
-  if (BspTreeOperations::m_currentOutputType == PiecewiseConstantVFT)
+  if (vf.getType () == PiecewiseConstantVFT)
     return ct.getPtrPwcVF ();
-  else if (BspTreeOperations::m_currentOutputType == PiecewiseLinearVFT)
+  else if (vf.getType () == PiecewiseLinearVFT)
     return ct.getPtrPwlVF ();
   else 
     {
       std::cerr << "[Error]: BackupOperations::selectCachedTree: unknown tree type: " 
-		<< BspTreeOperations::m_currentOutputType << " -- return NULL vf...\n";
+		<< vf.getType () << " -- return NULL vf...\n";
       //exit (1);
       return NULL;
     }
@@ -38,31 +37,72 @@ ValueFunction* BackupOperations::selectCachedTree (const ValueFunction &vf, cons
 ValueFunction* BackupOperations::intersectCOWithVF (ValueFunction *vf, ContinuousOutcome *co,
 						    double *low, double *high)
 {
-  BspTreeOperations::m_currentIntersectionType = BTI_MULT;
-  BspTree *bt = BspTreeOperations::intersectTrees (vf, co, low, high);
+  return BackupOperations::intersectCOWithVF (BspOpContext (), vf, co, low, high);
+}
+
+ValueFunction* BackupOperations::intersectCOWithVF (const BspOpContext &ctx,
+						    ValueFunction *vf, ContinuousOutcome *co,
+						    double *low, double *high)
+{
+  BspOpContext mctx (ctx);
+  mctx.m_intersectionType = BTI_MULT;
+  BspTree *bt = BspTreeOperations::intersectTrees (mctx, vf, co, low, high);
   ValueFunction *res = static_cast<ValueFunction*> (bt);
-  if (BspTreeOperations::m_piecesMerging)
-    res->mergeTreeLeaves (low, high);
+  if (mctx.m_piecesMerging)
+    res->mergeTreeLeaves (mctx, low, high);
   return res;
 }
- 
+
 ValueFunction* BackupOperations::intersectVFWithReward (ValueFunction *vf, ContinuousReward *cr,
 							double *low, double *high)
 {
-  BspTreeOperations::m_currentIntersectionType = BTI_PLUS;
-  BspTree *bt = BspTreeOperations::intersectTrees (vf, cr, low, high);
+  return BackupOperations::intersectVFWithReward (BspOpContext (), vf, cr, low, high);
+}
+
+ValueFunction* BackupOperations::intersectVFWithReward (const BspOpContext &ctx,
+							ValueFunction *vf, ContinuousReward *cr,
+							double *low, double *high)
+{
+  BspOpContext pctx (ctx);
+  pctx.m_intersectionType = BTI_PLUS;
+  BspTree *bt = BspTreeOperations::intersectTrees (pctx, vf, cr, low, high);
   ValueFunction* res = static_cast<ValueFunction*> (bt);
-  if (BspTreeOperations::m_piecesMerging)
-    res->mergeTreeLeaves (low, high);
+  if (pctx.m_piecesMerging)
+    res->mergeTreeLeaves (pctx, low, high);
+  return res;
+}
+
+ValueFunction* BackupOperations::intersectVFWithReward (const BspOpContext &ctx,
+							ValueFunction *vf, ContinuousReward *cr,
+							double *low, double *high, const double &scale)
+{
+  if (scale == 1.0)
+    return BackupOperations::intersectVFWithReward (ctx, vf, cr, low, high);
+  
+  /* rewards are small trees, scale a copy of the reward instead of the value function. */
+  ContinuousReward *scr = static_cast<ContinuousReward*> (BspTreeOperations::copyTree (cr));
+  scr->multiplyByScalar (1.0 / scale);
+  ValueFunction *res = BackupOperations::intersectVFWithReward (ctx, vf, scr, low, high);
+  BspTree::deleteBspTree (scr);
   return res;
 }
 
 ValueFunction* BackupOperations::backUpCT (ValueFunction *vf, ContinuousTransition *ct, 
 					   double *low, double *high)
 {
+  return BackupOperations::backUpCT (BspOpContext (), vf, ct, low, high);
+}
+
+ValueFunction* BackupOperations::backUpCT (const BspOpContext &ctx,
+					   ValueFunction *vf, ContinuousTransition *ct, 
+					   double *low, double *high)
+{
+  BspOpContext pctx (ctx);
+  pctx.m_outputType = vf->getType ();
+  pctx.m_intersectionType = BTI_PLUS;
   ValueFunction *res = 0, *tres = 0, *tpart = 0;
   ValueFunction *tilePartition 
-    = static_cast<ValueFunction*> (BspTreeOperations::createTree (BackupOperations::selectCachedTree (*vf, *ct)));
+    = static_cast<ValueFunction*> (BspTreeOperations::createTree (pctx, BackupOperations::selectCachedTree (*vf, *ct)));
 
   for (int tiles=0; tiles<ct->getTilingDimension (); tiles++)  /* iterate the transition tiles */
     {
@@ -74,26 +114,16 @@ ValueFunction* BackupOperations::backUpCT (ValueFunction *vf, ContinuousTransiti
 	{
 	  /* intersect each outcome with the value function */
 	  ContinuousOutcome *co = bspCTTile->getContinuousOutcome (i);
-	  ValueFunction *piece = BackupOperations::intersectCOWithVF (vf, co, low, high);
-	  
-	  ValueFunction *cpiece
-	    = static_cast<ValueFunction*> (BspTreeOperations::cropTree (piece, co->getLowPos (), co->getHighPos ()));
-	  BspTree::deleteBspTree (piece);
-	  
-	  
-	  /* shift the piece back */
-	  cpiece 
-	    = static_cast<ValueFunction*> (BspTreeOperations::shiftTree (cpiece, co->getShiftBack (), low, high));
+	  ValueFunction *cpiece = BackupOperations::shiftOutcomePiece (ctx, vf, co, low, high);
 	  
 	  /* intersect all shifted pieces */
 	  if (i > 0)
 	    {
-	      BspTreeOperations::m_currentIntersectionType = BTI_PLUS; 
-	      res = static_cast<ValueFunction*> (BspTreeOperations::intersectTrees (cpiece, tres, low, high));
+	      res = static_cast<ValueFunction*> (BspTreeOperations::intersectTrees (pctx, cpiece, tres, low, high));
 	      BspTree::deleteBspTree (cpiece); BspTree::deleteBspTree (tres);
 	      tres = res;
-	      if (BspTreeOperations::m_piecesMerging)
-		res->mergeTreeLeaves (low, high);
+	      if (pctx.m_piecesMerging)
+		res->mergeTreeLeaves (pctx, low, high);
 	    }
 	  else res = tres = cpiece;
 	}
@@ -101,12 +131,11 @@ ValueFunction* BackupOperations::backUpCT (ValueFunction *vf, ContinuousTransiti
       /* assemble the final partition */
       if (tiles == 0)
 	tpart = tilePartition;
-      BspTreeOperations::m_currentIntersectionType = BTI_PLUS;
-      tilePartition = static_cast<ValueFunction*> (BspTreeOperations::intersectTrees (tpart, res, low, high));
+      tilePartition = static_cast<ValueFunction*> (BspTreeOperations::intersectTrees (pctx, tpart, res, low, high));
       BspTree::deleteBspTree (tpart); BspTree::deleteBspTree (res);
       tpart = tilePartition;
-      if (BspTreeOperations::m_piecesMerging)
-	tpart->mergeTreeLeaves (low, high);
+      if (pctx.m_piecesMerging)
+	tpart->mergeTreeLeaves (pctx, low, high);
 
     } /* end for tiles */
 
@@ -116,48 +145,208 @@ ValueFunction* BackupOperations::backUpCT (ValueFunction *vf, ContinuousTransiti
 ValueFunction* BackupOperations::backUpSingleOutcome (ValueFunction *vf, ContinuousOutcome *co,
 						      double *low, double *high)
 {
+  return BackupOperations::backUpSingleOutcome (BspOpContext (), vf, co, low, high);
+}
+
+ValueFunction* BackupOperations::backUpSingleOutcome (const BspOpContext &ctx,
+						      ValueFunction *vf, ContinuousOutcome *co,
+						      double *low, double *high)
+{
+  /* intersect with the outcome, crop and shift the piece back, in a single pass. */
+  ValueFunction *cpiece = BackupOperations::shiftOutcomePiece (ctx, vf, co, low, high);
   
-  ValueFunction *piece = BackupOperations::intersectCOWithVF (vf, co, low, high);
+  if (ctx.m_piecesMerging)
+    cpiece->mergeTreeLeaves (ctx, low, high);
   
-  ValueFunction *cpiece
-    = static_cast<ValueFunction*> (BspTreeOperations::cropTree (piece, co->getLowPos (), co->getHighPos ()));
-  BspTree::deleteBspTree (piece);
+  return cpiece;
+}
+
+ValueFunction* BackupOperations::shiftOutcomePiece (const BspOpContext &ctx, ValueFunction *vf,
+						    ContinuousOutcome *co, double *low, double *high)
+{
+  BspOpContext lctx (ctx);
+  lctx.m_outputType = vf->getType ();
+  int dim = vf->getSpaceDimension ();
+  double prob = BackupOperations::outcomeProbability (*co);
+  if (prob <= 0.0)  /* no probability: the outcome piece is empty, as with intersectCOWithVF. */
+    return static_cast<ValueFunction*> (BspTreeOperations::createTree (lctx, dim));
   
-  /* shift the piece back */
-  cpiece 
-    = static_cast<ValueFunction*> (BspTreeOperations::shiftTree (cpiece, co->getShiftBack (), low, high));
+  std::vector<double> clow (co->getLowPos (), co->getLowPos ()+dim);
+  std::vector<double> chigh (co->getHighPos (), co->getHighPos ()+dim);
+  return static_cast<ValueFunction*> (BackupOperations::shiftOutcomeBox (lctx, vf, 0, prob, co->getShiftBack (),
+									  &clow[0], &chigh[0], low, high));
+}
+
+BspTree* BackupOperations::shiftOutcomeBox (const BspOpContext &ctx, BspTree *bt, const int &d,
+					    const double &prob, double *shift, double *clow, double *chigh,
+					    double *low, double *high)
+{
+  if (d == bt->getSpaceDimension ())
+    return BackupOperations::shiftOutcomeCell (ctx, bt, prob, shift, clow, chigh, low, high);
   
-  if (BspTreeOperations::m_piecesMerging)
-    cpiece->mergeTreeLeaves (low, high);
+  /* outcome box boundaries in dimension d, empty outside (as cropTree). */
+  BspTree *inside = BackupOperations::shiftOutcomeBox (ctx, bt, d+1, prob, shift, clow, chigh, low, high);
+  BspTree *bsp_n = BackupOperations::shiftOutcomeNode (ctx, d, clow[d] + shift[d],
+						       BspTreeOperations::createTree (ctx, bt->getSpaceDimension ()),
+						       inside, low, high);
+  return BackupOperations::shiftOutcomeNode (ctx, d, chigh[d] + shift[d], bsp_n,
+					     BspTreeOperations::createTree (ctx, bt->getSpaceDimension ()),
+					     low, high);
+}
+
+BspTree* BackupOperations::shiftOutcomeCell (const BspOpContext &ctx, BspTree *bt,
+					     const double &prob, double *shift, double *clow, double *chigh,
+					     double *low, double *high)
+{
+  /* return a 'dead-end' leaf in case the tile is too small (as intersectWithCell). */
+  for (int d=0; d<bt->getSpaceDimension (); d++)
+    if (Alg::REqual (chigh[d], clow[d], ctx.m_epsilon))
+      return BspTreeOperations::createTree (ctx, bt->getSpaceDimension ());
   
-  return cpiece;
+  if (bt->isLeaf ())
+    {
+      ValueFunction *vf = static_cast<ValueFunction*> (BspTreeOperations::createTree (ctx, bt));
+      if (vf->getAlphaVectors ())
+	{
+	  /* multiply by the outcome probability, as ValueFunction::leafDataIntersectMult. */
+	  double p = prob;
+	  if (vf->getAlphaVectorsSize () == 1 && vf->getCSDFlag ())
+	    for (int d=0; d<vf->getSpaceDimension (); d++)
+	      p *= (chigh[d] - clow[d]);
+	  vf->multiplyByScalar (p);
+	}
+      vf->leafDataShift (shift);  /* virtual call */
+      return vf;
+    }
+
+  /* partitions that do not cut through the cell are skipped. */
+  int d = bt->getDimension ();
+  double pos = bt->getPosition ();
+  if (Alg::RInfEqual (pos, clow[d], ctx.m_epsilon))
+    return BackupOperations::shiftOutcomeCell (ctx, bt->getGreaterTree (), prob, shift, clow, chigh, low, high);
+  if (Alg::RSupEqual (pos, chigh[d], ctx.m_epsilon))
+    return BackupOperations::shiftOutcomeCell (ctx, bt->getLowerTree (), prob, shift, clow, chigh, low, high);
+  
+  /* partitions that are shifted out of the domain are dropped along with the outside half (as shiftTree). */
+  double spos = pos + shift[d];
+  bool lower = ! Alg::RInf (spos, low[d], ctx.m_epsilon);
+  bool greater = ! Alg::RSup (spos, high[d], ctx.m_epsilon);
+  BspTree *lt = 0, *ge = 0;
+  if (greater)
+    {
+      double b = chigh[d];
+      chigh[d] = pos;
+      lt = BackupOperations::shiftOutcomeCell (ctx, bt->getLowerTree (), prob, shift, clow, chigh, low, high);
+      chigh[d] = b;
+    }
+  if (lower)
+    {
+      double b = clow[d];
+      clow[d] = pos;
+      ge = BackupOperations::shiftOutcomeCell (ctx, bt->getGreaterTree (), prob, shift, clow, chigh, low, high);
+      clow[d] = b;
+    }
+  if (! greater)
+    return lt;
+  if (! lower)
+    return ge;
+  BspTree *bsp_n = BspTreeOperations::createTree (ctx, bt->getSpaceDimension (), d, spos);
+  bsp_n->setLowerTree (lt);
+  bsp_n->setGreaterTree (ge);
+  return bsp_n;
+}
+
+BspTree* BackupOperations::shiftOutcomeNode (const BspOpContext &ctx, const int &d, const double &pos,
+					     BspTree *lt, BspTree *ge, double *low, double *high)
+{
+  /* drop the half that is shifted out of the domain (as shiftTree). */
+  if (Alg::RSup (pos, high[d], ctx.m_epsilon))
+    {
+      BspTree::deleteBspTree (ge);
+      return lt;
+    }
+  else if (Alg::RInf (pos, low[d], ctx.m_epsilon))
+    {
+      BspTree::deleteBspTree (lt);
+      return ge;
+    }
+  BspTree *bsp_n = BspTreeOperations::createTree (ctx, lt->getSpaceDimension (), d, pos);
+  bsp_n->setLowerTree (lt);
+  bsp_n->setGreaterTree (ge);
+  return bsp_n;
+}
+
+double BackupOperations::outcomeProbability (const BspTree &co)
+{
+  if (co.isLeaf ())
+    return static_cast<const ContinuousOutcome&> (co).getProbability ();
+  double prob = BackupOperations::outcomeProbability (*co.getLowerTree ());
+  if (prob < 0.0)
+    prob = BackupOperations::outcomeProbability (*co.getGreaterTree ());
+  return prob;
 }
 
 ValueFunction* BackupOperations::backUpOutcomes (const int &h, const int &t,
 						 ContinuousTransition *ct, ValueFunction *vf,
 						 double *low, double *high)
+{
+  return BackupOperations::backUpOutcomes (BspOpContext (), h, t, ct, vf, low, high);
+}
+
+ValueFunction* BackupOperations::backUpOutcomes (const BspOpContext &ctx,
+						 const int &h, const int &t,
+						 ContinuousTransition *ct, ValueFunction *vf,
+						 double *low, double *high)
 {
   if (h == t)
-    return BackupOperations::backUpSingleOutcome (vf, ct->getContinuousOutcome (h), low, high);
+    return BackupOperations::backUpSingleOutcome (ctx, vf, ct->getContinuousOutcome (h), low, high);
 
-  ValueFunction *t1 = BackupOperations::backUpOutcomes (h, (h+t)/2, ct, vf, low, high);
-  ValueFunction *t2 = BackupOperations::backUpOutcomes ((h+t)/2 + 1, t, ct, vf, low, high);
+  ValueFunction *t1 = 0, *t2 = 0;
+  if (ctx.m_pool)
+    {
+      /* both halves only read vf: back them up concurrently, each on its own bounds. */
+      int dim = vf->getSpaceDimension ();
+      std::vector<double> low1 (low, low+dim), high1 (high, high+dim);
+      std::vector<double> low2 (low, low+dim), high2 (high, high+dim);
+      std::vector<std::function<void ()> > tasks;
+      tasks.push_back ([&] () { t1 = BackupOperations::backUpOutcomes (ctx, h, (h+t)/2, ct, vf,
+								      &low1[0], &high1[0]); });
+      tasks.push_back ([&] () { t2 = BackupOperations::backUpOutcomes (ctx, (h+t)/2 + 1, t, ct, vf,
+								      &low2[0], &high2[0]); });
+      ctx.m_pool->run (tasks);
+    }
+  else
+    {
+      t1 = BackupOperations::backUpOutcomes (ctx, h, (h+t)/2, ct, vf, low, high);
+      t2 = BackupOperations::backUpOutcomes (ctx, (h+t)/2 + 1, t, ct, vf, low, high);
+    }
   
-  BspTreeOperations::m_currentIntersectionType = BTI_PLUS; 
-  ValueFunction *ret = static_cast<ValueFunction*> (BspTreeOperations::intersectTrees (t1, t2, low, high));
+  BspOpContext pctx (ctx);
+  pctx.m_intersectionType = BTI_PLUS; 
+  ValueFunction *ret = static_cast<ValueFunction*> (BspTreeOperations::intersectTrees (pctx, t1, t2, low, high));
 
   BspTree::deleteBspTree (t1); BspTree::deleteBspTree (t2);
-  if (BspTreeOperations::m_piecesMerging)
-    ret->mergeTreeLeaves (low, high);
+  if (pctx.m_piecesMerging)
+    ret->mergeTreeLeaves (pctx, low, high);
   return ret;
 }
 
 ValueFunction* BackupOperations::backUpCT2 (ValueFunction *vf, ContinuousTransition *ct,
 					    double *low, double *high)
 {
+  return BackupOperations::backUpCT2 (BspOpContext (), vf, ct, low, high);
+}
+
+ValueFunction* BackupOperations::backUpCT2 (const BspOpContext &ctx,
+					    ValueFunction *vf, ContinuousTransition *ct,
+					    double *low, double *high)
+{
+  BspOpContext pctx (ctx);
+  pctx.m_outputType = vf->getType ();
+  pctx.m_intersectionType = BTI_PLUS;
   ValueFunction *res = 0, *tpart = 0;
   ValueFunction *cachedTree = BackupOperations::selectCachedTree (*vf, *ct);
-  ValueFunction *tilePartition = static_cast<ValueFunction*> (BspTreeOperations::createTree (cachedTree));
+  ValueFunction *tilePartition = static_cast<ValueFunction*> (BspTreeOperations::createTree (pctx, cachedTree));
   
   for (int tiles=0; tiles<ct->getTilingDimension (); tiles++)  /* iterate the transition tiles */
     {
@@ -167,17 +356,16 @@ ValueFunction* BackupOperations::backUpCT2 (ValueFunction *vf, ContinuousTransit
 	continue;
       
       /* backup continuous outcomes */
-      res = BackupOperations::backUpOutcomes (0, bspCTTile->getNContinuousOutcomes ()-1,
+      res = BackupOperations::backUpOutcomes (ctx, 0, bspCTTile->getNContinuousOutcomes ()-1,
 					      bspCTTile, vf, low, high);
       
-      BspTreeOperations::m_currentIntersectionType = BTI_PLUS;
-      tpart = static_cast<ValueFunction*> (BspTreeOperations::intersectTrees (tilePartition, res, low, high));
+      tpart = static_cast<ValueFunction*> (BspTreeOperations::intersectTrees (pctx, tilePartition, res, low, high));
       BspTree::deleteBspTree (tilePartition); 
       BspTree::deleteBspTree (res);
       tilePartition = tpart;
       
-      if (BspTreeOperations::m_piecesMerging)
-	tilePartition->mergeTreeLeaves (low, high);
+      if (pctx.m_piecesMerging)
+	tilePartition->mergeTreeLeaves (pctx, low, high);
 
     } /* end for tiles */
 
@@ -187,15 +375,31 @@ ValueFunction* BackupOperations::backUpCT2 (ValueFunction *vf, ContinuousTransit
 ValueFunction* BackupOperations::backUp (ValueFunction *vf, ContinuousTransition *ct,
 					 ContinuousReward *cr, const int &action,
 					 double *low, double *high)
+{
+  return BackupOperations::backUp (BspOpContext (), vf, ct, cr, action, low, high);
+}
+
+ValueFunction* BackupOperations::backUp (const BspOpContext &ctx,
+					 ValueFunction *vf, ContinuousTransition *ct,
+					 ContinuousReward *cr, const int &action,
+					 double *low, double *high)
+{
+  return BackupOperations::backUp (ctx, vf, ct, cr, action, low, high, 1.0);
+}
+
+ValueFunction* BackupOperations::backUp (const BspOpContext &ctx,
+					 ValueFunction *vf, ContinuousTransition *ct,
+					 ContinuousReward *cr, const int &action,
+					 double *low, double *high, const double &scale)
 {
   /* intersect vf with reward. */
   ValueFunction *vfr = NULL;
   if (cr)
-    vfr = BackupOperations::intersectVFWithReward (vf, cr, low, high);
+    vfr = BackupOperations::intersectVFWithReward (ctx, vf, cr, low, high, scale);
   else vfr = vf;
   
   /* backup the transition */
-  ValueFunction *qFunction = BackupOperations::backUpCT2 (vfr, ct, low, high);
+  ValueFunction *qFunction = BackupOperations::backUpCT2 (ctx, vfr, ct, low, high);
   if (vfr != vf) BspTree::deleteBspTree (vfr);
   
   /* tag qFunction with action. */
@@ -207,27 +411,60 @@ ValueFunction* BackupOperations::backUp (ValueFunction *vf, ContinuousTransition
 ValueFunction* BackupOperations::backUp (const HybridTransition &ht, ValueFunction **discStatesVF, 
 					 double *low, double *high)
 {
+  return BackupOperations::backUp (BspOpContext (), ht, discStatesVF, low, high);
+}
+
+ValueFunction* BackupOperations::backUp (const BspOpContext &ctx,
+					 const HybridTransition &ht, ValueFunction **discStatesVF, 
+					 double *low, double *high, const double &scale)
+{
+  if (ctx.m_pool && ht.getNOutcomes () > 1)
+    {
+      /* discrete outcomes are backed up concurrently, then summed as a tree. */
+      std::vector<ValueFunction*> qfunctions (ht.getNOutcomes (), NULL);
+      std::vector<std::function<void ()> > tasks;
+      for (int i=0; i<ht.getNOutcomes (); i++)
+	tasks.push_back ([&, i] ()
+	  {
+	    int dim = discStatesVF[i]->getSpaceDimension ();
+	    std::vector<double> lo (low, low+dim), hi (high, high+dim);
+	    HybridTransitionOutcome *hto = ht.getOutcome (i);
+	    ValueFunction *qai 
+	      = BackupOperations::backUp (ctx, discStatesVF[i], hto->getContTransition (),
+					  hto->getContReward (), ht.getActionIndex (), &lo[0], &hi[0], scale);
+	    double factor = scale * hto->getOutcomeProbability ();
+	    if (factor != 1.0)
+	      qai->multiplyByScalar (factor);
+	    qfunctions[i] = qai;
+	  });
+      ctx.m_pool->run (tasks);
+      return ValueFunctionOperations::sumValueFunctions (ctx, qfunctions, low, high);
+    }
+
+  BspOpContext pctx (ctx);
+  pctx.m_intersectionType = BTI_PLUS;
   ValueFunction *hqFunction = 0;
   for (int i=0; i<ht.getNOutcomes (); i++)
     { 
       HybridTransitionOutcome *hto = ht.getOutcome (i);
       
       ValueFunction *qai 
-	= BackupOperations::backUp (discStatesVF[i], hto->getContTransition (), hto->getContReward (),
-				    ht.getActionIndex (), low, high);
+	= BackupOperations::backUp (ctx, discStatesVF[i], hto->getContTransition (), hto->getContReward (),
+				    ht.getActionIndex (), low, high, scale);
       
-      if (hto->getOutcomeProbability () < 1.0)
-	qai->multiplyByScalar (hto->getOutcomeProbability ());
+      /* apply the lazy scale along with the outcome probability, in a single pass. */
+      double factor = scale * hto->getOutcomeProbability ();
+      if (factor != 1.0)
+	qai->multiplyByScalar (factor);
       
       if (! hqFunction)
 	hqFunction = qai;
       else 
 	{
-	  BspTreeOperations::m_currentIntersectionType = BTI_PLUS;
 	  ValueFunction *sum 
-	    = static_cast<ValueFunction*> (BspTreeOperations::intersectTrees (qai, hqFunction, low, high));
-	  if (BspTreeOperations::m_piecesMerging)
-	    sum->mergeTreeLeaves (low, high);
+	    = static_cast<ValueFunction*> (BspTreeOperations::intersectTrees (pctx, qai, hqFunction, low, high));
+	  if (pctx.m_piecesMerging)
+	    sum->mergeTreeLeaves (pctx, low, high);
 	  BspTree::deleteBspTree (qai); BspTree::deleteBspTree (hqFunction);
 	  hqFunction = sum;
 	}
@@ -43,22 +43,56 @@ class BackupOperations : public ValueFunctionOperations
   static ValueFunction* intersectCOWithVF (ValueFunction *vf, ContinuousOutcome *co, 
 					   double *low, double *high);
 
+  static ValueFunction* intersectCOWithVF (const BspOpContext &ctx,
+					   ValueFunction *vf, ContinuousOutcome *co, 
+					   double *low, double *high);
+
   static ValueFunction* intersectVFWithReward (ValueFunction *vf, ContinuousReward *cr,
 					       double *low, double *high);
 
+  static ValueFunction* intersectVFWithReward (const BspOpContext &ctx,
+					       ValueFunction *vf, ContinuousReward *cr,
+					       double *low, double *high);
+
+  /**
+   * \brief intersects a lazily scaled value function with a reward: returns vf + cr/scale,
+   *        that is to be multiplied by scale, i.e. scale*vf + cr without copying vf.
+   * @param scale lazy multiplier of vf, strictly positive.
+   */
+  static ValueFunction* intersectVFWithReward (const BspOpContext &ctx,
+					       ValueFunction *vf, ContinuousReward *cr,
+					       double *low, double *high, const double &scale);
+
   static ValueFunction* backUpCT (ValueFunction *vf, ContinuousTransition *ct,
 				  double *low, double *high);
+
+  static ValueFunction* backUpCT (const BspOpContext &ctx,
+				  ValueFunction *vf, ContinuousTransition *ct,
+				  double *low, double *high);
   
   static ValueFunction* backUpCT2 (ValueFunction *vf, ContinuousTransition *ct,
 				   double *low, double *high);
+
+  static ValueFunction* backUpCT2 (const BspOpContext &ctx,
+				   ValueFunction *vf, ContinuousTransition *ct,
+				   double *low, double *high);
   
   static ValueFunction* backUpOutcomes (const int &h, const int &t,
 					ContinuousTransition *ct, ValueFunction *vf,
 					double *low, double *high);
 
+  static ValueFunction* backUpOutcomes (const BspOpContext &ctx,
+					const int &h, const int &t,
+					ContinuousTransition *ct, ValueFunction *vf,
+					double *low, double *high);
+
   static ValueFunction* backUpSingleOutcome (ValueFunction *vf, ContinuousOutcome *co,
 					     double *low, double *high);
 
+  static ValueFunction* backUpSingleOutcome (const BspOpContext &ctx,
+					     ValueFunction *vf, ContinuousOutcome *co,
+					     double *low, double *high);
+
  public:
   /**
    * \brief computes the convolution of value function vf with a continuous transition ct,
@@ -75,6 +109,25 @@ class BackupOperations : public ValueFunctionOperations
   static ValueFunction* backUp (ValueFunction *vf, ContinuousTransition *ct, ContinuousReward *cr,
 				const int &action, double *low, double *high);
 
+  /**
+   * \brief same as above, within an explicit operation context (only its merging
+   *        policy, balance flag and tolerance are used, the operation sets the types).
+   * @param ctx operation context.
+   */
+  static ValueFunction* backUp (const BspOpContext &ctx,
+				ValueFunction *vf, ContinuousTransition *ct, ContinuousReward *cr,
+				const int &action, double *low, double *high);
+
+  /**
+   * \brief same as above, with vf lazily multiplied by scale: the backup is linear in vf,
+   *        so the returned q-function is to be multiplied by scale (the reward is
+   *        divided by scale accordingly).
+   * @param scale lazy multiplier of vf, strictly positive.
+   */
+  static ValueFunction* backUp (const BspOpContext &ctx,
+				ValueFunction *vf, ContinuousTransition *ct, ContinuousReward *cr,
+				const int &action, double *low, double *high, const double &scale);
+
   /**
    * \brief backs up an action (hybrid transition) and all its outcomes.
    * @param ht hybrid transition, i.e. an action with probabilistic discrete and continuous outcomes.
@@ -86,9 +139,46 @@ class BackupOperations : public ValueFunctionOperations
   static ValueFunction* backUp (const HybridTransition &ht, ValueFunction **discStatesVF, 
 				double *low, double *high);
 
+  /**
+   * \brief backs up an action within an explicit operation context. If the context
+   *        holds a thread pool, discrete and continuous outcomes are backed up concurrently.
+   * @param ctx operation context,
+   * @param scale lazy multiplier of the value functions in discStatesVF, e.g. a discount
+   *        factor, strictly positive: it is applied once to each outcome q-function,
+   *        along with the outcome probability, instead of to copies of the value functions.
+   * @sa BackupOperations::backUp
+   */
+  static ValueFunction* backUp (const BspOpContext &ctx,
+				const HybridTransition &ht, ValueFunction **discStatesVF, 
+				double *low, double *high, const double &scale=1.0);
+
  private:
-  
+  /**
+   * \brief restricts a value function to the box of a continuous outcome, shifts it back and
+   *        weights its leaves with the outcome probability, in a single pass over the value function.
+   *        This is shiftTree (cropTree (intersectCOWithVF (vf, co))) without the intermediate trees.
+   * @param ctx operation context, with the value function type as output type,
+   * @param vf value function,
+   * @param co continuous outcome,
+   * @param low domain lower bounds,
+   * @param high domain upper bounds.
+   * @return the shifted piece, not merged.
+   */
+  static ValueFunction* shiftOutcomePiece (const BspOpContext &ctx, ValueFunction *vf,
+					   ContinuousOutcome *co, double *low, double *high);
+
+  static BspTree* shiftOutcomeBox (const BspOpContext &ctx, BspTree *bt, const int &d,
+				   const double &prob, double *shift, double *clow, double *chigh,
+				   double *low, double *high);
+
+  static BspTree* shiftOutcomeCell (const BspOpContext &ctx, BspTree *bt,
+				    const double &prob, double *shift, double *clow, double *chigh,
+				    double *low, double *high);
+
+  static BspTree* shiftOutcomeNode (const BspOpContext &ctx, const int &d, const double &pos,
+				    BspTree *lt, BspTree *ge, double *low, double *high);
 
+  static double outcomeProbability (const BspTree &co);
 };
 
 } /* end of namespace */
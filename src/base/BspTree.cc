@@ -16,6 +16,13 @@
 
 #include "BspTree.h"
 #include "BspTreeOperations.h"
+#include "BspTreeStore.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include <stdio.h>
 #include <math.h>
 #include <stdlib.h>
 
@@ -25,18 +32,18 @@ namespace hmdp_base
 PlotPointFormat BspTree::m_plotPointFormat = GnuplotF;  /**< gnuplot is default. */
 
 BspTree::BspTree (const int &dim)
-  : m_bspType (BspTreeT), m_nDim (dim), m_d (-1), m_pos (0), 
+  : m_bspType (BspTreeT), m_nDim (dim), m_d (-1), m_refs (0), m_pos (0), 
     m_lt (0), m_ge (0) /* should find a better value for mpos... */
 {}
 
 BspTree::BspTree (const int &dim, const int &d, const double &pos)
-  : m_bspType (BspTreeT), m_nDim (dim), m_d (d), m_pos (pos), m_lt (0), m_ge (0)
+  : m_bspType (BspTreeT), m_nDim (dim), m_d (d), m_refs (0), m_pos (pos), m_lt (0), m_ge (0)
 {}
 
 /* Beware: may need domain bounds for checking the shift is valid. */
 BspTree::BspTree (const int &dim, double *lowPos, double *highPos, 
 		  const double *low, const double *high, const double *shift)
-  : m_bspType (BspTreeT), m_nDim (dim)
+  : m_bspType (BspTreeT), m_nDim (dim), m_refs (0)
 {
   BspTree *bsp_n = this;
   
@@ -81,7 +88,7 @@ BspTree::BspTree (const int &dim, double *lowPos, double *highPos,
 
 BspTree::BspTree (const BspTree &bt)
   : m_bspType (bt.getType ()), m_nDim (bt.getSpaceDimension ()), 
-    m_d (bt.getDimension ()), m_pos (bt.getPosition ()) 
+    m_d (bt.getDimension ()), m_refs (0), m_pos (bt.getPosition ())
 {
   if (! bt.isLeaf ())
     {
@@ -98,6 +105,11 @@ BspTree::~BspTree ()
 /* recursive destructor (static) */
 void BspTree::deleteBspTree (BspTree *bt)
 {
+  if (bt->isShared ())
+    {
+      BspTreeStore::release (bt);  /* deleted with its last reference. */
+      return;
+    }
   if (! bt->isLeaf ())
     {
       BspTree::deleteBspTree (bt->getLowerTree ());
@@ -278,12 +290,26 @@ void BspTree::plot2DVrml2R (const double &space, std::ofstream &output_vrml,
 void BspTree::plotNDPointValues (std::ofstream &output_values, double *step,
 				 double *low, double *high)
 {
-  int *npts = new int[m_nDim];
-  int *bins = new int[m_nDim];
-  int *counters = new int[m_nDim];
-  double *pos = new double[m_nDim];
-  int tpts = 1;
+  plotNDPointValues (output_values, step, low, high, NULL);
+}
+
+void BspTree::plotNDPointValues (std::ofstream &output_values, double *step,
+				 double *low, double *high, ThreadPool *pool)
+{
+  const PlotPointFormat format = BspTree::m_plotPointFormat;
+  if (format != GnuplotF && format != MathematicaF && format != BinaryF)
+    {
+      std::cerr << "[Error]:BspTree::plotNDPointValues: unknown output format: "
+		<< format << ". Exiting.\n";
+      exit (-1);
+    }
 
+  /* grid coordinates, accumulated along each axis. */
+  std::vector<int> npts (m_nDim);
+  std::vector<long> strides (m_nDim);
+  std::vector<std::vector<double> > coords (m_nDim);
+  std::vector<double*> coordsp (m_nDim);
+  long tpts = 1;
   for (int i=0; i<m_nDim; i++)
     {
 #if !defined __GNUC__ || __GNUC__ < 3
@@ -291,55 +317,165 @@ void BspTree::plotNDPointValues (std::ofstream &output_values, double *step,
 #else
       npts[i] = lround ((high[i] - low[i]) / step[i]);
 #endif
-      if (i == 0) bins[0] = 1;
-      else bins[i] = bins[i-1] * npts[i-1];
-
+      strides[i] = tpts;
       tpts *= npts[i];
-
-      counters[i] = 0;
-      pos[i] = low[i];
+      coords[i].resize (npts[i]);
+      double pos = low[i];
+      for (int c=0; c<npts[i]; c++)
+	{
+	  coords[i][c] = pos;
+	  pos += step[i];
+	}
+      coordsp[i] = coords[i].empty () ? NULL : &coords[i][0];
     }
 
-  int cpts = 0;
-  while (cpts < tpts)
+  if (format == BinaryF)
+    {
+      output_values.write ("HMDPGRID", 8);
+      int64_t ndims = m_nDim;
+      output_values.write (reinterpret_cast<const char*> (&ndims), sizeof (int64_t));
+      for (int i=0; i<m_nDim; i++)
+	{
+	  int64_t n = npts[i];
+	  output_values.write (reinterpret_cast<const char*> (&n), sizeof (int64_t));
+	  output_values.write (reinterpret_cast<const char*> (&low[i]), sizeof (double));
+	  output_values.write (reinterpret_cast<const char*> (&step[i]), sizeof (double));
+	}
+    }
+  if (tpts <= 0)
+    return;
+
+  /* the grid is processed by chunks of slabs along the last axis (a slab is a line
+     of text in point formats), by rounds of chunks that are filled and formatted
+     concurrently, then written in order. */
+  const int last = m_nDim - 1;
+  const long slab = strides[last];
+  const int nslabs = npts[last];
+  const int slabsPerChunk = std::max (1L, 65536L / slab);
+  const int nchunks = (nslabs + slabsPerChunk - 1) / slabsPerChunk;
+  const int roundSize = pool ? 2 * pool->getNThreads () : 1;
+  const int precision = output_values.precision ();
+
+  std::vector<std::vector<double> > values (roundSize);
+  std::vector<std::string> texts (roundSize);
+  for (int r=0; r<nchunks; r+=roundSize)
     {
-      /* write point coordinates and value. */
-      if (BspTree::m_plotPointFormat == GnuplotF)
-	plotPointValueGnuplot (output_values, pos);
-      else if (BspTree::m_plotPointFormat == MathematicaF)
-	plotPointValueMathematica (output_values, pos);	
-      else
+      int nr = std::min (roundSize, nchunks - r);
+      std::vector<std::function<void ()> > tasks;
+      for (int k=0; k<nr; k++)
+	tasks.push_back ([this, k, r, &values, &texts, &coordsp, &npts, &strides, &coords,
+			  slab, nslabs, slabsPerChunk, last, format, precision] ()
+	  {
+	    int s0 = (r + k) * slabsPerChunk;
+	    int s1 = std::min (nslabs, s0 + slabsPerChunk);
+	    std::vector<double> &vals = values[k];
+	    vals.resize ((s1 - s0) * slab);
+	    std::vector<int> lo (m_nDim, 0), hi (npts);
+	    lo[last] = s0; hi[last] = s1;
+	    std::vector<double> pos (m_nDim);
+	    fillNDPointValues (&coordsp[0], &lo[0], &hi[0], &strides[0],
+			       &vals[0], s0 * slab, &pos[0]);
+	    if (format == BinaryF)
+	      return;
+
+	    /* same text as the ofstream formatting, with default flags. */
+	    std::string &text = texts[k];
+	    text.clear ();
+	    char buf[64];
+	    std::vector<int> c (m_nDim, 0);
+	    for (int sl=s0; sl<s1; sl++)
+	      {
+		c[last] = sl;
+		for (long p=0; p<slab; p++)
+		  {
+		    long rem = p;
+		    for (int i=0; i<last; i++)
+		      {
+			c[i] = rem % npts[i];
+			rem /= npts[i];
+		      }
+		    double val = vals[(sl - s0) * slab + p];
+		    if (format == GnuplotF)
+		      {
+			for (int i=last; i>=0; i--)
+			  {
+			    snprintf (buf, sizeof (buf), "%.*g ", precision, coords[i][c[i]]);
+			    text += buf;
+			  }
+			snprintf (buf, sizeof (buf), "%.*g\n", precision, val);
+		      }
+		    else snprintf (buf, sizeof (buf), "%.*g ", precision, val);
+		    text += buf;
+		  }
+		text += '\n';
+	      }
+	  });
+      if (pool)
+	pool->run (tasks);
+      else tasks[0] ();
+
+      for (int k=0; k<nr; k++)
 	{
-	  std::cerr << "[Error]:BspTree::plotNDPointValues: unknown output format: "
-		    << BspTree::m_plotPointFormat << ". Exiting.\n";
-	  exit (-1);
+	  if (format == BinaryF)
+	    output_values.write (reinterpret_cast<const char*> (&values[k][0]),
+				 values[k].size () * sizeof (double));
+	  else output_values.write (texts[k].data (), texts[k].size ());
 	}
+    }
+  output_values.flush ();
+}
 
-      /* update coordinates. */
-      for (int i=m_nDim-1; i>=0; i--)
+void BspTree::fillNDPointValues (double **coords, int *lo, int *hi, const long *strides,
+				 double *values, const long &offset, double *pos)
+{
+  if (isLeaf ())
+    {
+      /* iterate the grid points of the tile, first axis fastest. */
+      for (int i=0; i<m_nDim; i++)
+	if (lo[i] >= hi[i])
+	  return;
+      std::vector<int> c (lo, lo + m_nDim);
+      for (int i=0; i<m_nDim; i++)
+	pos[i] = coords[i][c[i]];
+      while (true)
 	{
-	  counters[i]++;
-	  if (counters[i] == bins[i])
+	  long idx = -offset;
+	  for (int i=0; i<m_nDim; i++)
+	    idx += c[i] * strides[i];
+	  values[idx] = getPointValueInLeaf (pos);
+
+	  int i = 0;
+	  while (i < m_nDim && ++c[i] == hi[i])
 	    {
-	      if (i == m_nDim-1)
-		output_values << std::endl;
-
-	      counters[i] = 0;
-	      pos[i] += step[i];
-	      
-	      /* reset lower dimensions. */
-	      for (int j=0; j<i; j++)
-		{
-		  counters[j] = 0;
-		  pos[j] = low[j];
-		}
-	      break;
+	      c[i] = lo[i];
+	      pos[i] = coords[i][c[i]];
+	      i++;
 	    }
+	  if (i == m_nDim)
+	    break;
+	  pos[i] = coords[i][c[i]];
+	}
+    }
+  else
+    {
+      /* grid points below the dividing position go to the lower tree. */
+      int d = getDimension ();
+      int c = std::lower_bound (coords[d] + lo[d], coords[d] + hi[d], getPosition ()) - coords[d];
+      if (c > lo[d])
+	{
+	  int b = hi[d];
+	  hi[d] = c;
+	  getLowerTree ()->fillNDPointValues (coords, lo, hi, strides, values, offset, pos);
+	  hi[d] = b;
+	}
+      if (c < hi[d])
+	{
+	  int b = lo[d];
+	  lo[d] = c;
+	  getGreaterTree ()->fillNDPointValues (coords, lo, hi, strides, values, offset, pos);
+	  lo[d] = b;
 	}
-      cpts++;
     }
-  
-  delete []npts; delete []bins; delete []counters; delete []pos;
 }
 
 void BspTree::plotPointValueMathematica (std::ofstream &output_value, double *pos)
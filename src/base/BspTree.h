@@ -21,11 +21,14 @@
 #ifndef BSPTREE_H
 #define BSPTREE_H
 
+#include "MemoryPool.h"
 #include <iostream> /* NULL */
 #include <fstream>
+#include <atomic>
 
 namespace hmdp_base
 {
+  class ThreadPool;
 
 #ifndef BSPTREETYPE_H
 #define BSPTREETYPE_H
@@ -42,7 +45,8 @@ enum BspTreeType {
 #ifndef PLOTPOINTFORMAT_
 #define PLOTPOINTFORMAT_
 enum PlotPointFormat {
-  GnuplotF, MathematicaF
+  GnuplotF, MathematicaF,
+  BinaryF  /**< header and raw array of values, see BspTree::plotNDPointValues. */
 };
 #endif
 
@@ -90,12 +94,27 @@ class BspTree
    */
   virtual ~BspTree ();
   
+  /**
+   * \brief nodes of all tree types are allocated from the memory pool,
+   *        as operations create and destroy many temporary trees.
+   * @sa MemoryPool
+   */
+  static void* operator new (size_t size) { return MemoryPool::allocate (size); }
+  static void operator delete (void *p, size_t size) { MemoryPool::deallocate (p, size); }
+
   /**
    * \brief RECURSIVE destructor, i.e. destroys the full tree.
    * \sa BspTree::~BspTree ().
    */
   static void deleteBspTree (BspTree *bt);
 
+  /**
+   * \brief test if the tree is shared, i.e. stored once by the hash-consing store
+   *        and referenced by several trees. Shared trees must not be modified.
+   * @sa BspTreeStore
+   */
+  bool isShared () const { return m_refs.load (std::memory_order_relaxed) > 0; }
+
   /**
    * \brief test if the tree is a leaf.
    * @return true if the current tree is a leaf, false otherwise.
@@ -172,6 +191,28 @@ class BspTree
   void plotNDPointValues (std::ofstream &output_values, double *step, 
 			  double *low, double *high);
 
+  /**
+   * \brief outputs tree data points in a given format, with the grid split in
+   *        slabs along the last dimension that are filled and formatted concurrently,
+   *        and written in order.
+   *        Points are not located from the root one by one: the grid is split down
+   *        the tree, and each leaf fills the grid points within its tile.
+   *        The BinaryF format writes an 8-byte "HMDPGRID" tag, then the number of
+   *        dimensions as a 64-bit integer, then for each dimension the number of
+   *        points (64-bit integer), the first coordinate and the step (doubles),
+   *        then all values as doubles, first dimension varying fastest. All fields
+   *        are 8 bytes wide and in native byte order, so that the array of values
+   *        is aligned and can be memory-mapped by readers.
+   * @sa BspTree::m_plotPointFormat
+   * @param output_values, the file output,
+   * @param step the sampling step along each continuous axis,
+   * @param low the lower plotting bounds in the continuous space,
+   * @param high the upper plotting bounds in the continuous space,
+   * @param pool thread pool for filling and formatting slabs concurrently, or NULL.
+   */
+  void plotNDPointValues (std::ofstream &output_values, double *step,
+			  double *low, double *high, ThreadPool *pool);
+
   void plotPointValueMathematica (std::ofstream &output_value, double *pos);
   void plotPointValueGnuplot (std::ofstream &output_value, double *pos);
 
@@ -189,6 +230,20 @@ class BspTree
 
   virtual double getPointValueInLeaf (double *pos) { return 0.0; }
 
+  /**
+   * \brief fills the values of the grid points within bounds lo (included) and
+   *        hi (excluded) on each axis, from the leaves below this node.
+   * @param coords grid coordinates, per axis,
+   * @param lo lowest grid index per axis, temporarily modified,
+   * @param hi highest grid index per axis (excluded), temporarily modified,
+   * @param strides values array stride per axis,
+   * @param values array of values, indexed by the grid indices minus offset,
+   * @param offset index of the first value in the values array,
+   * @param pos point coordinates buffer (space dimension).
+   */
+  void fillNDPointValues (double **coords, int *lo, int *hi, const long *strides,
+			  double *values, const long &offset, double *pos);
+
  public:
   /* intersection function at initialization */
   virtual void leafDataIntersectInit (const BspTree &bt, const BspTree &btr,
@@ -227,12 +282,31 @@ class BspTree
    */
   virtual void transferData (const BspTree &bt) {};
 
+  /**
+   * \brief hash of the node data (leaf data included), for hash-consing.
+   *        Node data that are equal up to epsilon should hash alike.
+   * @param epsilon tolerance for comparing doubles.
+   * @sa BspTreeStore
+   */
+  virtual size_t hashNodeData (const double &epsilon) const { return 0; }
+
+  /**
+   * \brief node data (leaf data included) equality, for hash-consing.
+   *        Defaults to false, so that nodes of types that do not compare
+   *        their data are never shared.
+   * @param bt tree node of the same type,
+   * @param epsilon tolerance for comparing doubles.
+   * @sa BspTreeStore
+   */
+  virtual bool isEqualNodeData (const BspTree &bt, const double &epsilon) const { return false; }
+
   void fixSpaceDimension(const int &sdim);
 
  protected:
   BspTreeType m_bspType;  /**< tree type for differenciating during operations */
   int m_nDim;  /**< continuous space dimension */
   short m_d; /**< dividing dimension */
+  std::atomic<int> m_refs;  /**< references to a shared node, 0 if the node is not shared. */
   double m_pos;  /**< dividing position */
   BspTree *m_lt, *m_ge; /**<  sub trees for greater or equal case (ge),
 			   and less than case (lt). Terminal nodes point to NULL. */
@@ -241,7 +315,7 @@ class BspTree
   static PlotPointFormat m_plotPointFormat; /**< output format for point value plotting. */
 
  private:
- 
+  friend class BspTreeStore;
 };
 
 } /* end of namespace */
@@ -17,25 +17,32 @@
 #include "BspTreeAlpha.h"
 #include "ContinuousOutcome.h"
 #include <stdlib.h>
+#include <algorithm>
 
 namespace hmdp_base
 {
 
 BspTreeAlpha::BspTreeAlpha (const int &sdim)
-  : BspTree (sdim), m_alphaVectors (0), m_maxValue (0.0)
+  : BspTree (sdim), m_alphaVectors (0),
+    m_minValue (-std::numeric_limits<double>::max ()),
+    m_maxValue (std::numeric_limits<double>::max ())
 {
   m_bspType = BspTreeAlphaT;
 }  
 
 BspTreeAlpha::BspTreeAlpha (const int &sdim, const int &d, const double &pos)
-  : BspTree (sdim, d, pos), m_alphaVectors (0), m_maxValue (0.0)
+  : BspTree (sdim, d, pos), m_alphaVectors (0),
+    m_minValue (-std::numeric_limits<double>::max ()),
+    m_maxValue (std::numeric_limits<double>::max ())
 {
   m_bspType = BspTreeAlphaT;
 }
 
 BspTreeAlpha::BspTreeAlpha (const int &sdim, double *lowPos, 
 			    double *highPos, const double *low, const double *high)
-  : BspTree (sdim), m_alphaVectors (0), m_maxValue (0.0)
+  : BspTree (sdim), m_alphaVectors (0),
+    m_minValue (-std::numeric_limits<double>::max ()),
+    m_maxValue (std::numeric_limits<double>::max ())
 {
   m_bspType = BspTreeAlphaT;
   BspTreeAlpha *bsp_n = this;
@@ -75,7 +82,8 @@ BspTreeAlpha::BspTreeAlpha (const int &sdim, double *lowPos,
 
 BspTreeAlpha::BspTreeAlpha (const BspTreeAlpha &bta)
   : BspTree (bta.getSpaceDimension (), bta.getDimension (), bta.getPosition ()),
-    m_alphaVectors (0), m_maxValue (bta.getSubTreeMaxValue ())
+    m_alphaVectors (0), m_minValue (bta.getSubTreeMinValue ()),
+    m_maxValue (bta.getSubTreeMaxValue ())
 {
   m_bspType = BspTreeAlphaT;
 
@@ -107,6 +115,46 @@ BspTreeAlpha::~BspTreeAlpha ()
     }
 }
 
+size_t BspTreeAlpha::hashNodeData (const double &epsilon) const
+{
+  size_t h = 0;
+  if (! m_alphaVectors)
+    return h;
+  for (size_t i=0; i<m_alphaVectors->size (); i++)
+    {
+      AlphaVector *av = (*m_alphaVectors)[i];
+      for (int j=0; j<av->getSize (); j++)
+	Alg::hashCombine (h, Alg::hashDouble (av->getAlphaNth (j), epsilon));
+      for (std::set<int>::const_iterator ai = av->m_actions.begin (); ai != av->m_actions.end (); ai++)
+	Alg::hashCombine (h, static_cast<size_t> (*ai));
+    }
+  return h;
+}
+
+bool BspTreeAlpha::isEqualNodeData (const BspTree &bt, const double &epsilon) const
+{
+  const BspTreeAlpha &bta = static_cast<const BspTreeAlpha&> (bt);
+  if (! Alg::REqual (m_minValue, bta.getSubTreeMinValue (), epsilon)
+      || ! Alg::REqual (m_maxValue, bta.getSubTreeMaxValue (), epsilon))
+    return false;
+  if (! m_alphaVectors || ! bta.getAlphaVectors ())
+    return m_alphaVectors == bta.getAlphaVectors ();
+  if (m_alphaVectors->size () != bta.getAlphaVectorsSize ())
+    return false;
+  for (size_t i=0; i<m_alphaVectors->size (); i++)
+    {
+      AlphaVector *av1 = (*m_alphaVectors)[i];
+      AlphaVector *av2 = bta.getAlphaVectorNth (i);
+      if (av1->getSize () != av2->getSize ()
+	  || av1->m_actions != av2->m_actions)
+	return false;
+      for (int j=0; j<av1->getSize (); j++)
+	if (! Alg::REqual (av1->getAlphaNth (j), av2->getAlphaNth (j), epsilon))
+	  return false;
+    }
+  return true;
+}
+
 /* TODO: a 'while' could break and would be faster... */
 bool BspTreeAlpha::isZero ()
 {
@@ -175,10 +223,10 @@ void BspTreeAlpha::transferData (const BspTree &bt)
 	{
 	  m_alphaVectors = new std::vector<AlphaVector*> ();
 	  m_alphaVectors->push_back (new AlphaVector (co.getProbability ()));
+	  setSubTreeBounds (co.getProbability (), co.getProbability ());
 	}
-      
-      /* set max value. */
-      m_maxValue = co.getProbability ();
+      else setSubTreeBounds (-std::numeric_limits<double>::max (),
+			     -std::numeric_limits<double>::max ());
     }
   else 
     {
@@ -193,8 +241,8 @@ void BspTreeAlpha::transferData (const BspTree &bt)
 	    m_alphaVectors->push_back (new AlphaVector (*bta.getAlphaVectorNth (i)));
 	}
       
-      /* copy max value. */
-      m_maxValue = bta.getSubTreeMaxValue ();
+      /* copy value bounds. */
+      copySubTreeBounds (bta);
     }
 }
 
@@ -238,6 +286,13 @@ void BspTreeAlpha::addScalar (const double &scalar)
     {
       AlphaVector::addVecScalar (scalar, getAlphaVectors ());
     }
+
+  /* known bounds are shifted. */
+  if (m_minValue != -std::numeric_limits<double>::max ())
+    m_minValue += scalar;
+  if (m_maxValue != std::numeric_limits<double>::max ()
+      && m_maxValue != -std::numeric_limits<double>::max ())
+    m_maxValue += scalar;
 }
 
 void BspTreeAlpha::multiplyByScalar (const double &scalar)
@@ -251,6 +306,22 @@ void BspTreeAlpha::multiplyByScalar (const double &scalar)
     }
   else if (m_alphaVectors) 
     AlphaVector::multiplyVecByScalar (scalar, m_alphaVectors);
+
+  /* known bounds are scaled, a negative scalar swaps them. */
+  bool minKnown = (m_minValue != -std::numeric_limits<double>::max ());
+  bool maxKnown = (m_maxValue != std::numeric_limits<double>::max ()
+		   && m_maxValue != -std::numeric_limits<double>::max ());
+  if (scalar >= 0.0)
+    {
+      if (minKnown)
+	m_minValue *= scalar;
+      if (maxKnown)
+	m_maxValue *= scalar;
+    }
+  else if (minKnown && maxKnown)
+    setSubTreeBounds (m_maxValue * scalar, m_minValue * scalar);
+  else if (! isLeaf () || m_alphaVectors)
+    resetSubTreeBounds ();
 }
 
 
@@ -362,6 +433,7 @@ void BspTreeAlpha::leafCoverage (std::map<int, double> *coverage,
 void BspTreeAlpha::setLeavesValue (const double &val,
 				   double *low, double *high)
 {
+    resetSubTreeBounds ();
     if (isLeaf ())
     {
 	if (m_alphaVectors)
@@ -387,6 +459,70 @@ void BspTreeAlpha::setLeavesValue (const double &val,
     }
 }
 
+void BspTreeAlpha::updateLeafBounds (const double *low, const double *high)
+{
+  if (! m_alphaVectors || m_alphaVectors->empty ())
+    {
+      /* no value. */
+      setSubTreeBounds (-std::numeric_limits<double>::max (),
+			-std::numeric_limits<double>::max ());
+      return;
+    }
+
+  /* the leaf value is the max of its alpha vectors: the lower bound is the
+     max of their minima, the upper bound the max of their maxima. */
+  double minv = -std::numeric_limits<double>::max ();
+  double maxv = -std::numeric_limits<double>::max ();
+  for (size_t i=0; i<m_alphaVectors->size (); i++)
+    {
+      AlphaVector *av = (*m_alphaVectors)[i];
+      int n = av->getSize () - 1;  /* linear coefficients, the constant comes last. */
+      double amin = av->getAlphaNth (n), amax = amin;
+      for (int j=0; j<n; j++)
+	{
+	  double c = av->getAlphaNth (j);
+	  amin += c > 0.0 ? c * low[j] : c * high[j];
+	  amax += c > 0.0 ? c * high[j] : c * low[j];
+	}
+      minv = std::max (minv, amin);
+      maxv = std::max (maxv, amax);
+    }
+  setSubTreeBounds (minv, maxv);
+}
+
+void BspTreeAlpha::updateNodeBounds ()
+{
+  if (isLeaf ())
+    return;
+  BspTreeAlpha *btalt = static_cast<BspTreeAlpha*> (getLowerTree ());
+  BspTreeAlpha *btage = static_cast<BspTreeAlpha*> (getGreaterTree ());
+  setSubTreeBounds (std::min (btalt->getSubTreeMinValue (), btage->getSubTreeMinValue ()),
+		    std::max (btalt->getSubTreeMaxValue (), btage->getSubTreeMaxValue ()));
+}
+
+void BspTreeAlpha::updateSubTreeBounds (double *low, double *high)
+{
+  if (isLeaf ())
+    {
+      updateLeafBounds (low, high);
+      return;
+    }
+  
+  double b = high[getDimension ()];
+  high[getDimension ()] = getPosition ();
+  BspTreeAlpha *btalt = static_cast<BspTreeAlpha*> (getLowerTree ());
+  btalt->updateSubTreeBounds (low, high);
+  high[getDimension ()] = b;
+
+  b = low[getDimension ()];
+  low[getDimension ()] = getPosition ();
+  BspTreeAlpha *btage = static_cast<BspTreeAlpha*> (getGreaterTree ());
+  btage->updateSubTreeBounds (low, high);
+  low[getDimension ()] = b;
+
+  updateNodeBounds ();
+}
+
 /* printing */
 void BspTreeAlpha::print (std::ostream &out, double *low, double *high)
 {
@@ -22,6 +22,7 @@
 #include "BspTreeOperations.h"
 #include <vector>
 #include <map>
+#include <limits>
 
 namespace hmdp_base
 {
@@ -166,19 +167,92 @@ class BspTreeAlpha : public BspTree
   void transferData (const BspTree &bt);
 
  public:
+  /**
+   * \brief hash of the alpha vectors (values and actions) of this node.
+   * @sa BspTreeStore
+   */
+  size_t hashNodeData (const double &epsilon) const;
+
+  /**
+   * \brief node data equality: same alpha vectors in the same order, with the same
+   *        actions and values equal up to epsilon, and same value bounds.
+   * @sa BspTreeStore
+   */
+  bool isEqualNodeData (const BspTree &bt, const double &epsilon) const;
+
+  /**
+   * \brief upper bound on the values in the subtree from this node.
+   */
   double getSubTreeMaxValue () const { return m_maxValue; }
 
   void setSubTreeMaxValue (const double& mv) { m_maxValue = mv; }
 
-  virtual double updateSubTreeMaxValue () { return 0.0; };
+  /**
+   * \brief lower bound on the values in the subtree from this node.
+   */
+  double getSubTreeMinValue () const { return m_minValue; }
+
+  void setSubTreeMinValue (const double& mv) { m_minValue = mv; }
+
+  /**
+   * \brief sets both bounds on the values in the subtree from this node.
+   */
+  void setSubTreeBounds (const double &minv, const double &maxv)
+  { m_minValue = minv; m_maxValue = maxv; }
+
+  /**
+   * \brief copies the bounds of a tree whose domain contains the domain of this node,
+   *        and whose values are those of this node.
+   */
+  void copySubTreeBounds (const BspTreeAlpha &bta)
+  { m_minValue = bta.getSubTreeMinValue (); m_maxValue = bta.getSubTreeMaxValue (); }
+
+  /**
+   * \brief resets the bounds to unknown, i.e. [-max,max]. A tree with unknown bounds
+   *        neither dominates nor is dominated.
+   */
+  void resetSubTreeBounds ()
+  { m_minValue = -std::numeric_limits<double>::max ();
+    m_maxValue = std::numeric_limits<double>::max (); }
+
+  /**
+   * \brief whether all values of this subtree are strictly above the values of another
+   *        subtree, on a domain where both bounds hold. A leaf with no alpha vector has no value,
+   *        it is dominated by any other value, and dominates none.
+   * @param bta the other subtree,
+   * @param epsilon values within epsilon are equal (ties are not dominated).
+   */
+  bool dominates (const BspTreeAlpha &bta, const double &epsilon) const
+  { return m_minValue > bta.getSubTreeMaxValue () + epsilon; }
+
+  /**
+   * \brief sets the exact bounds of the values of this leaf, over a box: the min and max
+   *        of the alpha vectors are reached at the box corners.
+   * @param low lower bounds of the leaf box,
+   * @param high upper bounds of the leaf box.
+   */
+  void updateLeafBounds (const double *low, const double *high);
+
+  /**
+   * \brief sets the bounds of this node from the bounds of its subtrees (non recursive).
+   */
+  void updateNodeBounds ();
+
+  /**
+   * \brief recursively sets the bounds of the subtree from this node, bottom-up.
+   * @param low lower bounds of the subtree box,
+   * @param high upper bounds of the subtree box.
+   */
+  void updateSubTreeBounds (double *low, double *high);
 
   void setLeavesValue (const double &val, double *low, double *high);
 
  protected:
   std::vector<AlphaVector*>* m_alphaVectors;  /**< alpha vectors in tree leaves */
   
-  double m_maxValue; /**< max value in the subtree from this node, 
-			  used in asymetric operators (constant case only). */
+  double m_minValue; /**< lower bound on the values in the subtree from this node. */
+  double m_maxValue; /**< upper bound on the values in the subtree from this node,
+			  used in asymetric operators (branch and bound on the max). */
 
  private:
 };
@@ -23,6 +23,7 @@
 #include "PiecewiseConstantValueFunction.h"
 #include "PiecewiseLinearValueFunction.h"
 #include "ContinuousStateDistribution.h"
+#include "BspTreeStore.h"
 #ifdef HAVE_CSA
 #include "BspTreeCSA.h"
 #endif
@@ -64,58 +65,100 @@ bool BspTreeOperations::m_piecesMergingByValue = false;
 bool BspTreeOperations::m_piecesMergingByAction = false;
 bool BspTreeOperations::m_piecesMergingEquality = false;  /* CHANGED: default but requires m_piecesMerging true. */
 
-BspTree* BspTreeOperations::createTree (const int &dim)
+/* context of the innermost operation running on this thread. */
+static thread_local const BspOpContext *s_currentContext = 0;
+
+BspOpContext::BspOpContext ()
+  : m_outputType (BspTreeOperations::m_currentOutputType),
+    m_intersectionType (BspTreeOperations::m_currentIntersectionType),
+    m_bspBalance (BspTreeOperations::m_bspBalance),
+    m_asymetricOperators (BspTreeOperations::m_asymetricOperators),
+    m_piecesMerging (BspTreeOperations::m_piecesMerging),
+    m_piecesMergingByValue (BspTreeOperations::m_piecesMergingByValue),
+    m_piecesMergingByAction (BspTreeOperations::m_piecesMergingByAction),
+    m_piecesMergingEquality (BspTreeOperations::m_piecesMergingEquality),
+    m_epsilon (Alg::m_doubleEpsilon), m_pool (NULL)
+{
+}
+
+BspOpContext::BspOpContext (const BspTreeIntersectionType &btit)
+  : BspOpContext ()
+{
+  m_intersectionType = btit;
+}
+
+BspOpContextScope::BspOpContextScope (const BspOpContext &ctx)
+  : m_previous (s_currentContext)
+{
+  s_currentContext = &ctx;
+}
+
+BspOpContextScope::~BspOpContextScope ()
+{
+  s_currentContext = m_previous;
+}
+
+const BspOpContext& BspTreeOperations::context ()
+{
+  if (s_currentContext)
+    return *s_currentContext;
+  static thread_local BspOpContext globalCtx;
+  globalCtx = BspOpContext ();  /* refresh from the global options. */
+  return globalCtx;
+}
+
+BspTree* BspTreeOperations::createTree (const BspOpContext &ctx, const int &dim)
 {
   BspTree *res = 0;
-  if (BspTreeOperations::m_currentOutputType == BspTreeT)
+  if (ctx.m_outputType == BspTreeT)
     res = new BspTree (dim);
-  else if (BspTreeOperations::m_currentOutputType == ContinuousTransitionT)
+  else if (ctx.m_outputType == ContinuousTransitionT)
     {
       ContinuousTransition *ct = new ContinuousTransition (dim);
       res = ct;
     }
-  else if (BspTreeOperations::m_currentOutputType == ContinuousRewardT)
+  else if (ctx.m_outputType == ContinuousRewardT)
     {
       ContinuousReward *cr = new ContinuousReward (dim);
       res = cr;
     }
-  else if (BspTreeOperations::m_currentOutputType == PiecewiseConstantRewardT)
+  else if (ctx.m_outputType == PiecewiseConstantRewardT)
     {
       PiecewiseConstantReward *pcr = new PiecewiseConstantReward (dim);
       res = pcr;
     }
-  else if (BspTreeOperations::m_currentOutputType == PiecewiseLinearRewardT)
+  else if (ctx.m_outputType == PiecewiseLinearRewardT)
     {
       PiecewiseLinearReward *plr = new PiecewiseLinearReward (dim);
       res = plr;
     }
-  else if (BspTreeOperations::m_currentOutputType == ValueFunctionT)
+  else if (ctx.m_outputType == ValueFunctionT)
     {
       ValueFunction *vf = new ValueFunction (dim);
       res = vf;
     }
-  else if (BspTreeOperations::m_currentOutputType == PiecewiseConstantVFT)
+  else if (ctx.m_outputType == PiecewiseConstantVFT)
     {
       PiecewiseConstantValueFunction *pcvf = new PiecewiseConstantValueFunction (dim);
       res = pcvf;
     }
-  else if (BspTreeOperations::m_currentOutputType == PiecewiseLinearVFT)
+  else if (ctx.m_outputType == PiecewiseLinearVFT)
     {
       PiecewiseLinearValueFunction *plvf = new PiecewiseLinearValueFunction (dim);
       res = plvf;
     }
-  else if (BspTreeOperations::m_currentOutputType == ContinuousOutcomeT)
+  else if (ctx.m_outputType == ContinuousOutcomeT)
     {
       ContinuousOutcome *co = new ContinuousOutcome (dim);
       res = co;
     }
-  else if (BspTreeOperations::m_currentOutputType == ContinuousStateDistributionT)
+  else if (ctx.m_outputType == ContinuousStateDistributionT)
     {
       ContinuousStateDistribution *csd = new ContinuousStateDistribution (dim);
       res = csd;
     }
 #ifdef HAVE_CSA
-  else if (BspTreeOperations::m_currentOutputType == BspTreeCSAT)
+  else if (ctx.m_outputType == BspTreeCSAT)
     {
       BspTreeCSA *csa = new BspTreeCSA(dim);
       res = csa;
@@ -126,58 +169,59 @@ BspTree* BspTreeOperations::createTree (const int &dim)
   return res;
 }
 
-BspTree* BspTreeOperations::createTree (const int &dim, const int &d, const double &pos)
+BspTree* BspTreeOperations::createTree (const BspOpContext &ctx, const int &dim,
+					const int &d, const double &pos)
 {
   BspTree *res = 0;
-  if (BspTreeOperations::m_currentOutputType == BspTreeT)
+  if (ctx.m_outputType == BspTreeT)
     res = new BspTree (dim, d, pos);
-  else if (BspTreeOperations::m_currentOutputType == ContinuousTransitionT)
+  else if (ctx.m_outputType == ContinuousTransitionT)
     {
       ContinuousTransition *ct = new ContinuousTransition (dim, d, pos);
       res = ct;
     }
-  else if (BspTreeOperations::m_currentOutputType == ContinuousRewardT)
+  else if (ctx.m_outputType == ContinuousRewardT)
     {
       ContinuousReward *cr = new ContinuousReward (dim, d, pos);
       res = cr;
     }
-  else if (BspTreeOperations::m_currentOutputType == PiecewiseConstantRewardT)
+  else if (ctx.m_outputType == PiecewiseConstantRewardT)
     {
       PiecewiseConstantReward *pcr = new PiecewiseConstantReward (dim, d, pos);
       res = pcr;
     }
-  else if (BspTreeOperations::m_currentOutputType == PiecewiseLinearRewardT)
+  else if (ctx.m_outputType == PiecewiseLinearRewardT)
     {
       PiecewiseLinearReward *plr = new PiecewiseLinearReward (dim, d, pos);
       res = plr;
     }
-  else if (BspTreeOperations::m_currentOutputType == ValueFunctionT)
+  else if (ctx.m_outputType == ValueFunctionT)
     {
       ValueFunction *vf = new ValueFunction (dim, d, pos);
       res = vf;
     }
-  else if (BspTreeOperations::m_currentOutputType == PiecewiseConstantVFT)
+  else if (ctx.m_outputType == PiecewiseConstantVFT)
     {
       PiecewiseConstantValueFunction *pcvf = new PiecewiseConstantValueFunction (dim, d, pos);
       res = pcvf;
     }
-  else if (BspTreeOperations::m_currentOutputType == PiecewiseLinearVFT)
+  else if (ctx.m_outputType == PiecewiseLinearVFT)
     {
       PiecewiseLinearValueFunction *plvf = new PiecewiseLinearValueFunction (dim, d, pos);
       res = plvf;
     }
-  else if (BspTreeOperations::m_currentOutputType == ContinuousOutcomeT)
+  else if (ctx.m_outputType == ContinuousOutcomeT)
     {
       ContinuousOutcome *co = new ContinuousOutcome (dim, d, pos);
       res = co;
     }
-  else if (BspTreeOperations::m_currentOutputType == ContinuousStateDistributionT)
+  else if (ctx.m_outputType == ContinuousStateDistributionT)
     {
       ContinuousStateDistribution *csd = new ContinuousStateDistribution (dim, d, pos);
       res = csd;
     }
 #ifdef HAVE_CSA
-  else if (BspTreeOperations::m_currentOutputType == BspTreeCSAT)
+  else if (ctx.m_outputType == BspTreeCSAT)
     {
       BspTreeCSA *csa = new BspTreeCSA(dim,d,pos);
       res = csa;
@@ -188,42 +232,42 @@ BspTree* BspTreeOperations::createTree (const int &dim, const int &d, const doub
   return res;
 }
 
-BspTree* BspTreeOperations::createTree (BspTree *bt)
+BspTree* BspTreeOperations::createTree (const BspOpContext &ctx, BspTree *bt)
 {
   BspTree *res = 0;
-  if (BspTreeOperations::m_currentOutputType == BspTreeT)
+  if (ctx.m_outputType == BspTreeT)
     res = new BspTree (*bt);
-  else if (BspTreeOperations::m_currentOutputType == ContinuousTransitionT)
+  else if (ctx.m_outputType == ContinuousTransitionT)
     {
       ContinuousTransition *cbt = static_cast<ContinuousTransition*> (bt);
       ContinuousTransition *ct = new ContinuousTransition (*cbt);
       res = ct;
     }
-  else if (BspTreeOperations::m_currentOutputType == ContinuousRewardT)
+  else if (ctx.m_outputType == ContinuousRewardT)
     {
       ContinuousReward *cbr = static_cast<ContinuousReward*> (bt);
       ContinuousReward *cr = new ContinuousReward (*cbr);
       res = cr;
     }
-  else if (BspTreeOperations::m_currentOutputType == PiecewiseConstantRewardT)
+  else if (ctx.m_outputType == PiecewiseConstantRewardT)
     {
       PiecewiseConstantReward *cpcr = static_cast<PiecewiseConstantReward*> (bt);
       PiecewiseConstantReward *pcr = new PiecewiseConstantReward (*cpcr);
       res = pcr;
     }
-  else if (BspTreeOperations::m_currentOutputType == PiecewiseLinearRewardT)
+  else if (ctx.m_outputType == PiecewiseLinearRewardT)
     {
       PiecewiseLinearReward *cplr = static_cast<PiecewiseLinearReward*> (bt);
       PiecewiseLinearReward *plr = new PiecewiseLinearReward (*cplr);
       res = plr;
     }
-  else if (BspTreeOperations::m_currentOutputType == ValueFunctionT)
+  else if (ctx.m_outputType == ValueFunctionT)
     {
       ValueFunction *cvf = static_cast<ValueFunction*> (bt);
       ValueFunction *vf = new ValueFunction (*cvf);
       res = vf;
     }
-  else if (BspTreeOperations::m_currentOutputType == PiecewiseConstantVFT)
+  else if (ctx.m_outputType == PiecewiseConstantVFT)
     {
       PiecewiseConstantValueFunction *pcvf = 0;
       if (bt->getType () == PiecewiseConstantVFT)
@@ -248,7 +292,7 @@ BspTree* BspTreeOperations::createTree (BspTree *bt)
 	}
       res = pcvf;
     }
-  else if (BspTreeOperations::m_currentOutputType == PiecewiseLinearVFT)
+  else if (ctx.m_outputType == PiecewiseLinearVFT)
     {
       PiecewiseLinearValueFunction *plvf = 0;
       if (bt->getType () == PiecewiseLinearVFT)
@@ -279,13 +323,13 @@ BspTree* BspTreeOperations::createTree (BspTree *bt)
 	}
       res = plvf;
     }
-  else if (BspTreeOperations::m_currentOutputType == ContinuousOutcomeT)
+  else if (ctx.m_outputType == ContinuousOutcomeT)
     {
       ContinuousOutcome *cco = static_cast<ContinuousOutcome*> (bt);
       ContinuousOutcome *co = new ContinuousOutcome (*cco);
       res = co;
     }
-  else if (BspTreeOperations::m_currentOutputType == ContinuousStateDistributionT)
+  else if (ctx.m_outputType == ContinuousStateDistributionT)
     {
       ContinuousStateDistribution *csd = 0;
       if (bt->getType () == ContinuousStateDistributionT)
@@ -301,7 +345,7 @@ BspTree* BspTreeOperations::createTree (BspTree *bt)
       res = csd;
   }
 #ifdef HAVE_CSA
-  else if (BspTreeOperations::m_currentOutputType == BspTreeCSAT)
+  else if (ctx.m_outputType == BspTreeCSAT)
     {
       BspTreeCSA *ccsa = static_cast<BspTreeCSA*>(bt);
       BspTreeCSA *csa = new BspTreeCSA(*ccsa);
@@ -313,10 +357,40 @@ BspTree* BspTreeOperations::createTree (BspTree *bt)
   return res;
 }
 
+BspTree* BspTreeOperations::createTree (const int &dim)
+{
+  return BspTreeOperations::createTree (BspOpContext (), dim);
+}
+
+BspTree* BspTreeOperations::createTree (const int &dim, const int &d, const double &pos)
+{
+  return BspTreeOperations::createTree (BspOpContext (), dim, d, pos);
+}
+
+BspTree* BspTreeOperations::createTree (BspTree *bt)
+{
+  return BspTreeOperations::createTree (BspOpContext (), bt);
+}
+
 BspTree* BspTreeOperations::copyTree (BspTree *bt)
 {
-  BspTreeOperations::m_currentOutputType = bt->getType ();
-  return BspTreeOperations::createTree (bt);
+  BspOpContext ctx;
+  ctx.m_outputType = bt->getType ();
+  return BspTreeOperations::createTree (ctx, bt);
+}
+
+BspTree* BspTreeOperations::shareTree (BspTree *bt)
+{
+  if (bt->isShared ())
+    return BspTreeStore::acquire (bt);
+  return BspTreeOperations::copyTree (bt);
+}
+
+BspTree* BspTreeOperations::shareTree (const BspOpContext &ctx, BspTree *bt)
+{
+  if (bt->isShared () && bt->getType () == ctx.m_outputType)
+    return BspTreeStore::acquire (bt);
+  return BspTreeOperations::createTree (ctx, bt);
 }
 
 BspTreeType BspTreeOperations::lookupOutputTypeTable (BspTreeType btt1, BspTreeType btt2)
@@ -341,10 +415,17 @@ BspTreeType BspTreeOperations::lookupOutputTypeTable (BspTreeType btt1, BspTreeT
 BspTree* BspTreeOperations::createTree (const int &dim, const int &d, const double &pos,
 					const double &max_value)
 {
-  BspTree *bt = BspTreeOperations::createTree (dim, d, pos);
+  return BspTreeOperations::createTree (BspOpContext (), dim, d, pos, max_value);
+}
+
+BspTree* BspTreeOperations::createTree (const BspOpContext &ctx, const int &dim,
+					const int &d, const double &pos,
+					const double &max_value)
+{
+  BspTree *bt = BspTreeOperations::createTree (ctx, dim, d, pos);
   
-  if (BspTreeOperations::m_asymetricOperators
-      && BspTreeOperations::m_currentIntersectionType == BTI_MAX
+  if (ctx.m_asymetricOperators
+      && ctx.m_intersectionType == BTI_MAX
 	&& (bt->getType () == PiecewiseConstantVFT
 	    || bt->getType () == PiecewiseConstantRewardT))
     {
@@ -364,94 +445,41 @@ BspTree* BspTreeOperations::createTree (const int &dim, const int &d, const doub
   return bt;
 }
 
-void BspTreeOperations::setSubTreeMaxValue (BspTree *bt, BspTree *btmv)
+void BspTreeOperations::setSubTreeBounds (BspTree *bt, BspTree *btmv)
 {
-  if (BspTreeOperations::m_asymetricOperators
-      && BspTreeOperations::m_currentIntersectionType == BTI_MAX
-      && (bt->getType () == PiecewiseConstantVFT
-	  || bt->getType () == PiecewiseConstantRewardT))
-    {
-      double max_value = 0.0;
-      
-      if (bt->getType () == PiecewiseConstantVFT)
-	{
-	  PiecewiseConstantValueFunction *pcvf = static_cast<PiecewiseConstantValueFunction*> (bt);
-	  if (btmv->getType () == PiecewiseConstantRewardT)
-	    {
-	      PiecewiseConstantReward *pcrmv = static_cast<PiecewiseConstantReward*> (btmv);
-	      max_value = pcrmv->getSubTreeMaxValue ();
-	    }
-	  else if (btmv->getType () == PiecewiseConstantVFT)
-	    {
-	      PiecewiseConstantValueFunction *pcvfmv 
-		= static_cast<PiecewiseConstantValueFunction*> (btmv);
-	      max_value = pcvfmv->getSubTreeMaxValue ();
-	    }
-	  pcvf->setSubTreeMaxValue (max_value);
-	}
-      else if (bt->getType () == PiecewiseConstantRewardT)
-	{
-	  PiecewiseConstantReward *pcr = static_cast<PiecewiseConstantReward*> (bt);
-	  if (btmv->getType () == PiecewiseConstantRewardT)
-	    {
-	      PiecewiseConstantReward *pcrmv = static_cast<PiecewiseConstantReward*> (btmv);
-	      max_value = pcrmv->getSubTreeMaxValue ();
-	    }
-	  else if (btmv->getType () == PiecewiseConstantVFT)
-	    {
-	      PiecewiseConstantValueFunction *pcvfmv 
-		= static_cast<PiecewiseConstantValueFunction*> (btmv);
-	      max_value = pcvfmv->getSubTreeMaxValue ();
-	    }
-	  pcr->setSubTreeMaxValue (max_value);
-	}    
-    }
+  BspTreeOperations::setSubTreeBounds (BspOpContext (), bt, *btmv);
 }
 
-void BspTreeOperations::setSubTreeMaxValue (BspTree *bt, const BspTree &btmv)
+void BspTreeOperations::setSubTreeBounds (BspTree *bt, const BspTree &btmv)
 {
-  if (BspTreeOperations::m_asymetricOperators
-      && BspTreeOperations::m_currentIntersectionType == BTI_MAX
-      && (bt->getType () == PiecewiseConstantVFT
-	  || bt->getType () == PiecewiseConstantRewardT))
-    {
-      double max_value = 0.0;
-      
-      if (bt->getType () == PiecewiseConstantVFT)
-	{
-	  PiecewiseConstantValueFunction *pcvf = static_cast<PiecewiseConstantValueFunction*> (bt);
-	  if (btmv.getType () == PiecewiseConstantRewardT)
-	    {
-	      const PiecewiseConstantReward &pcrmv = 
-		static_cast<const PiecewiseConstantReward&> (btmv);
-	      max_value = pcrmv.getSubTreeMaxValue ();
-	    }
-	  else if (btmv.getType () == PiecewiseConstantVFT)
-	    {
-	      const PiecewiseConstantValueFunction &pcvfmv 
-		= static_cast<const PiecewiseConstantValueFunction&> (btmv);
-	      max_value = pcvfmv.getSubTreeMaxValue ();
-	    }
-	  pcvf->setSubTreeMaxValue (max_value);
-	}
-      else if (bt->getType () == PiecewiseConstantRewardT)
-	{
-	  PiecewiseConstantReward *pcr = static_cast<PiecewiseConstantReward*> (bt);
-	  if (btmv.getType () == PiecewiseConstantRewardT)
-	    {
-	      const PiecewiseConstantReward &pcrmv 
-		= static_cast<const PiecewiseConstantReward&> (btmv);
-	      max_value = pcrmv.getSubTreeMaxValue ();
-	    }
-	  else if (btmv.getType () == PiecewiseConstantVFT)
-	    {
-	      const PiecewiseConstantValueFunction &pcvfmv 
-		= static_cast<const PiecewiseConstantValueFunction&> (btmv);
-	      max_value = pcvfmv.getSubTreeMaxValue ();
-	    }
-	  pcr->setSubTreeMaxValue (max_value);
-	}    
-    }
+  BspTreeOperations::setSubTreeBounds (BspOpContext (), bt, btmv);
+}
+
+bool BspTreeOperations::hasSubTreeBounds (const BspTree &bt)
+{
+  return bt.getType () == BspTreeAlphaT
+    || bt.getType () == ValueFunctionT
+    || bt.getType () == PiecewiseConstantVFT
+    || bt.getType () == PiecewiseLinearVFT
+    || bt.getType () == ContinuousRewardT
+    || bt.getType () == PiecewiseConstantRewardT
+    || bt.getType () == PiecewiseLinearRewardT;
+}
+
+void BspTreeOperations::setSubTreeBounds (const BspOpContext &ctx, BspTree *bt,
+					  const BspTree &btmv)
+{
+  if (ctx.m_asymetricOperators
+      && BspTreeOperations::hasSubTreeBounds (*bt)
+      && BspTreeOperations::hasSubTreeBounds (btmv))
+    static_cast<BspTreeAlpha*> (bt)->copySubTreeBounds (static_cast<const BspTreeAlpha&> (btmv));
+}
+
+void BspTreeOperations::updateSubTreeBounds (const BspOpContext &ctx, BspTree *bt)
+{
+  if (ctx.m_asymetricOperators
+      && BspTreeOperations::hasSubTreeBounds (*bt))
+    static_cast<BspTreeAlpha*> (bt)->updateNodeBounds ();
 }
 
 void BspTreeOperations::swapDimensions(BspTree *bt, int swapTable[])
@@ -469,7 +497,7 @@ void BspTreeOperations::swapDimensions(BspTree *bt, int swapTable[])
 }
 
 /* btr is a leaf. */
-BspTree* BspTreeOperations::intersectWithCell (BspTree *btr, BspTree *bt, 
+BspTree* BspTreeOperations::intersectWithCell (const BspOpContext &ctx, BspTree *btr, BspTree *bt, 
 					       double *low, double *high)
   {
     BspTree *bsp_n, *nbtr=0, *nbt=0;
@@ -479,9 +507,9 @@ BspTree* BspTreeOperations::intersectWithCell (BspTree *btr, BspTree *bt,
 	/* return a 'dead-end' leaf in case the tile is too small. */
 	for (int d=0; d<btr->getSpaceDimension (); d++)
 	  {
-	    if (Alg::REqual (high[d], low[d], Alg::m_doubleEpsilon))
+	    if (Alg::REqual (high[d], low[d], ctx.m_epsilon))
 	      {
-		return BspTreeOperations::createTree (btr->getSpaceDimension ());
+		return BspTreeOperations::createTree (ctx, btr->getSpaceDimension ());
 	      }
 	  }
 
@@ -489,20 +517,20 @@ BspTree* BspTreeOperations::intersectWithCell (BspTree *btr, BspTree *bt,
 	   without the need for partitioning. This can lead to tree type mismatch. */
 	if (btr->getType () != bt->getType ())
 	  {
-	    if (btr->getType () != BspTreeOperations::m_currentOutputType
-		&& bt->getType () != BspTreeOperations::m_currentOutputType)
+	    if (btr->getType () != ctx.m_outputType
+		&& bt->getType () != ctx.m_outputType)
 	      {
-		nbtr = BspTreeOperations::createTree (btr);
-		nbt = BspTreeOperations::createTree (bt);
+		nbtr = BspTreeOperations::createTree (ctx, btr);
+		nbt = BspTreeOperations::createTree (ctx, bt);
 	      }
-	    else if (btr->getType () != BspTreeOperations::m_currentOutputType)
+	    else if (btr->getType () != ctx.m_outputType)
 	      {
-		nbtr = BspTreeOperations::createTree (btr);
+		nbtr = BspTreeOperations::createTree (ctx, btr);
 		nbt = bt;
 	      }
-	    else if (bt->getType () != BspTreeOperations::m_currentOutputType)
+	    else if (bt->getType () != ctx.m_outputType)
 	      {
-		nbt = BspTreeOperations::createTree (bt);
+		nbt = BspTreeOperations::createTree (ctx, bt);
 		nbtr = btr;
 	      }
 	  }
@@ -512,31 +540,35 @@ BspTree* BspTreeOperations::intersectWithCell (BspTree *btr, BspTree *bt,
 	    nbt = bt;
 	  }
 
-	bsp_n = BspTreeOperations::createTree (btr->getSpaceDimension ());
+	bsp_n = BspTreeOperations::createTree (ctx, btr->getSpaceDimension ());
 	
 	/* perform the correct intersection of the leaves */
-	if (BspTreeOperations::m_currentIntersectionType == BTI_INIT)
+	if (ctx.m_intersectionType == BTI_INIT)
 	  bsp_n->leafDataIntersectInit (*nbt, *nbtr, low, high);  /* virtual call */
-	else if (BspTreeOperations::m_currentIntersectionType == BTI_MAX)
+	else if (ctx.m_intersectionType == BTI_MAX)
 	  bsp_n->leafDataIntersectMax (*nbt, *nbtr, low, high);  /* virtual call */
-	else if (BspTreeOperations::m_currentIntersectionType == BTI_PLUS)
+	else if (ctx.m_intersectionType == BTI_PLUS)
 	  bsp_n->leafDataIntersectPlus (*nbt, *nbtr, low, high);
-	else if (BspTreeOperations::m_currentIntersectionType == BTI_MINUS)
+	else if (ctx.m_intersectionType == BTI_MINUS)
 	  bsp_n->leafDataIntersectMinus (*nbt, *nbtr, low, high);
-	else if (BspTreeOperations::m_currentIntersectionType == BTI_MULT)
+	else if (ctx.m_intersectionType == BTI_MULT)
 	  bsp_n->leafDataIntersectMult (*nbt, *nbtr, low, high);
-	else if (BspTreeOperations::m_currentIntersectionType == BTI_CSD_DIFF)
+	else if (ctx.m_intersectionType == BTI_CSD_DIFF)
 	  bsp_n->leafDataIntersectCsdDiff (*nbt, *nbtr, low, high);
-	else if (BspTreeOperations::m_currentIntersectionType == BTI_UNION)
+	else if (ctx.m_intersectionType == BTI_UNION)
 	  bsp_n->leafDataIntersectUnion (*nbt, *nbtr, low, high);
 	else std::cout << "Intersection type unknown: leaves data are not processed !\n";
 
-	if (btr->getType () != BspTreeOperations::m_currentOutputType)
+	if (ctx.m_asymetricOperators
+	    && BspTreeOperations::hasSubTreeBounds (*bsp_n))
+	  static_cast<BspTreeAlpha*> (bsp_n)->updateLeafBounds (low, high);
+
+	if (btr->getType () != ctx.m_outputType)
 	  {
 	    BspTree::deleteBspTree (nbtr);
 	    nbtr = 0;
 	  }
-	if (bt->getType () != BspTreeOperations::m_currentOutputType)
+	if (bt->getType () != ctx.m_outputType)
 	  {
 	    BspTree::deleteBspTree (nbt);
 	    nbt = 0;
@@ -544,112 +576,140 @@ BspTree* BspTreeOperations::intersectWithCell (BspTree *btr, BspTree *bt,
 	return bsp_n;
       }
 
-    bsp_n = BspTreeOperations::createTree (bt->getSpaceDimension (), bt->getDimension (), bt->getPosition ());
-
-    double bound;
-
-    /* NEW: asymetric max. */
-    if (BspTreeOperations::m_asymetricOperators
-	&& BspTreeOperations::m_currentIntersectionType == BTI_MAX
+    /* asymetric max, branch and bound: a leaf whose values are all above the values
+       of a subtree is the max over the whole subtree, and a subtree whose values are
+       all above the values of a leaf is the max over the leaf cell. */
+    if (ctx.m_asymetricOperators
+	&& ctx.m_intersectionType == BTI_MAX
+	&& btr->getType () == ctx.m_outputType
+	&& bt->getType () == ctx.m_outputType
 	&& (btr->getType () == PiecewiseConstantVFT
-	    || btr->getType () == PiecewiseConstantRewardT))
+	    || btr->getType () == PiecewiseConstantRewardT
+	    || btr->getType () == PiecewiseLinearVFT))
       {
 	BspTreeAlpha *btr_leaf = static_cast<BspTreeAlpha*> (btr);
 	BspTreeAlpha *bt_subtree = static_cast<BspTreeAlpha*> (bt);
 
-	//debug
-	/* std::cout << "btr leaf max value: " << btr_leaf->getSubTreeMaxValue ()
-	   << " -- bt subtree max value: " << bt_subtree->getSubTreeMaxValue ()
-	   << std::endl; */
-	//debug
-
-	if (btr_leaf->getSubTreeMaxValue () > bt_subtree->getSubTreeMaxValue ())
+	if (btr_leaf->dominates (*bt_subtree, ctx.m_epsilon))
 	  {
-	    bsp_n->transferData (*btr);
+	    /* the max with a leaf with no value is the max with any dominated leaf. */
+	    BspTree *bt_none = BspTreeOperations::createTree (ctx, btr->getSpaceDimension ());
+	    bsp_n = BspTreeOperations::createTree (ctx, btr->getSpaceDimension ());
+	    bsp_n->leafDataIntersectMax (*bt_none, *btr, low, high);  /* virtual call */
+	    BspTree::deleteBspTree (bt_none);
+
+	    /* the max of linear value functions unionizes the goal sets. */
+	    if (btr->getType () == PiecewiseLinearVFT)
+	      {
+		ValueFunction *vf_n = static_cast<ValueFunction*> (bsp_n);
+		std::set<int> goals;
+		static_cast<ValueFunction*> (bt)->collectAchievedGoals (&goals);
+		for (std::set<int>::const_iterator gi = goals.begin (); gi != goals.end (); gi++)
+		  if (! vf_n->getAchievedGoals ()
+		      || ! Alg::inVectorInt ((*gi), *vf_n->getAchievedGoals ()))
+		    vf_n->addGoal ((*gi));
+	      }
+	    static_cast<BspTreeAlpha*> (bsp_n)->updateLeafBounds (low, high);
+	    return bsp_n;
+	  }
+	else if (bt_subtree->dominates (*btr_leaf, ctx.m_epsilon))
+	  {
+	    bsp_n = BspTreeOperations::cropTree (ctx, bt, low, high);
+	    static_cast<BspTreeAlpha*> (bsp_n)->copySubTreeBounds (*bt_subtree);
+
+	    /* the max of linear value functions unionizes the goal sets. */
+	    if (btr->getType () == PiecewiseLinearVFT)
+	      static_cast<ValueFunction*> (bsp_n)->addGoalsToLeaves (*static_cast<ValueFunction*> (btr));
 	    return bsp_n;
 	  }
       }
+
+    bsp_n = BspTreeOperations::createTree (ctx, bt->getSpaceDimension (), bt->getDimension (), bt->getPosition ());
+
+    double bound;
     
     /* if leaf is too small, stop here. */
-    if (Alg::REqual (bsp_n->getPosition (), low[bsp_n->getDimension ()], Alg::m_doubleEpsilon))
-      bsp_n->setLowerTree (BspTreeOperations::createTree (bsp_n->getSpaceDimension ())); /* leaf. */
+    if (Alg::REqual (bsp_n->getPosition (), low[bsp_n->getDimension ()], ctx.m_epsilon))
+      bsp_n->setLowerTree (BspTreeOperations::createTree (ctx, bsp_n->getSpaceDimension ())); /* leaf. */
     else 
       {
 	bound = high[bsp_n->getDimension ()];
 	high[bsp_n->getDimension ()] = bsp_n->getPosition ();
-	bsp_n->setLowerTree (BspTreeOperations::intersectWithCell (btr, bt->getLowerTree (), 
+	bsp_n->setLowerTree (BspTreeOperations::intersectWithCell (ctx, btr, bt->getLowerTree (), 
 								   low, high));
 	high[bsp_n->getDimension ()] = bound;
       }
 
     /* if leaf is too small, stop here. */
-    if (Alg::REqual (bsp_n->getPosition (), high[bsp_n->getDimension ()], Alg::m_doubleEpsilon))
-      bsp_n->setGreaterTree (BspTreeOperations::createTree (bsp_n->getSpaceDimension ())); /* leaf. */
+    if (Alg::REqual (bsp_n->getPosition (), high[bsp_n->getDimension ()], ctx.m_epsilon))
+      bsp_n->setGreaterTree (BspTreeOperations::createTree (ctx, bsp_n->getSpaceDimension ())); /* leaf. */
     else
       {
 	bound = low[bsp_n->getDimension ()];
 	low[bsp_n->getDimension ()] = bsp_n->getPosition ();
-	bsp_n->setGreaterTree (BspTreeOperations::intersectWithCell (btr, bt->getGreaterTree (), 
+	bsp_n->setGreaterTree (BspTreeOperations::intersectWithCell (ctx, btr, bt->getGreaterTree (), 
 								     low, high));
 	low[bsp_n->getDimension ()] = bound;
       }    
 
+    BspTreeOperations::updateSubTreeBounds (ctx, bsp_n);
     return bsp_n;
   }
 
-BspTree* BspTreeOperations::intersectLowerHalf (const BspTree &btr, const int &d, const double &pos,
+BspTree* BspTreeOperations::intersectLowerHalf (const BspOpContext &ctx, const BspTree &btr,
+						const int &d, const double &pos,
 						double *low, double *high)
 {
   BspTree *bsp_n;
   
   if (btr.isLeaf ())
     {
-      bsp_n = BspTreeOperations::createTree (btr.getSpaceDimension ()); /* warning pos is set to 0 */
+      bsp_n = BspTreeOperations::createTree (ctx, btr.getSpaceDimension ()); /* warning pos is set to 0 */
       bsp_n->transferData (btr); /* virtual call */
       return bsp_n;
     }
 
   if (d == btr.getDimension ())   /* parallel to current tree's plane */
     {
-      if (Alg::REqual (pos, btr.getPosition (), Alg::m_doubleEpsilon))
+      if (Alg::REqual (pos, btr.getPosition (), ctx.m_epsilon))
 	{
-	  if (Alg::REqual (btr.getPosition (), low[d], Alg::m_doubleEpsilon))
-	    return BspTreeOperations::createTree (btr.getSpaceDimension ());
+	  if (Alg::REqual (btr.getPosition (), low[d], ctx.m_epsilon))
+	    return BspTreeOperations::createTree (ctx, btr.getSpaceDimension ());
 	  else 
 	    {
-	      bsp_n = BspTreeOperations::intersectLowerHalf (*btr.getLowerTree (), d, pos, low, high);
-	      BspTreeOperations::setSubTreeMaxValue (bsp_n, btr.getLowerTree ());
+	      bsp_n = BspTreeOperations::intersectLowerHalf (ctx, *btr.getLowerTree (), d, pos, low, high);
+	      BspTreeOperations::setSubTreeBounds (ctx, bsp_n, *btr.getLowerTree ());
 	      return bsp_n;
 	    }
 	}
       else if (btr.getPosition () < pos)
         {
-          bsp_n = BspTreeOperations::createTree (btr.getSpaceDimension (), btr.getDimension (), 
+          bsp_n = BspTreeOperations::createTree (ctx, btr.getSpaceDimension (), btr.getDimension (), 
 						 btr.getPosition ());
-          bsp_n->setLowerTree (BspTreeOperations::createTree (btr.getLowerTree ()));
-          bsp_n->setGreaterTree (BspTreeOperations::intersectLowerHalf(*btr.getGreaterTree (), d, pos, low, high));
-	  BspTreeOperations::setSubTreeMaxValue (bsp_n, btr);
+          bsp_n->setLowerTree (BspTreeOperations::shareTree (ctx, btr.getLowerTree ()));
+          bsp_n->setGreaterTree (BspTreeOperations::intersectLowerHalf (ctx, *btr.getGreaterTree (), d, pos, low, high));
+	  BspTreeOperations::setSubTreeBounds (ctx, bsp_n, btr);
           return bsp_n;
         }
       else  /* position > pos */
         {
-          bsp_n = BspTreeOperations::intersectLowerHalf (*btr.getLowerTree (), d, pos, low, high);
-	  BspTreeOperations::setSubTreeMaxValue (bsp_n, btr.getLowerTree ());
+          bsp_n = BspTreeOperations::intersectLowerHalf (ctx, *btr.getLowerTree (), d, pos, low, high);
+	  BspTreeOperations::setSubTreeBounds (ctx, bsp_n, *btr.getLowerTree ());
 	  return bsp_n;
         }
     }
   else  /* cuts through this tree partition plane */
     {
-      bsp_n = BspTreeOperations::createTree (btr.getSpaceDimension (), 
+      bsp_n = BspTreeOperations::createTree (ctx, btr.getSpaceDimension (), 
 					     btr.getDimension (), btr.getPosition ());
-      bsp_n->setLowerTree (BspTreeOperations::intersectLowerHalf (*btr.getLowerTree (), d, pos, low, high));
-      bsp_n->setGreaterTree (BspTreeOperations::intersectLowerHalf (*btr.getGreaterTree (), d, pos, low, high));
-      BspTreeOperations::setSubTreeMaxValue (bsp_n, btr);
+      bsp_n->setLowerTree (BspTreeOperations::intersectLowerHalf (ctx, *btr.getLowerTree (), d, pos, low, high));
+      bsp_n->setGreaterTree (BspTreeOperations::intersectLowerHalf (ctx, *btr.getGreaterTree (), d, pos, low, high));
+      BspTreeOperations::setSubTreeBounds (ctx, bsp_n, btr);
       return bsp_n;
     }
 }
 
-BspTree* BspTreeOperations::intersectGreaterHalf (const BspTree &btr, 
+BspTree* BspTreeOperations::intersectGreaterHalf (const BspOpContext &ctx, const BspTree &btr, 
 						  const int &d, const double &pos,
 						  double *low, double *high)
 {
@@ -657,73 +717,87 @@ BspTree* BspTreeOperations::intersectGreaterHalf (const BspTree &btr,
 
   if (btr.isLeaf ())
     {
-      bsp_n = BspTreeOperations::createTree (btr.getSpaceDimension ()); /* warning pos is set to 0 */
+      bsp_n = BspTreeOperations::createTree (ctx, btr.getSpaceDimension ()); /* warning pos is set to 0 */
       bsp_n->transferData (btr); /* virtual call */
       return bsp_n;
     }
 
   if (d == btr.getDimension ()) /* parallel to current tree's plane */
     {
-      if (Alg::REqual (pos, btr.getPosition (), Alg::m_doubleEpsilon))
+      if (Alg::REqual (pos, btr.getPosition (), ctx.m_epsilon))
 	{
-	  if (Alg::REqual (btr.getPosition (), high[d], Alg::m_doubleEpsilon))
-	    return createTree (btr.getSpaceDimension ());
+	  if (Alg::REqual (btr.getPosition (), high[d], ctx.m_epsilon))
+	    return createTree (ctx, btr.getSpaceDimension ());
 	  else {
-	    bsp_n = BspTreeOperations::intersectGreaterHalf (*btr.getGreaterTree (), d, pos, low, high);
-	    BspTreeOperations::setSubTreeMaxValue (bsp_n, btr.getGreaterTree ());
+	    bsp_n = BspTreeOperations::intersectGreaterHalf (ctx, *btr.getGreaterTree (), d, pos, low, high);
+	    BspTreeOperations::setSubTreeBounds (ctx, bsp_n, *btr.getGreaterTree ());
 	    return bsp_n;
 	  }
 	}
 	else if (btr.getPosition () > pos)
         {
-          bsp_n = BspTreeOperations::createTree (btr.getSpaceDimension (), 
+          bsp_n = BspTreeOperations::createTree (ctx, btr.getSpaceDimension (), 
 						 btr.getDimension (), btr.getPosition ());
-          bsp_n->setGreaterTree (BspTreeOperations::createTree (btr.getGreaterTree ()));
-          bsp_n->setLowerTree (BspTreeOperations::intersectGreaterHalf (*btr.getLowerTree (), d, pos, low, high));
-	  BspTreeOperations::setSubTreeMaxValue (bsp_n, btr);
+          bsp_n->setGreaterTree (BspTreeOperations::shareTree (ctx, btr.getGreaterTree ()));
+          bsp_n->setLowerTree (BspTreeOperations::intersectGreaterHalf (ctx, *btr.getLowerTree (), d, pos, low, high));
+	  BspTreeOperations::setSubTreeBounds (ctx, bsp_n, btr);
           return bsp_n;
         }
       else  /* position < pos */
         {
-          bsp_n = BspTreeOperations::intersectGreaterHalf (*btr.getGreaterTree (), d, pos, low, high);
-	  BspTreeOperations::setSubTreeMaxValue (bsp_n, btr.getGreaterTree ());
+          bsp_n = BspTreeOperations::intersectGreaterHalf (ctx, *btr.getGreaterTree (), d, pos, low, high);
+	  BspTreeOperations::setSubTreeBounds (ctx, bsp_n, *btr.getGreaterTree ());
           return bsp_n;
         }
     }
   else  /* cuts through this tree partition plane */
     {
-      bsp_n = BspTreeOperations::createTree (btr.getSpaceDimension (), 
+      bsp_n = BspTreeOperations::createTree (ctx, btr.getSpaceDimension (), 
 					     btr.getDimension (), btr.getPosition ());
-      bsp_n->setLowerTree (BspTreeOperations::intersectGreaterHalf (*btr.getLowerTree (), d, pos, low, high));
-      bsp_n->setGreaterTree (BspTreeOperations::intersectGreaterHalf (*btr.getGreaterTree (), d, pos, low, high));
-      BspTreeOperations::setSubTreeMaxValue (bsp_n, btr);
+      bsp_n->setLowerTree (BspTreeOperations::intersectGreaterHalf (ctx, *btr.getLowerTree (), d, pos, low, high));
+      bsp_n->setGreaterTree (BspTreeOperations::intersectGreaterHalf (ctx, *btr.getGreaterTree (), d, pos, low, high));
+      BspTreeOperations::setSubTreeBounds (ctx, bsp_n, btr);
       return bsp_n;
     }
 }
 
 BspTree* BspTreeOperations::intersectTrees (BspTree *bt1, BspTree *bt2,
 					    double *low, double *high)
+{
+  return BspTreeOperations::intersectTrees (BspOpContext (), bt1, bt2, low, high);
+}
+
+BspTree* BspTreeOperations::intersectTrees (const BspOpContext &ctx, BspTree *bt1, BspTree *bt2,
+					    double *low, double *high)
+{
+  BspOpContext lctx (ctx);  /* the output type is set along the recursion. */
+  BspOpContextScope scope (lctx);
+  return BspTreeOperations::intersect (lctx, bt1, bt2, low, high);
+}
+
+BspTree* BspTreeOperations::intersect (BspOpContext &ctx, BspTree *bt1, BspTree *bt2,
+				       double *low, double *high)
 {
   /* setting the correct output type */
   if (bt1->getType () == bt2->getType ())
-    BspTreeOperations::m_currentOutputType = bt1->getType ();
+    ctx.m_outputType = bt1->getType ();
   else
-    BspTreeOperations::m_currentOutputType = BspTreeOperations::lookupOutputTypeTable (bt1->getType (),
-										       bt2->getType ());
+    ctx.m_outputType = BspTreeOperations::lookupOutputTypeTable (bt1->getType (),
+								bt2->getType ());
 
   BspTree *bsp_T1, *bsp_T2;
 
   if (bt1->isLeaf ())
-      /* || BspTreeOperations::m_currentIntersectionType == BTI_MINUS
-	 || BspTreeOperations::m_currentIntersectionType == BTI_CSD_DIFF) */
-    return BspTreeOperations::intersectWithCell (bt1, bt2, low, high);
+      /* || ctx.m_intersectionType == BTI_MINUS
+	 || ctx.m_intersectionType == BTI_CSD_DIFF) */
+    return BspTreeOperations::intersectWithCell (ctx, bt1, bt2, low, high);
   if (bt2->isLeaf ()) 
-      /* && BspTreeOperations::m_currentIntersectionType != BTI_MINUS
-	 && BspTreeOperations::m_currentIntersectionType != BTI_CSD_DIFF) */
-    return BspTreeOperations::intersectWithCell (bt2, bt1, low, high);
+      /* && ctx.m_intersectionType != BTI_MINUS
+	 && ctx.m_intersectionType != BTI_CSD_DIFF) */
+    return BspTreeOperations::intersectWithCell (ctx, bt2, bt1, low, high);
 
   /* Test: bsp balance here */
-  if (BspTreeOperations::m_bspBalance)
+  if (ctx.m_bspBalance)
     {
       double dist1 = fabs ((high[bt1->getDimension ()] - low[bt1->getDimension ()]) / 2.0
                            - bt1->getPosition ());
@@ -747,49 +821,56 @@ BspTree* BspTreeOperations::intersectTrees (BspTree *bt1, BspTree *bt2,
     }
 
   /* partition T2 with the partition of T1 */
-  BspTree *bsp_p = BspTreeOperations::partition (*bsp_T2, bsp_T1->getDimension (), 
+  BspTree *bsp_p = BspTreeOperations::partition (ctx, *bsp_T2, bsp_T1->getDimension (), 
 						 bsp_T1->getPosition (), low, high);
   
-  BspTree *bsp_n = BspTreeOperations::createTree (bsp_T1->getSpaceDimension (), 
+  BspTree *bsp_n = BspTreeOperations::createTree (ctx, bsp_T1->getSpaceDimension (), 
 						  bsp_T1->getDimension (), bsp_T1->getPosition ());
 
   /* lower subtree */
   double bound = high[bsp_n->getDimension ()];
   high[bsp_n->getDimension ()] = bsp_n->getPosition ();
-  bsp_n->setLowerTree (BspTreeOperations::intersectTrees (bsp_T1->getLowerTree (),
-							  bsp_p->getLowerTree (),
-							  low, high));
+  bsp_n->setLowerTree (BspTreeOperations::intersect (ctx, bsp_T1->getLowerTree (),
+						     bsp_p->getLowerTree (),
+						     low, high));
   high[bsp_n->getDimension ()] = bound;
 
   /* greater subtree */
   bound = low[bsp_n->getDimension ()];
   low[bsp_n->getDimension ()] = bsp_n->getPosition ();
-  bsp_n->setGreaterTree (BspTreeOperations::intersectTrees (bsp_T1->getGreaterTree (),
-							    bsp_p->getGreaterTree (),
-							    low, high));
+  bsp_n->setGreaterTree (BspTreeOperations::intersect (ctx, bsp_T1->getGreaterTree (),
+						       bsp_p->getGreaterTree (),
+						       low, high));
   low[bsp_n->getDimension ()] = bound;
 
-  BspTreeOperations::setSubTreeMaxValue (bsp_n, bsp_T1);
+  BspTreeOperations::updateSubTreeBounds (ctx, bsp_n);
   
   BspTree::deleteBspTree (bsp_p);
   bsp_p = 0;
   return bsp_n;
 }
 
-BspTree* BspTreeOperations::partition (const BspTree &bt, const int &d, const double &pos,
+BspTree* BspTreeOperations::partition (const BspOpContext &ctx, const BspTree &bt,
+				       const int &d, const double &pos,
 				       double *low, double *high)
 {
-  BspTree *bsp_n = BspTreeOperations::createTree (bt.getSpaceDimension (), d, pos);
+  BspTree *bsp_n = BspTreeOperations::createTree (ctx, bt.getSpaceDimension (), d, pos);
 
-  bsp_n->setLowerTree (BspTreeOperations::intersectLowerHalf (bt, d, pos, low, high));
-  bsp_n->setGreaterTree (BspTreeOperations::intersectGreaterHalf (bt, d, pos, low, high));
-  BspTreeOperations::setSubTreeMaxValue (bsp_n, bt);
+  bsp_n->setLowerTree (BspTreeOperations::intersectLowerHalf (ctx, bt, d, pos, low, high));
+  bsp_n->setGreaterTree (BspTreeOperations::intersectGreaterHalf (ctx, bt, d, pos, low, high));
+  BspTreeOperations::setSubTreeBounds (ctx, bsp_n, bt);
   
   return bsp_n;
 }
 
 BspTree* BspTreeOperations::shiftTree (BspTree *bt, double *shift,
 				       double *low, double *high)
+{
+  return BspTreeOperations::shiftTree (BspOpContext (), bt, shift, low, high);
+}
+
+BspTree* BspTreeOperations::shiftTree (const BspOpContext &ctx, BspTree *bt, double *shift,
+				       double *low, double *high)
 {
   if (! bt->isLeaf ())
     {
@@ -798,32 +879,32 @@ BspTree* BspTreeOperations::shiftTree (BspTree *bt, double *shift,
       if (shift) bt->shiftPosition (shift[dim]);
       
       if (Alg::RSup (bt->getPosition (), high[dim],
-		     Alg::m_doubleEpsilon))
+		     ctx.m_epsilon))
 	{
 	  BspTree::deleteBspTree (bt->getGreaterTree ());
 	  bt->setGreaterTree (0);
 	  BspTree *lt = bt->getLowerTree ();
 	  delete bt;
 	  bt = 0;
-	  BspTree *res = BspTreeOperations::shiftTree (lt, shift, low, high);
-	  BspTreeOperations::setSubTreeMaxValue (res, lt);
+	  BspTree *res = BspTreeOperations::shiftTree (ctx, lt, shift, low, high);
+	  BspTreeOperations::setSubTreeBounds (ctx, res, *lt);
 	  return res;
 	}
       else if (Alg::RInf (bt->getPosition (), low[dim],
-			  Alg::m_doubleEpsilon))
+			  ctx.m_epsilon))
 	{
 	  BspTree::deleteBspTree (bt->getLowerTree ());
 	  bt->setLowerTree (0);
 	  BspTree *ge = bt->getGreaterTree ();
 	  delete bt;
 	  bt = 0;
-	  BspTree *res = BspTreeOperations::shiftTree (ge, shift, low, high);
-	  BspTreeOperations::setSubTreeMaxValue (res, ge);
+	  BspTree *res = BspTreeOperations::shiftTree (ctx, ge, shift, low, high);
+	  BspTreeOperations::setSubTreeBounds (ctx, res, *ge);
 	  return res;
 	}
       else {
-	bt->setLowerTree (BspTreeOperations::shiftTree (bt->getLowerTree (), shift, low, high));
-	bt->setGreaterTree (BspTreeOperations::shiftTree (bt->getGreaterTree (), shift, low, high));
+	bt->setLowerTree (BspTreeOperations::shiftTree (ctx, bt->getLowerTree (), shift, low, high));
+	bt->setGreaterTree (BspTreeOperations::shiftTree (ctx, bt->getGreaterTree (), shift, low, high));
 	return bt;
       }
     }
@@ -836,48 +917,60 @@ BspTree* BspTreeOperations::shiftTree (BspTree *bt, double *shift,
 
 BspTree* BspTreeOperations::cropTree (BspTree *bt, double *low, double *high)
 {
-  BspTreeOperations::m_currentOutputType = bt->getType ();
+  return BspTreeOperations::cropTree (BspOpContext (), bt, low, high);
+}
+
+BspTree* BspTreeOperations::cropTree (const BspOpContext &ctx, BspTree *bt,
+				      double *low, double *high)
+{
+  BspOpContext lctx (ctx);
+  lctx.m_outputType = bt->getType ();
+  return BspTreeOperations::crop (lctx, bt, low, high);
+}
+
+BspTree* BspTreeOperations::crop (const BspOpContext &ctx, BspTree *bt, double *low, double *high)
+{
   BspTree *bsp_n;
   int dim = bt->getDimension ();
   
   if (! bt->isLeaf ())
     {
-      if (Alg::RSupEqual (bt->getPosition (), high[dim], Alg::m_doubleEpsilon))
+      if (Alg::RSupEqual (bt->getPosition (), high[dim], ctx.m_epsilon))
 	{
-	  bsp_n = BspTreeOperations::createTree (bt->getSpaceDimension (), bt->getDimension (),
+	  bsp_n = BspTreeOperations::createTree (ctx, bt->getSpaceDimension (), bt->getDimension (),
 						 high[dim]);
-	  BspTree *ge = BspTreeOperations::createTree (bt->getSpaceDimension ()); /* leaf. */
+	  BspTree *ge = BspTreeOperations::createTree (ctx, bt->getSpaceDimension ()); /* leaf. */
 	  BspTree *lt = bt->getLowerTree ();
 	  bsp_n->setGreaterTree (ge);
-	  bsp_n->setLowerTree (BspTreeOperations::cropTree (lt, low, high));
+	  bsp_n->setLowerTree (BspTreeOperations::crop (ctx, lt, low, high));
 	  
-	  BspTreeOperations::setSubTreeMaxValue (bsp_n, lt);
+	  BspTreeOperations::setSubTreeBounds (ctx, bsp_n, *lt);
 	}
-      else if (Alg::RInfEqual (bt->getPosition (), low[dim], Alg::m_doubleEpsilon))
+      else if (Alg::RInfEqual (bt->getPosition (), low[dim], ctx.m_epsilon))
 	{
-	  bsp_n = BspTreeOperations::createTree (bt->getSpaceDimension (), bt->getDimension (),
+	  bsp_n = BspTreeOperations::createTree (ctx, bt->getSpaceDimension (), bt->getDimension (),
 						 low[dim]);
 	  BspTree *ge = bt->getGreaterTree ();
-	  BspTree *lt = BspTreeOperations::createTree (bt->getSpaceDimension ()); /* leaf. */
-	  bsp_n->setGreaterTree (BspTreeOperations::cropTree (ge, low, high));
+	  BspTree *lt = BspTreeOperations::createTree (ctx, bt->getSpaceDimension ()); /* leaf. */
+	  bsp_n->setGreaterTree (BspTreeOperations::crop (ctx, ge, low, high));
 	  bsp_n->setLowerTree (lt);
 	  
-	  BspTreeOperations::setSubTreeMaxValue (bsp_n, ge);
+	  BspTreeOperations::setSubTreeBounds (ctx, bsp_n, *ge);
 	}
       else  /* within the bounds. */ 
 	{
-	  bsp_n = BspTreeOperations::createTree (bt->getSpaceDimension (), bt->getDimension (),
+	  bsp_n = BspTreeOperations::createTree (ctx, bt->getSpaceDimension (), bt->getDimension (),
 						 bt->getPosition ());
 	  
-	  bsp_n->setLowerTree (BspTreeOperations::cropTree (bt->getLowerTree (), low, high));
-	  bsp_n->setGreaterTree (BspTreeOperations::cropTree (bt->getGreaterTree (), low, high));
+	  bsp_n->setLowerTree (BspTreeOperations::crop (ctx, bt->getLowerTree (), low, high));
+	  bsp_n->setGreaterTree (BspTreeOperations::crop (ctx, bt->getGreaterTree (), low, high));
 	  
-	  BspTreeOperations::setSubTreeMaxValue (bsp_n, bt);
+	  BspTreeOperations::setSubTreeBounds (ctx, bsp_n, *bt);
 	}
     }
   else
     {
-      bsp_n = BspTreeOperations::createTree (bt);
+      bsp_n = BspTreeOperations::createTree (ctx, bt);
     }
   return bsp_n;
 }
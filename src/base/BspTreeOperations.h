@@ -24,6 +24,7 @@
 
 #include "Alg.h"
 #include "BspTree.h"
+#include "ThreadPool.h"
 
 namespace hmdp_base
 {
@@ -37,6 +38,62 @@ enum BspTreeIntersectionType {
 
 #endif
 
+/**
+ * \class BspOpContext
+ * \brief state of a tree operation: output type, leaf intersection type,
+ *        pieces merging policy and numerical tolerance. Operations that are
+ *        handed their own context do not touch the global options and can
+ *        run concurrently.
+ */
+class BspOpContext
+{
+ public:
+  /**
+   * \brief constructor. Snapshot of the current global options.
+   * @sa BspTreeOperations user options.
+   */
+  BspOpContext ();
+
+  /**
+   * \brief constructor. Snapshot of the current global options, with
+   *        a given leaf intersection type.
+   * @param btit leaf intersection type.
+   */
+  BspOpContext (const BspTreeIntersectionType &btit);
+
+  BspTreeType m_outputType;  /**< bsp tree output type */
+  BspTreeIntersectionType m_intersectionType;  /**< leaf intersection type */
+  bool m_bspBalance;  /**< tree balancing flag */
+  bool m_asymetricOperators;  /**< whether we're using asymetric min/max */
+  bool m_piecesMerging;  /**< whether we're merging the pieces or not */
+  bool m_piecesMergingByValue;  /**< force merge pieces based on their attached values. */
+  bool m_piecesMergingByAction;  /**< force merge pieces based on their attached actions. */
+  bool m_piecesMergingEquality;  /**< merge pieces if they're equal only. */
+  double m_epsilon;  /**< tolerance for comparing double */
+  ThreadPool *m_pool;  /**< pool for running independent sub-operations concurrently,
+			  NULL for sequential operations (default). */
+};
+
+/**
+ * \class BspOpContextScope
+ * \brief installs a context as the current one for the calling thread,
+ *        until destruction. Leaf operations (virtual calls on the trees)
+ *        read their options from the current context.
+ * @sa BspTreeOperations::context
+ */
+class BspOpContextScope
+{
+ public:
+  BspOpContextScope (const BspOpContext &ctx);
+  ~BspOpContextScope ();
+
+ private:
+  BspOpContextScope (const BspOpContextScope &);
+  BspOpContextScope& operator= (const BspOpContextScope &);
+
+  const BspOpContext *m_previous;
+};
+
 /**
  * \class BspTreeOperations
  * \brief static algorithms of operating with bsp trees of different types.
@@ -72,6 +129,23 @@ class BspTreeOperations : public Alg
    * @sa BspTreeOperations::m_currentOutputType.
    */
   static BspTree* createTree (BspTree *bt);
+
+  /**
+   * \brief create bsp tree according to the context output type.
+   * @param ctx operation context,
+   * @param dim continuous space dimension,
+   * @return newly created bsp tree.
+   */
+  static BspTree* createTree (const BspOpContext &ctx, const int &dim);
+
+  static BspTree* createTree (const BspOpContext &ctx, const int &dim,
+			      const int &d, const double &pos);
+
+  static BspTree* createTree (const BspOpContext &ctx, const int &dim,
+			      const int &d, const double &pos,
+			      const double &max_value);
+
+  static BspTree* createTree (const BspOpContext &ctx, BspTree *bt);
   
   /**
    * \brief copy bsp tree. Output tree is of the same type as the input tree.
@@ -80,7 +154,24 @@ class BspTreeOperations : public Alg
    */
   static BspTree* copyTree (BspTree *bt);
 
+  /**
+   * \brief copy bsp tree, in O(1) if the tree is shared (hash-consed): the copy
+   *        is the tree itself, with one more reference, and must not be modified.
+   *        Private trees are copied as by copyTree.
+   * @param bt bsp tree to be copied.
+   * @return bt if shared, a newly created bsp tree of same type as bt otherwise.
+   * @sa BspTreeStore
+   */
+  static BspTree* shareTree (BspTree *bt);
+
  private:
+  /**
+   * \brief create bsp tree according to the context output type, as a reference
+   *        to bt if it is shared and of the output type.
+   */
+  static BspTree* shareTree (const BspOpContext &ctx, BspTree *bt);
+
+
   static BspTreeType lookupOutputTypeTable (BspTreeType btt1, BspTreeType btt2);
 
  public:
@@ -94,24 +185,45 @@ class BspTreeOperations : public Alg
    */
   static BspTree* intersectTrees (BspTree *bt1, BspTree *bt2,
 				  double *low, double *high);
+
+  /**
+   * \brief bsp trees intersection, with an explicit context. The output type
+   *        is derived from the types of bt1 and bt2, the other options are
+   *        read from ctx.
+   * @param ctx operation context,
+   * @param bt1 tree to be intersected,
+   * @param bt2 tree to be intersected,
+   * @param low array of domain lower bounds, of continuous space dimension.
+   * @param high array of domain upper bounds, of continuous space dimension.
+   * @return create a new tree, where bt1 and bt2 are intersected.
+   */
+  static BspTree* intersectTrees (const BspOpContext &ctx, BspTree *bt1, BspTree *bt2,
+				  double *low, double *high);
   
  private:
+  static BspTree* intersect (BspOpContext &ctx, BspTree *bt1, BspTree *bt2,
+			     double *low, double *high);
+
   /**                                                                                        
    * \brief partition a bsp tree of dimension d at position pos,                        
    * assuming the partitioning planes are in the same region.                          
+   * @param ctx operation context,
    * @param bt tree to be partitioned (result is in a new tree).                       
    * @param d dimension of the partitioning plane.                                          
    * @param pos position of the partition.                                                     
    */
-  static BspTree* partition (const BspTree &bt, const int &d, const double &pos,
+  static BspTree* partition (const BspOpContext &ctx, const BspTree &bt,
+			     const int &d, const double &pos,
 			     double *low, double *high);
      
-  static BspTree* intersectLowerHalf (const BspTree &btr, const int &d, const double &pos,
+  static BspTree* intersectLowerHalf (const BspOpContext &ctx, const BspTree &btr,
+				      const int &d, const double &pos,
 				      double *low, double *high);
-  static BspTree* intersectGreaterHalf (const BspTree &btr, const int &d, const double &pos,
+  static BspTree* intersectGreaterHalf (const BspOpContext &ctx, const BspTree &btr,
+					const int &d, const double &pos,
 					double *low, double *high);
   
-  static BspTree* intersectWithCell (BspTree *btr, BspTree *bt, 
+  static BspTree* intersectWithCell (const BspOpContext &ctx, BspTree *btr, BspTree *bt, 
 				     double *low, double *high);
 
  public:
@@ -124,6 +236,9 @@ class BspTreeOperations : public Alg
    */
   static BspTree* shiftTree (BspTree *bt, double *shift,
 			     double *low, double *high);
+
+  static BspTree* shiftTree (const BspOpContext &ctx, BspTree *bt, double *shift,
+			     double *low, double *high);
  
   /**
    * \brief 
@@ -131,12 +246,45 @@ class BspTreeOperations : public Alg
    */
   static BspTree* cropTree (BspTree *bt, double *low, double *high);
 
-  static void setSubTreeMaxValue (BspTree *bt, BspTree *btmv);
+  static BspTree* cropTree (const BspOpContext &ctx, BspTree *bt, double *low, double *high);
 
-  static void setSubTreeMaxValue (BspTree *bt, const BspTree &btmv);
+ private:
+  static BspTree* crop (const BspOpContext &ctx, BspTree *bt, double *low, double *high);
+
+ public:
+  /**
+   * \brief copies the value bounds of a tree to a tree on a (sub-)domain of it, with the
+   *        same values, if asymetric operators are on.
+   * @param bt tree whose bounds are set,
+   * @param btmv tree whose bounds are copied.
+   * @sa BspTreeAlpha::getSubTreeMaxValue
+   */
+  static void setSubTreeBounds (BspTree *bt, BspTree *btmv);
+
+  static void setSubTreeBounds (BspTree *bt, const BspTree &btmv);
+
+  static void setSubTreeBounds (const BspOpContext &ctx, BspTree *bt, const BspTree &btmv);
+
+  /**
+   * \brief sets the value bounds of a node from the bounds of its subtrees, if asymetric
+   *        operators are on.
+   */
+  static void updateSubTreeBounds (const BspOpContext &ctx, BspTree *bt);
+
+  /**
+   * \brief whether a tree is a tree of alpha vectors, that holds value bounds.
+   */
+  static bool hasSubTreeBounds (const BspTree &bt);
 
   static void swapDimensions(BspTree *bt, int swapTable[]);
 
+  /**
+   * \brief context of the innermost operation running on the calling thread,
+   *        or a snapshot of the global options if there is none.
+   * @sa BspOpContextScope
+   */
+  static const BspOpContext& context ();
+
  public:
   /* setters */
   /**
@@ -161,7 +309,8 @@ class BspTreeOperations : public Alg
  public:
   /* user options */
   static bool m_bspBalance;  /**< tree balancing flag */
-  static bool m_asymetricOperators; /**< whether we're using asymetric min/max (default no) */
+  static bool m_asymetricOperators; /**< whether we're using asymetric min/max (default no,
+					  set by the --bound_pruning option of hmdp, that is on by default) */
   
  public:
   static bool m_piecesMerging;  /**< whether we're merging the pieces or not (default no) */
@@ -172,6 +321,8 @@ class BspTreeOperations : public Alg
   
  protected:
   static BspTreeIntersectionType m_currentIntersectionType;  /**< intersection type */
+
+  friend class BspOpContext;
 };
 
 } /* end of namespace */
@@ -0,0 +1,142 @@
+/**
+ * Copyright 2014 Emmanuel Benazera beniz@droidnik.fr
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BspTreeStore.h"
+#include "Alg.h"
+
+namespace hmdp_base
+{
+
+BspTreeStore::Shard BspTreeStore::m_shards[BspTreeStore::m_nShards];
+bool BspTreeStore::m_enabled = false;
+std::atomic<long> BspTreeStore::m_nodes (0);
+std::atomic<long> BspTreeStore::m_hits (0);
+
+size_t BspTreeStore::hashNode (const BspTree *bt)
+{
+  size_t h = static_cast<size_t> (bt->getType ());
+  if (bt->isLeaf ())
+    Alg::hashCombine (h, bt->hashNodeData (Alg::m_doubleEpsilon));
+  else
+    {
+      /* subtrees are shared: they are hashed by address. */
+      Alg::hashCombine (h, static_cast<size_t> (bt->getDimension ()));
+      Alg::hashCombine (h, Alg::hashDouble (bt->getPosition (), Alg::m_doubleEpsilon));
+      Alg::hashCombine (h, std::hash<const BspTree*> () (bt->getLowerTree ()));
+      Alg::hashCombine (h, std::hash<const BspTree*> () (bt->getGreaterTree ()));
+    }
+  return h;
+}
+
+bool BspTreeStore::isEqualNode (const BspTree *bt1, const BspTree *bt2)
+{
+  if (bt1->getType () != bt2->getType ()
+      || bt1->getSpaceDimension () != bt2->getSpaceDimension ()
+      || bt1->isLeaf () != bt2->isLeaf ())
+    return false;
+  if (! bt1->isLeaf ()
+      && (bt1->getDimension () != bt2->getDimension ()
+	  || ! Alg::REqual (bt1->getPosition (), bt2->getPosition (), Alg::m_doubleEpsilon)
+	  || bt1->getLowerTree () != bt2->getLowerTree ()
+	  || bt1->getGreaterTree () != bt2->getGreaterTree ()))
+    return false;
+  return bt1->isEqualNodeData (*bt2, Alg::m_doubleEpsilon);  /* virtual call */
+}
+
+BspTree* BspTreeStore::intern (BspTree *bt)
+{
+  if (bt->isShared ())
+    return bt;
+  if (! bt->isLeaf ())
+    {
+      bt->m_lt = BspTreeStore::intern (bt->m_lt);
+      bt->m_ge = BspTreeStore::intern (bt->m_ge);
+    }
+
+  size_t h = BspTreeStore::hashNode (bt);
+  Shard &s = BspTreeStore::shard (h);
+  BspTree *res = 0;
+  {
+    std::lock_guard<std::mutex> lock (s.m_mutex);
+    std::pair<std::unordered_multimap<size_t, BspTree*>::iterator,
+	      std::unordered_multimap<size_t, BspTree*>::iterator> range = s.m_nodes.equal_range (h);
+    for (std::unordered_multimap<size_t, BspTree*>::iterator it = range.first; it != range.second; ++it)
+      if (BspTreeStore::isEqualNode ((*it).second, bt))
+	{
+	  res = (*it).second;
+	  res->m_refs.fetch_add (1, std::memory_order_relaxed);
+	  break;
+	}
+    if (! res)
+      {
+	bt->m_refs.store (1, std::memory_order_relaxed);
+	s.m_nodes.insert (std::pair<size_t, BspTree*> (h, bt));
+	m_nodes++;
+	return bt;
+      }
+  }
+
+  /* the shared node holds its own references to the (same) subtrees. */
+  m_hits++;
+  if (! bt->isLeaf ())
+    {
+      BspTreeStore::release (bt->m_lt);
+      BspTreeStore::release (bt->m_ge);
+      bt->m_lt = 0;
+      bt->m_ge = 0;
+    }
+  delete bt;
+  return res;
+}
+
+BspTree* BspTreeStore::acquire (BspTree *bt)
+{
+  /* the caller holds a reference, the node cannot be released meanwhile. */
+  bt->m_refs.fetch_add (1, std::memory_order_relaxed);
+  return bt;
+}
+
+void BspTreeStore::release (BspTree *bt)
+{
+  size_t h = BspTreeStore::hashNode (bt);
+  Shard &s = BspTreeStore::shard (h);
+  {
+    /* the last reference is dropped under lock, so that the node cannot be
+       found and referenced again while it is removed from store. */
+    std::lock_guard<std::mutex> lock (s.m_mutex);
+    if (bt->m_refs.fetch_sub (1, std::memory_order_acq_rel) > 1)
+      return;
+    std::pair<std::unordered_multimap<size_t, BspTree*>::iterator,
+	      std::unordered_multimap<size_t, BspTree*>::iterator> range = s.m_nodes.equal_range (h);
+    for (std::unordered_multimap<size_t, BspTree*>::iterator it = range.first; it != range.second; ++it)
+      if ((*it).second == bt)
+	{
+	  s.m_nodes.erase (it);
+	  break;
+	}
+    m_nodes--;
+  }
+  if (! bt->isLeaf ())
+    {
+      BspTree::deleteBspTree (bt->m_lt);
+      BspTree::deleteBspTree (bt->m_ge);
+      bt->m_lt = 0;
+      bt->m_ge = 0;
+    }
+  delete bt;  /* destroy node (virtual) */
+}
+
+} /* end of namespace */
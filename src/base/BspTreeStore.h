@@ -0,0 +1,114 @@
+/**
+ * Copyright 2014 Emmanuel Benazera beniz@droidnik.fr
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * \brief hash-consing of bsp trees: structurally identical subtrees are
+ *        stored once, and shared with reference counts.
+ *
+ * \author E. Benazera
+ */
+
+#ifndef BSPTREESTORE_H
+#define BSPTREESTORE_H
+
+#include "BspTree.h"
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+namespace hmdp_base
+{
+
+/**
+ * \class BspTreeStore
+ * \brief static store of shared bsp tree nodes. A node is shared once interned:
+ *        two shared nodes are the same node if they have the same type, the same
+ *        partition (dimension and position) and the same (shared) subtrees, or
+ *        if they are leaves whose data are equal up to Alg::m_doubleEpsilon.
+ *        Shared nodes are immutable: they are copied in O(1) by taking a reference,
+ *        and deleted with their last reference (BspTree::deleteBspTree).
+ *        The store is thread-safe.
+ */
+class BspTreeStore
+{
+ public:
+  /**
+   * \brief enables (or disables) hash-consing. When disabled, trees are not interned
+   *        and are copied node by node, which is the default.
+   */
+  static void enable (const bool &on) { m_enabled = on; }
+
+  /**
+   * \brief whether hash-consing is enabled.
+   */
+  static bool isEnabled () { return m_enabled; }
+
+  /**
+   * \brief interns a tree, bottom-up: each of its nodes is replaced with the
+   *        identical shared node, if any, or becomes shared.
+   * @param bt tree, consumed (deleted or returned). Shared subtrees are left as they are.
+   * @return the shared tree, with a reference for the caller.
+   */
+  static BspTree* intern (BspTree *bt);
+
+  /**
+   * \brief takes a reference to a shared tree (O(1) copy).
+   * @param bt shared tree.
+   * @return bt.
+   */
+  static BspTree* acquire (BspTree *bt);
+
+  /**
+   * \brief releases a reference to a shared tree, and deletes the tree with its last reference.
+   * @param bt shared tree.
+   * @sa BspTree::deleteBspTree
+   */
+  static void release (BspTree *bt);
+
+  /**
+   * \brief number of shared nodes in store.
+   */
+  static long getNNodes () { return m_nodes.load (); }
+
+  /**
+   * \brief number of interned nodes that were found in store, i.e. not stored twice.
+   */
+  static long getNHits () { return m_hits.load (); }
+
+ private:
+  static size_t hashNode (const BspTree *bt);
+  static bool isEqualNode (const BspTree *bt1, const BspTree *bt2);
+
+  /**
+   * \brief a part of the store, with its own lock, selected by node hash.
+   */
+  struct Shard
+  {
+    std::mutex m_mutex;
+    std::unordered_multimap<size_t, BspTree*> m_nodes;
+  };
+  static Shard& shard (const size_t &h) { return m_shards[h % m_nShards]; }
+
+  static const size_t m_nShards = 64;
+  static Shard m_shards[m_nShards];
+  static bool m_enabled;  /**< whether hash-consing is enabled (default no). */
+  static std::atomic<long> m_nodes;  /**< shared nodes. */
+  static std::atomic<long> m_hits;  /**< interned nodes found in store. */
+};
+
+} /* end of namespace */
+
+#endif
@@ -136,7 +136,7 @@ void ContinuousReward::transferData (const BspTree &bt)
 	}
 
       /* set max value. */
-      m_maxValue = vf.getSubTreeMaxValue ();
+      copySubTreeBounds (vf);
     }
   else
     {
@@ -158,10 +158,16 @@ void ContinuousReward::transferData (const BspTree &bt)
 	    m_alphaVectors->push_back (new AlphaVector (*cr.getAlphaVectorNth (i)));
 	}
       
-      m_maxValue = cr.getSubTreeMaxValue ();
+      copySubTreeBounds (cr);
     }
 }
 
+void ContinuousReward::mergeTreeLeaves (const BspOpContext &ctx)
+{
+  BspOpContextScope scope (ctx);
+  mergeTreeLeaves ();
+}
+
 void ContinuousReward::mergeTreeLeaves ()
 {
   if (! isLeaf ())
@@ -277,13 +283,17 @@ void ContinuousReward::getMaxValue (double &mval, double *low, double *high)
     {
 	if (m_alphaVectors)
 	{
+	    /* linear pieces reach their max at a corner of the tile. */
 	    double *pos = new double[m_nDim];
-	    for (int d=0; d<m_nDim; d++)
-		pos[d] = (high[d] - low[d]) / 2.0;   /* for pwl vf, we take the value at the
-							center of the tile. */
-	    double lval = 0.0;
-	    if ((lval = getPointValueInLeaf (pos)) > mval)
-		mval = lval;
+	    for (long c=0; c<(1L << m_nDim); c++)
+	    {
+		for (int d=0; d<m_nDim; d++)
+		    pos[d] = ((c >> d) & 1) ? high[d] : low[d];
+		double lval = 0.0;
+		AlphaVector::bestAlphaVector (*m_alphaVectors, pos, &lval);
+		if (lval > mval)
+		    mval = lval;
+	    }
 	    delete []pos;
 	}
     }
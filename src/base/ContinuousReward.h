@@ -90,6 +90,12 @@ class ContinuousReward : public BspTreeAlpha
    */
   void mergeTreeLeaves ();
 
+  /**
+   * \brief merges tree leaves with the merging policy of a given operation context.
+   * @param ctx operation context.
+   */
+  void mergeTreeLeaves (const BspOpContext &ctx);
+
  protected:
   /**
    * \brief copy constructor (from an object of the father's class type)
@@ -121,7 +127,10 @@ class ContinuousReward : public BspTreeAlpha
   std::vector<int>* getAchievedGoals () const { return m_achievedGoals; }
 
   /**
-   * \brief gets the max value point of the reward. 
+   * \brief gets the max value point of the reward.
+   * @param mval max value (result), to be initialized,
+   * @param low domain lower bounds,
+   * @param high domain upper bounds.
    */
   void getMaxValue (double &mval, double *low, double *high);
 
@@ -163,9 +172,6 @@ class ContinuousReward : public BspTreeAlpha
 
   void deleteAchievedGoals ();
   
-  /* stuff for asymetric operators. */
-  double updateSubTreeMaxValue () { return 0.0; };
-  
  protected:
   int m_tilingDimension; /**< number of continuous reward tiles (root node only, 0 otherwise). */
   std::vector<int> *m_achievedGoals;  /**< goals achieved in this reward (from goal definition). */
@@ -19,6 +19,8 @@
 #include "HybridTransition.h"
 #include "ContinuousTransition.h"
 #include "ValueFunction.h"
+#include "Metrics.h"
+#include <algorithm>
 #include <assert.h>
 #include <stdlib.h>
 
@@ -63,7 +65,7 @@ ContinuousStateDistribution::ContinuousStateDistribution (const int &dimension,
   /* create a bsp tree from the transition tiling:                                                    create a tree for each tile, and intersect them. */
   ContinuousStateDistribution *bsp_n = this;
   ContinuousStateDistribution *bsp_c = this;
-  BspTreeOperations::setIntersectionType (BTI_INIT); /* leaf intersection type */
+  BspOpContext ctx (BTI_INIT); /* leaf intersection type */
   
   for (int tiles=0; tiles<m_tilingDimension; tiles++)
     {
@@ -102,7 +104,7 @@ ContinuousStateDistribution::ContinuousStateDistribution (const int &dimension,
 	}
       if (tiles > 0)
 	{
-	  BspTree *intersectedTree = BspTreeOperations::intersectTrees (this, bsp_c, low, high);
+	  BspTree *intersectedTree = BspTreeOperations::intersectTrees (ctx, this, bsp_c, low, high);
 	  BspTree::deleteBspTree (bsp_c); bsp_c = 0;
 	  if (m_lt) BspTree::deleteBspTree (m_lt);
 	  if (m_ge) BspTree::deleteBspTree (m_ge);
@@ -363,7 +365,8 @@ ContinuousStateDistribution* ContinuousStateDistribution::convertMDDiscreteDistr
     = new ContinuousStateDistribution (mdd.getNPoints (), mdd.getDimension (), 
 				       lowPos, highPos, low, high, prob);
 
-  if (BspTreeOperations::m_piecesMerging)
+  BspOpContext ctx;
+  if (ctx.m_piecesMerging)
     res->mergeTreeLeaves (low, high);
 
   free (prob);
@@ -381,6 +384,7 @@ ContinuousStateDistribution* ContinuousStateDistribution::frontUp (ContinuousSta
 								   double *low, double *high,
 								   const double &scalar)
 {
+  MetricsTimer timer (METRICS_FRONTUP);
 
   //debug
   /* std::cout << "csd frontup: ";
@@ -560,10 +564,10 @@ ContinuousStateDistribution* ContinuousStateDistribution::frontUpSingleOutcome (
   //debug
   
   /* intersect and multiply */
-  BspTreeOperations::setIntersectionType (BTI_MULT);
-  BspTree *bt = BspTreeOperations::intersectTrees (csd, co, low, high);
+  BspOpContext ctx (BTI_MULT);
+  BspTree *bt = BspTreeOperations::intersectTrees (ctx, csd, co, low, high);
   ContinuousStateDistribution *piece = static_cast<ContinuousStateDistribution*> (bt);
-  if (BspTreeOperations::m_piecesMerging)
+  if (ctx.m_piecesMerging)
     piece->mergeTreeLeaves (low, high);
   
   //debug
@@ -573,7 +577,7 @@ ContinuousStateDistribution* ContinuousStateDistribution::frontUpSingleOutcome (
   
   /* crop piece */
   ContinuousStateDistribution *cpiece
-    = static_cast<ContinuousStateDistribution*> (BspTreeOperations::cropTree (piece, co->getLowPos (),
+    = static_cast<ContinuousStateDistribution*> (BspTreeOperations::cropTree (ctx, piece, co->getLowPos (),
 									      co->getHighPos ()));
   BspTree::deleteBspTree (piece);
 
@@ -583,7 +587,7 @@ ContinuousStateDistribution* ContinuousStateDistribution::frontUpSingleOutcome (
   //debug
   
   /* shift the piece back */
-  cpiece = static_cast<ContinuousStateDistribution*> (BspTreeOperations::shiftTree (cpiece, 
+  cpiece = static_cast<ContinuousStateDistribution*> (BspTreeOperations::shiftTree (ctx, cpiece,
 										    co->getShiftBack (),
 										    low, high));
   //debug
@@ -591,7 +595,7 @@ ContinuousStateDistribution* ContinuousStateDistribution::frontUpSingleOutcome (
      cpiece->print (std::cout, low, high); */
   //debug
 
-  if (BspTreeOperations::m_piecesMerging)
+  if (ctx.m_piecesMerging)
     cpiece->mergeTreeLeaves (low, high);
   
   return cpiece;
@@ -601,10 +605,10 @@ ContinuousStateDistribution* ContinuousStateDistribution::addContinuousStateDist
 											   ContinuousStateDistribution *csd2,
 											   double *low, double *high)
 {
-  BspTreeOperations::setIntersectionType (BTI_PLUS);
+  BspOpContext ctx (BTI_PLUS);
   ContinuousStateDistribution *res
-    = static_cast<ContinuousStateDistribution*> (BspTreeOperations::intersectTrees (csd1, csd2, low, high));
-  if (BspTreeOperations::m_piecesMerging)
+    = static_cast<ContinuousStateDistribution*> (BspTreeOperations::intersectTrees (ctx, csd1, csd2, low, high));
+  if (ctx.m_piecesMerging)
     res->mergeTreeLeaves (low, high);
   return res;
 }
@@ -613,10 +617,10 @@ ContinuousStateDistribution* ContinuousStateDistribution::subtractContinuousStat
 												ContinuousStateDistribution *csd2,
 												double *low, double *high)
 {
-  BspTreeOperations::setIntersectionType (BTI_MINUS);
+  BspOpContext ctx (BTI_MINUS);
   ContinuousStateDistribution *res
-    = static_cast<ContinuousStateDistribution*> (BspTreeOperations::intersectTrees (csd1, csd2, low, high));
-  if (BspTreeOperations::m_piecesMerging)
+    = static_cast<ContinuousStateDistribution*> (BspTreeOperations::intersectTrees (ctx, csd1, csd2, low, high));
+  if (ctx.m_piecesMerging)
     res->mergeTreeLeaves (low, high);
   return res;
 }
@@ -625,10 +629,10 @@ ContinuousStateDistribution* ContinuousStateDistribution::multContinuousStateDis
 											    ContinuousStateDistribution *csd2,
 											    double *low, double *high)
 {
-  BspTreeOperations::setIntersectionType (BTI_MULT);
+  BspOpContext ctx (BTI_MULT);
   ContinuousStateDistribution *res
-    = static_cast<ContinuousStateDistribution*> (BspTreeOperations::intersectTrees (csd1, csd2, low, high));
-  if (BspTreeOperations::m_piecesMerging)
+    = static_cast<ContinuousStateDistribution*> (BspTreeOperations::intersectTrees (ctx, csd1, csd2, low, high));
+  if (ctx.m_piecesMerging)
     res->mergeTreeLeaves (low, high);
   return res;
 }
@@ -637,19 +641,11 @@ ContinuousStateDistribution* ContinuousStateDistribution::diffContinuousStateDis
 											    ContinuousStateDistribution *csd2,
 											    double *low, double *high)
 {
-  /* can't use the bsp balance. */
-  bool isBalance = false;
-  if (BspTreeOperations::m_bspBalance)
-    {
-      BspTreeOperations::m_bspBalance = false;
-      isBalance = true;
-    }
-  BspTreeOperations::setIntersectionType (BTI_CSD_DIFF);
+  BspOpContext ctx (BTI_CSD_DIFF);
+  ctx.m_bspBalance = false;  /* can't use the bsp balance. */
   ContinuousStateDistribution *res
-    = static_cast<ContinuousStateDistribution*> (BspTreeOperations::intersectTrees (csd1, csd2, low, high));
-  if (isBalance)
-    BspTreeOperations::m_bspBalance = true;
-  if (BspTreeOperations::m_piecesMerging)
+    = static_cast<ContinuousStateDistribution*> (BspTreeOperations::intersectTrees (ctx, csd1, csd2, low, high));
+  if (ctx.m_piecesMerging)
     res->mergeTreeLeaves (low, high);
   return res;
 }
@@ -744,6 +740,36 @@ void ContinuousStateDistribution::sumUpProbabilities (double *norm,
     }
 }
 
+void ContinuousStateDistribution::getSupportBounds (double *min, double *max,
+						    double *low, double *high)
+{
+  if (isLeaf ())
+    {
+      if (getProbability () > 0.0)
+	for (int d=0; d<m_nDim; d++)
+	  {
+	    min[d] = std::min (min[d], low[d]);
+	    max[d] = std::max (max[d], high[d]);
+	  }
+    }
+  else
+    {
+      double b = high[getDimension ()];
+      high[getDimension ()] = getPosition ();
+      ContinuousStateDistribution *csdlt 
+	= static_cast<ContinuousStateDistribution*> (getLowerTree ());
+      csdlt->getSupportBounds (min, max, low, high);
+      high[getDimension ()] = b;
+
+      b = low[getDimension ()];
+      low[getDimension ()] = getPosition ();
+      ContinuousStateDistribution *csdge
+	= static_cast<ContinuousStateDistribution*> (getGreaterTree ());
+      csdge->getSupportBounds (min, max, low, high);
+      low[getDimension ()] = b;
+    }
+}
+
 void ContinuousStateDistribution::normalize (const double &norm)
 {
   if (isLeaf ())
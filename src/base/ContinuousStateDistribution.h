@@ -131,6 +131,15 @@ class ContinuousStateDistribution : public BspTree
    */
   void sumUpProbabilities (double *norm, double *low, double *high);
 
+  /**
+   * \brief bounding box of the tiles with a positive probability.
+   * @param min lower corner of the box (result), to be initialized to high,
+   * @param max upper corner of the box (result), to be initialized to low,
+   * @param low domain lower bounds,
+   * @param high domain upper bounds.
+   */
+  void getSupportBounds (double *min, double *max, double *low, double *high);
+
   /**
    * \brief normalize the distribution.
    * @param probability mass to normalize with.
@@ -88,7 +88,7 @@ ContinuousTransition::ContinuousTransition (const int &dimension, const int &sdi
      create a tree for each tile, and intersect them. */
   ContinuousTransition *bsp_n = this;
   ContinuousTransition *bsp_c = this;
-  BspTreeOperations::setIntersectionType (BTI_INIT); /* leaf intersection type */
+  BspOpContext ctx (BTI_INIT); /* leaf intersection type */
   
   for (int tiles=0; tiles<m_tilingDimension; tiles++)
     {
@@ -185,7 +185,7 @@ ContinuousTransition::ContinuousTransition (const int &dimension, const int &sdi
 	}
       if (tiles > 0)
 	{
-	  BspTree *intersectedTree = BspTreeOperations::intersectTrees (this, bsp_c, lowPos[tiles], highPos[tiles]);
+	  BspTree *intersectedTree = BspTreeOperations::intersectTrees (ctx, this, bsp_c, lowPos[tiles], highPos[tiles]);
 	  BspTree::deleteBspTree (bsp_c); bsp_c = 0; 
 	  if (m_lt) BspTree::deleteBspTree (m_lt);
 	  if (m_ge) BspTree::deleteBspTree (m_ge);
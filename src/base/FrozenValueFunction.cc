@@ -0,0 +1,382 @@
+/**
+ * Copyright 2014 Emmanuel Benazera beniz@droidnik.fr
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FrozenValueFunction.h"
+#include <algorithm>
+#include <iostream>
+#include <stdlib.h>
+
+namespace hmdp_base
+{
+
+size_t FrozenValueFunction::m_batchBlockSize = 1024;
+
+FrozenValueFunction::FrozenValueFunction (const ValueFunction &vf)
+  : m_vfType (vf.getType ()), m_nDim (vf.getSpaceDimension ())
+{
+  if (m_vfType != PiecewiseConstantVFT && m_vfType != PiecewiseLinearVFT)
+    {
+      std::cerr << "[Error]:FrozenValueFunction: unsupported value function type: "
+		<< m_vfType << ". Exiting...\n";
+      exit (-1);
+    }
+
+  /* breadth-first traversal: the children of a node are appended together,
+     so that they end up next to each other in the node array. */
+  std::vector<const BspTree*> order;
+  order.push_back (&vf);
+  for (size_t i=0; i<order.size (); i++)
+    {
+      const BspTree *bt = order[i];
+      Node n;
+      if (bt->isLeaf ())
+	{
+	  n.m_pos = 0.0;
+	  n.m_d = -1;
+	  n.m_index = m_leaves.size ();
+
+	  const BspTreeAlpha *bta = static_cast<const BspTreeAlpha*> (bt);
+	  std::vector<AlphaVector*> *vav = bta->getAlphaVectors ();
+	  Leaf lf;
+	  lf.m_offset = m_coeffs.size ();
+	  lf.m_nVectors = vav ? vav->size () : 0;
+	  lf.m_size = lf.m_nVectors ? (*vav)[0]->getSize () : 0;
+	  lf.m_firstVector = m_vectorActions.size ();
+	  for (int v=0; v<lf.m_nVectors; v++)
+	    m_vectorActions.push_back ((*vav)[v]->m_actions.empty () ? -1
+				       : *(*vav)[v]->m_actions.begin ());
+	  for (int j=0; j<lf.m_size; j++)
+	    for (int v=0; v<lf.m_nVectors; v++)
+	      m_coeffs.push_back ((*vav)[v]->getAlphaNth (j));
+	  m_leaves.push_back (lf);
+	}
+      else
+	{
+	  n.m_pos = bt->getPosition ();
+	  n.m_d = bt->getDimension ();
+	  n.m_index = order.size ();
+	  order.push_back (bt->getLowerTree ());
+	  order.push_back (bt->getGreaterTree ());
+	}
+      m_nodes.push_back (n);
+    }
+}
+
+FrozenValueFunction::~FrozenValueFunction ()
+{
+}
+
+const FrozenValueFunction::Node& FrozenValueFunction::findLeafNode (const double *pos) const
+{
+  const Node *n = &m_nodes[0];
+  while (n->m_d >= 0)
+    {
+      if (pos[n->m_d] < n->m_pos)
+	n = &m_nodes[n->m_index];
+      else n = &m_nodes[n->m_index + 1];
+    }
+  return *n;
+}
+
+double FrozenValueFunction::getPointValue (const double *pos) const
+{
+  return leafValue (m_leaves[findLeafNode (pos).m_index], pos);
+}
+
+int FrozenValueFunction::getPointAction (const double *pos) const
+{
+  return leafAction (m_leaves[findLeafNode (pos).m_index], pos);
+}
+
+double FrozenValueFunction::leafValue (const Leaf &lf, const double *pos) const
+{
+  if (! lf.m_nVectors)
+    return 0.0;
+  if (m_vfType == PiecewiseConstantVFT)
+    return m_coeffs[lf.m_offset];  /* first coefficient of the first vector. */
+  double val = 0.0;
+  bestVector (lf, pos, 1.0, &val);
+  return val;
+}
+
+int FrozenValueFunction::leafAction (const Leaf &lf, const double *pos) const
+{
+  if (! lf.m_nVectors)
+    return -1;
+  if (m_vfType == PiecewiseConstantVFT)
+    return m_vectorActions[lf.m_firstVector];
+  double val;
+  int best = bestVector (lf, pos, 1.0, &val);
+  return best >= 0 ? m_vectorActions[lf.m_firstVector + best] : -1;
+}
+
+void FrozenValueFunction::getPointValues (const double *const *pos, const size_t &npts,
+					  double *values, int *actions) const
+{
+  /* points are routed by blocks, so that a block's coordinates and buffers
+     stay in cache while it goes down the tree. */
+  size_t bsize = std::min (npts, m_batchBlockSize);
+  if (! bsize)
+    return;
+  std::vector<size_t> idx (bsize);
+  BatchBuffers bb;
+  if (m_vfType == PiecewiseLinearVFT)
+    {
+      bb.m_coords.resize (m_nDim * bsize);
+      bb.m_vals.resize (bsize);
+      bb.m_best.resize (bsize);
+      bb.m_bestVector.resize (bsize);
+    }
+  for (size_t b=0; b<npts; b+=bsize)
+    {
+      size_t m = std::min (bsize, npts - b);
+      for (size_t i=0; i<m; i++)
+	idx[i] = b + i;
+      routePoints (0, pos, &idx[0], m, bb, values, actions);
+    }
+}
+
+void FrozenValueFunction::routePoints (const int &n, const double *const *pos,
+				       size_t *idx, const size_t &m, BatchBuffers &bb,
+				       double *values, int *actions) const
+{
+  const Node &nd = m_nodes[n];
+  if (nd.m_d < 0)
+    {
+      leafValues (m_leaves[nd.m_index], pos, idx, m, bb, values, actions);
+      return;
+    }
+
+  /* split the group in place: points below the partitioning position first. */
+  const double *x = pos[nd.m_d];
+  size_t *mid = std::partition (idx, idx + m, [x, &nd] (const size_t &i) { return x[i] < nd.m_pos; });
+  size_t mlt = mid - idx;
+  if (mlt)
+    routePoints (nd.m_index, pos, idx, mlt, bb, values, actions);
+  if (mlt < m)
+    routePoints (nd.m_index + 1, pos, mid, m - mlt, bb, values, actions);
+}
+
+void FrozenValueFunction::leafValues (const Leaf &lf, const double *const *pos,
+				      const size_t *idx, const size_t &m, BatchBuffers &bb,
+				      double *values, int *actions) const
+{
+  if (! lf.m_nVectors || m_vfType == PiecewiseConstantVFT)
+    {
+      double val = lf.m_nVectors ? m_coeffs[lf.m_offset] : 0.0;
+      int act = lf.m_nVectors ? m_vectorActions[lf.m_firstVector] : -1;
+      for (size_t k=0; k<m; k++)
+	values[idx[k]] = val;
+      if (actions)
+	for (size_t k=0; k<m; k++)
+	  actions[idx[k]] = act;
+      return;
+    }
+
+  /* gather the group coordinates, so that the vector evaluations below run
+     over contiguous arrays. */
+  const int nv = lf.m_nVectors, last = lf.m_size - 1;
+  double *coords = &bb.m_coords[0];
+  for (int j=0; j<last; j++)
+    {
+      const double *pj = pos[j];
+      double *xj = coords + j * m;
+      for (size_t k=0; k<m; k++)
+	xj[k] = pj[idx[k]];
+    }
+
+  /* same evaluation order and selection as bestVector, one vector at a time
+     over all the points. */
+  const double *c = &m_coeffs[lf.m_offset];
+  double *vals = &bb.m_vals[0], *best = &bb.m_best[0];
+  int *bestv = &bb.m_bestVector[0];
+  for (size_t k=0; k<m; k++)
+    {
+      best[k] = -100000000.0;
+      bestv[k] = -1;
+    }
+  for (int v=0; v<nv; v++)
+    {
+      const double cst = c[last*nv + v];
+      for (size_t k=0; k<m; k++)
+	vals[k] = cst;
+      for (int j=0; j<last; j++)
+	{
+	  const double cj = c[j*nv + v];
+	  const double *xj = coords + j * m;
+	  for (size_t k=0; k<m; k++)
+	    vals[k] += cj * xj[k];
+	}
+      for (size_t k=0; k<m; k++)
+	{
+	  if (vals[k] > best[k])
+	    {
+	      best[k] = vals[k];
+	      bestv[k] = v;
+	    }
+	  else if (vals[k] == best[k] && bestv[k] >= 0)  /* lexicographical dominance. */
+	    {
+	      for (int l=0; l<last; l++)
+		if (c[l*nv + v] > c[l*nv + bestv[k]])
+		  {
+		    bestv[k] = v;
+		    break;
+		  }
+	    }
+	}
+    }
+
+  for (size_t k=0; k<m; k++)
+    values[idx[k]] = best[k];
+  if (actions)
+    for (size_t k=0; k<m; k++)
+      actions[idx[k]] = bestv[k] >= 0 ? m_vectorActions[lf.m_firstVector + bestv[k]] : -1;
+}
+
+int FrozenValueFunction::bestVector (const Leaf &lf, const double *witness, const double &scale,
+				     double *retv) const
+{
+  /* same semantics as AlphaVector::bestAlphaVector, on the leaf's vectors
+     multiplied by scale. */
+  const double *c = &m_coeffs[lf.m_offset];
+  const int nv = lf.m_nVectors, last = lf.m_size - 1;
+  *retv = -100000000.0;
+  int best = -1;
+  for (int v=0; v<nv; v++)
+    {
+      double val = c[last*nv + v] * scale;  /* constant */
+      for (int j=0; j<last; j++)
+	val += (c[j*nv + v] * scale * witness[j]);
+
+      if (val > *retv)
+	{
+	  best = v;
+	  *retv = val;
+	}
+      else if (val == *retv && best >= 0)  /* lexicographical dominance. */
+	{
+	  for (int k=0; k<last; k++)
+	    if (c[k*nv + v] * scale > c[k*nv + best] * scale)
+	      {
+		best = v;
+		break;
+	      }
+	}
+    }
+  return best;
+}
+
+double FrozenValueFunction::computeExpectation (const ContinuousStateDistribution &csd,
+						const double *low, const double *high) const
+{
+  std::vector<double> clow (low, low + m_nDim), chigh (high, high + m_nDim);
+  std::vector<double> cpt (m_nDim, 0.0);  /* witness point, shared by all leaves. */
+  double expect = 0.0;
+  expectationFromNode (0, csd, &clow[0], &chigh[0], &cpt[0], &expect);
+  return expect;
+}
+
+void FrozenValueFunction::expectationFromNode (const int &n, const ContinuousStateDistribution &csd,
+					       double *low, double *high, double *cpt,
+					       double *expect) const
+{
+  const Node &nd = m_nodes[n];
+  if (nd.m_d < 0)
+    {
+      expectationInLeaf (m_leaves[nd.m_index], csd, low, high, cpt, expect);
+      return;
+    }
+
+  double b = low[nd.m_d];
+  low[nd.m_d] = nd.m_pos;
+  expectationFromNode (nd.m_index + 1, csd, low, high, cpt, expect);
+  low[nd.m_d] = b;
+
+  b = high[nd.m_d];
+  high[nd.m_d] = nd.m_pos;
+  expectationFromNode (nd.m_index, csd, low, high, cpt, expect);
+  high[nd.m_d] = b;
+}
+
+void FrozenValueFunction::expectationInLeaf (const Leaf &lf, const ContinuousStateDistribution &csd,
+					     double *low, double *high, double *cpt,
+					     double *expect) const
+{
+  if (! lf.m_nVectors)
+    return;
+
+  if (! csd.isLeaf ())
+    {
+      /* only visit the distribution tiles that overlap the leaf tile. */
+      int d = csd.getDimension ();
+      double pos = csd.getPosition ();
+      if (pos < high[d])
+	{
+	  double b = low[d];
+	  if (pos > low[d])
+	    low[d] = pos;
+	  expectationInLeaf (lf, *static_cast<ContinuousStateDistribution*> (csd.getGreaterTree ()),
+			     low, high, cpt, expect);
+	  low[d] = b;
+	}
+      if (pos > low[d])
+	{
+	  double b = high[d];
+	  if (pos < high[d])
+	    high[d] = pos;
+	  expectationInLeaf (lf, *static_cast<ContinuousStateDistribution*> (csd.getLowerTree ()),
+			     low, high, cpt, expect);
+	  high[d] = b;
+	}
+      return;
+    }
+
+  if (csd.getProbability () <= 0.0)
+    return;
+
+  /* probability of the tile, as in ValueFunction::leafDataIntersectMult. */
+  double prob = 1.0;
+  for (int d=0; d<m_nDim; d++)
+    prob *= (high[d] - low[d]);
+  prob *= csd.getProbability ();
+
+  if (m_vfType == PiecewiseConstantVFT)
+    {
+      *expect += m_coeffs[lf.m_offset] * prob;
+      return;
+    }
+
+  /* as PiecewiseLinearValueFunction::expectedValueFromLeaves. */
+  for (int i=0; i<m_nDim; i++)
+    cpt[i] = (high[i] - low[i]) / 2.0;
+  double bval;
+  int wt = bestVector (lf, cpt, prob, &bval);
+  if (wt < 0)
+    return;
+
+  const double *c = &m_coeffs[lf.m_offset];
+  const int nv = lf.m_nVectors;
+  double expect_ct = 1.0, expect_fct = 1.0;
+  for (int i=0; i<m_nDim; i++)
+    {
+      expect_ct *= (high[i] - low[i]);
+      expect_fct *= 0.5 * c[i*nv + wt] * prob * (high[i]*high[i] - low[i]*low[i]);
+    }
+  expect_ct *= c[m_nDim*nv + wt] * prob;  /* constant */
+  *expect += expect_ct; *expect += expect_fct;
+}
+
+} /* end of namespace */
@@ -0,0 +1,167 @@
+/**
+ * Copyright 2014 Emmanuel Benazera beniz@droidnik.fr
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * \brief compact, read-only form of a finished value function, for fast queries.
+ *
+ * \author E. Benazera
+ */
+
+#ifndef FROZENVALUEFUNCTION_H
+#define FROZENVALUEFUNCTION_H
+
+#include "ValueFunction.h"
+#include <vector>
+
+namespace hmdp_base
+{
+
+/**
+ * \class FrozenValueFunction
+ * \brief value function whose nodes are stored in a contiguous array, in
+ *        breadth-first order, with the two children of a node next to each
+ *        other. Leaf alpha vectors are stored in a single buffer, coefficient
+ *        by coefficient (structure of arrays) within each leaf.
+ *        Queries give the same results as on the original (pwc or pwl) value function.
+ */
+class FrozenValueFunction
+{
+ public:
+  /**
+   * \brief constructor.
+   * @param vf piecewise constant or linear value function to be frozen. It is
+   *        not referenced afterwards.
+   */
+  FrozenValueFunction (const ValueFunction &vf);
+
+  ~FrozenValueFunction ();
+
+  /**
+   * \brief value at a point of the continuous space.
+   * @param pos point coordinates (array of space dimension).
+   * @return value.
+   * @sa BspTree::getPointValue
+   */
+  double getPointValue (const double *pos) const;
+
+  /**
+   * \brief action at a point of the continuous space.
+   * @param pos point coordinates (array of space dimension).
+   * @return action index, -1 if none.
+   * @sa BspTreeAlpha::getPointAction
+   */
+  int getPointAction (const double *pos) const;
+
+  /**
+   * \brief values and actions at a batch of points of the continuous space.
+   *        Points are routed down the tree in groups, and the alpha vectors of
+   *        a leaf are evaluated over all the points of its group at once.
+   * @param pos point coordinates, by dimension: pos[d][i] is the d-th coordinate
+   *        of the i-th point,
+   * @param npts number of points,
+   * @param values array of npts values, filled in,
+   * @param actions array of npts actions, filled in if not NULL.
+   * @sa getPointValue, getPointAction
+   */
+  void getPointValues (const double *const *pos, const size_t &npts,
+		       double *values, int *actions=NULL) const;
+
+  /**
+   * \brief expected value w.r.t. a probability distribution over the continuous space.
+   * @param csd continuous state distribution,
+   * @param low domain lower bounds,
+   * @param high domain upper bounds.
+   * @return expectation.
+   * @sa ValueFunction::computeExpectation
+   */
+  double computeExpectation (const ContinuousStateDistribution &csd,
+			     const double *low, const double *high) const;
+
+  /* accessors */
+  BspTreeType getType () const { return m_vfType; }
+  int getSpaceDimension () const { return m_nDim; }
+  size_t getNNodes () const { return m_nodes.size (); }
+  size_t getNLeaves () const { return m_leaves.size (); }
+
+  static size_t m_batchBlockSize;  /**< max number of points routed together by batched lookups. */
+
+ private:
+  /**
+   * \brief node: partitioning position and dimension, and index of the lower tree
+   *        (the greater tree follows) or of the leaf data.
+   */
+  struct Node
+  {
+    double m_pos;  /**< partitioning position. */
+    int m_d;  /**< partitioning dimension, -1 for a leaf. */
+    int m_index;  /**< lower tree node index, or leaf index. */
+  };
+
+  /**
+   * \brief leaf data: alpha vectors, with m_nVectors values per coefficient
+   *        starting at m_offset in the coefficient buffer.
+   */
+  struct Leaf
+  {
+    int m_offset;  /**< first coefficient in the coefficient buffer. */
+    int m_nVectors;  /**< number of alpha vectors, 0 if none. */
+    int m_size;  /**< alpha vectors size. */
+    int m_firstVector;  /**< first vector in the vector actions buffer. */
+  };
+
+  /**
+   * \brief per-call buffers of batched lookups.
+   */
+  struct BatchBuffers
+  {
+    std::vector<double> m_coords;  /**< gathered coordinates of a group, by dimension. */
+    std::vector<double> m_vals;  /**< values of the current vector. */
+    std::vector<double> m_best;  /**< best values. */
+    std::vector<int> m_bestVector;  /**< best vectors, -1 if none. */
+  };
+
+  const Node& findLeafNode (const double *pos) const;
+
+  double leafValue (const Leaf &lf, const double *pos) const;
+
+  int leafAction (const Leaf &lf, const double *pos) const;
+
+  void routePoints (const int &n, const double *const *pos, size_t *idx, const size_t &m,
+		    BatchBuffers &bb, double *values, int *actions) const;
+
+  void leafValues (const Leaf &lf, const double *const *pos, const size_t *idx, const size_t &m,
+		   BatchBuffers &bb, double *values, int *actions) const;
+
+  int bestVector (const Leaf &lf, const double *witness, const double &scale,
+		  double *retv) const;
+
+  void expectationFromNode (const int &n, const ContinuousStateDistribution &csd,
+			    double *low, double *high, double *cpt, double *expect) const;
+
+  void expectationInLeaf (const Leaf &lf, const ContinuousStateDistribution &csd,
+			  double *low, double *high, double *cpt, double *expect) const;
+
+  BspTreeType m_vfType;  /**< type of the original value function. */
+  int m_nDim;  /**< continuous space dimension. */
+  std::vector<Node> m_nodes;  /**< nodes, in breadth-first order. */
+  std::vector<Leaf> m_leaves;  /**< leaves data. */
+  std::vector<double> m_coeffs;  /**< alpha vectors coefficients. */
+  std::vector<int> m_vectorActions;  /**< first action of each alpha vector, -1 if none. */
+};
+
+} /* end of namespace */
+
+#endif
@@ -16,6 +16,7 @@
 
 #include "LpSolve5.h"
 #include "AlphaVector.h"
+#include "Metrics.h"
 #include <iostream>
 #include <stdio.h>
 #include <assert.h>
@@ -292,6 +293,7 @@ void LpSolve5::pruneLP (std::vector<AlphaVector*> *vav,
 			double *low, double *high,
 			std::vector<AlphaVector*> *res)
 {
+  MetricsTimer timer (METRICS_LP);
   //debug
   /* std::cout << "[Debug]: LpSolve5::pruneLP: ";
      std::cout << "low0: " << low[0] << " -- low1: " << low[1]
@@ -358,6 +360,7 @@ void LpSolve5::pruneLP (std::vector<CSVector*> *csv,
 			double *low, double *high,
 			std::vector<CSVector*> *res)
 {
+  MetricsTimer timer (METRICS_LP);
   //debug
   /* std::cout << "[Debug]: LpSolve5::pruneLP: ";
      std::cout << "low0: " << low[0] << " -- low1: " << low[1]
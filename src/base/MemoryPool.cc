@@ -0,0 +1,119 @@
+/**
+ * Copyright 2014 Emmanuel Benazera beniz@droidnik.fr
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MemoryPool.h"
+#include "Metrics.h"
+#include <new>
+
+namespace hmdp_base
+{
+
+struct FreeBlock
+{
+  FreeBlock *m_next;
+};
+
+/**
+ * \brief free lists of the calling thread.
+ */
+struct ThreadBlocks
+{
+  ThreadBlocks ()
+  {
+    for (size_t c=0; c<MemoryPool::m_nClasses; c++)
+      {
+	m_free[c] = NULL;
+	m_nFree[c] = 0;
+      }
+  }
+
+  ~ThreadBlocks ();
+
+  FreeBlock *m_free[MemoryPool::m_nClasses];
+  size_t m_nFree[MemoryPool::m_nClasses];
+};
+
+/* set once the calling thread's free lists are destroyed (thread or program exit):
+   blocks freed afterwards go to the system allocator. */
+static thread_local bool s_blocksDestroyed = false;
+
+ThreadBlocks::~ThreadBlocks ()
+{
+  for (size_t c=0; c<MemoryPool::m_nClasses; c++)
+    while (m_free[c])
+      {
+	FreeBlock *b = m_free[c];
+	m_free[c] = b->m_next;
+	::operator delete (b);
+      }
+  s_blocksDestroyed = true;
+}
+
+static ThreadBlocks& threadBlocks ()
+{
+  static thread_local ThreadBlocks tb;
+  return tb;
+}
+
+void* MemoryPool::allocate (const size_t &size)
+{
+  size_t c = (size + m_granularity - 1) / m_granularity;
+  if (c == 0 || c > m_nClasses || s_blocksDestroyed)
+    {
+      if (Metrics::isEnabled ())
+	Metrics::recordAllocation (size, true);
+      return ::operator new (size);
+    }
+  c--;
+  ThreadBlocks &tb = threadBlocks ();
+  FreeBlock *b = tb.m_free[c];
+  if (Metrics::isEnabled ())
+    Metrics::recordAllocation ((c + 1) * m_granularity, b == NULL);
+  if (b)
+    {
+      tb.m_free[c] = b->m_next;
+      tb.m_nFree[c]--;
+      return b;
+    }
+  return ::operator new ((c + 1) * m_granularity);
+}
+
+void MemoryPool::deallocate (void *p, const size_t &size)
+{
+  if (! p)
+    return;
+  if (Metrics::isEnabled ())
+    Metrics::recordDeallocation (size);
+  size_t c = (size + m_granularity - 1) / m_granularity;
+  if (c == 0 || c > m_nClasses || s_blocksDestroyed)
+    {
+      ::operator delete (p);
+      return;
+    }
+  c--;
+  ThreadBlocks &tb = threadBlocks ();
+  if (tb.m_nFree[c] >= m_maxCachedBlocks)
+    {
+      ::operator delete (p);
+      return;
+    }
+  FreeBlock *b = static_cast<FreeBlock*> (p);
+  b->m_next = tb.m_free[c];
+  tb.m_free[c] = b;
+  tb.m_nFree[c]++;
+}
+
+} /* end of namespace */
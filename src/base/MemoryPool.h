@@ -0,0 +1,64 @@
+/**
+ * Copyright 2014 Emmanuel Benazera beniz@droidnik.fr
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * \brief pooled allocation of the small objects that tree operations
+ *        create and destroy at a high rate: tree nodes, alpha vectors
+ *        and their elements.
+ *
+ * \author E. Benazera
+ */
+
+#ifndef MEMORYPOOL_H
+#define MEMORYPOOL_H
+
+#include <cstddef>
+
+namespace hmdp_base
+{
+
+/**
+ * \class MemoryPool
+ * \brief per-thread free lists of memory blocks, by size classes. Freed blocks
+ *        are kept for reuse by the next allocations of the same size class,
+ *        instead of being returned to the system allocator. Blocks can be freed
+ *        from another thread than the one that allocated them.
+ */
+class MemoryPool
+{
+ public:
+  /**
+   * \brief allocates a memory block.
+   * @param size block size in bytes.
+   * @return block of at least size bytes.
+   */
+  static void* allocate (const size_t &size);
+
+  /**
+   * \brief frees a memory block.
+   * @param p block, allocated by MemoryPool::allocate, or NULL.
+   * @param size block size in bytes, as given at allocation.
+   */
+  static void deallocate (void *p, const size_t &size);
+
+  static const size_t m_granularity = 16;  /**< size classes step, in bytes. */
+  static const size_t m_nClasses = 16;  /**< number of size classes, larger blocks are not pooled. */
+  static const size_t m_maxCachedBlocks = 8192;  /**< max number of free blocks kept per size class and thread. */
+};
+
+} /* end of namespace */
+
+#endif
@@ -0,0 +1,247 @@
+/**
+ * Copyright 2014 Emmanuel Benazera beniz@droidnik.fr
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Metrics.h"
+#include "BspTreeAlpha.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+namespace hmdp_base
+{
+
+std::atomic<bool> Metrics::m_enabled (false);
+std::chrono::steady_clock::time_point Metrics::m_start = std::chrono::steady_clock::now ();
+std::atomic<long long> Metrics::m_phaseTime[METRICS_NPHASES];
+std::atomic<long long> Metrics::m_phaseCalls[METRICS_NPHASES];
+std::atomic<long long> Metrics::m_counters[METRICS_NCOUNTERS];
+std::atomic<long long> Metrics::m_trees (0);
+std::atomic<long long> Metrics::m_treeNodes (0);
+std::atomic<long long> Metrics::m_treeLeaves (0);
+std::atomic<long long> Metrics::m_treeAlphas (0);
+std::atomic<long long> Metrics::m_maxTreeNodes (0);
+std::atomic<long long> Metrics::m_maxTreeLeaves (0);
+std::atomic<long long> Metrics::m_maxTreeAlphas (0);
+std::atomic<long long> Metrics::m_allocations (0);
+std::atomic<long long> Metrics::m_allocatedBytes (0);
+std::atomic<long long> Metrics::m_systemBytes (0);
+std::atomic<long long> Metrics::m_deallocatedBytes (0);
+std::ofstream Metrics::m_out;
+MetricsFormat Metrics::m_format = METRICS_JSON;
+double Metrics::m_interval = 0.0;
+std::thread Metrics::m_writer;
+std::mutex Metrics::m_writerMutex;
+std::condition_variable Metrics::m_writerCond;
+bool Metrics::m_writerStop = false;
+
+static const char *s_phaseNames[METRICS_NPHASES]
+  = { "discovery", "reward", "transition", "max", "residual", "expectation", "frontup", "lp" };
+
+static const char *s_counterNames[METRICS_NCOUNTERS]
+  = { "states", "state_backups", "action_backups" };
+
+void Metrics::reset ()
+{
+  for (int p=0; p<METRICS_NPHASES; p++)
+    {
+      m_phaseTime[p] = 0;
+      m_phaseCalls[p] = 0;
+    }
+  for (int c=0; c<METRICS_NCOUNTERS; c++)
+    m_counters[c] = 0;
+  m_trees = 0; m_treeNodes = 0; m_treeLeaves = 0; m_treeAlphas = 0;
+  m_maxTreeNodes = 0; m_maxTreeLeaves = 0; m_maxTreeAlphas = 0;
+  m_allocations = 0; m_allocatedBytes = 0; m_systemBytes = 0; m_deallocatedBytes = 0;
+  m_start = std::chrono::steady_clock::now ();
+}
+
+void Metrics::addPhaseTime (const MetricsPhase &phase, const long long &ns)
+{
+  m_phaseTime[phase].fetch_add (ns, std::memory_order_relaxed);
+  m_phaseCalls[phase].fetch_add (1, std::memory_order_relaxed);
+}
+
+void Metrics::count (const MetricsCounter &counter, const long long &n)
+{
+  if (isEnabled ())
+    m_counters[counter].fetch_add (n, std::memory_order_relaxed);
+}
+
+void Metrics::updateMax (std::atomic<long long> &m, const long long &v)
+{
+  long long cur = m.load (std::memory_order_relaxed);
+  while (v > cur && ! m.compare_exchange_weak (cur, v, std::memory_order_relaxed)) {}
+}
+
+void Metrics::recordTree (const BspTreeAlpha *bt)
+{
+  if (! isEnabled () || ! bt)
+    return;
+  long long nodes = 0, leaves = 0, alphas = 0;
+  std::vector<const BspTree*> stack (1, bt);
+  while (! stack.empty ())
+    {
+      const BspTree *t = stack.back ();
+      stack.pop_back ();
+      nodes++;
+      if (t->isLeaf ())
+	{
+	  leaves++;
+	  const BspTreeAlpha *ta = static_cast<const BspTreeAlpha*> (t);
+	  if (ta->getAlphaVectors ())
+	    alphas += ta->getAlphaVectorsSize ();
+	}
+      else
+	{
+	  stack.push_back (t->getLowerTree ());
+	  stack.push_back (t->getGreaterTree ());
+	}
+    }
+  m_trees.fetch_add (1, std::memory_order_relaxed);
+  m_treeNodes.fetch_add (nodes, std::memory_order_relaxed);
+  m_treeLeaves.fetch_add (leaves, std::memory_order_relaxed);
+  m_treeAlphas.fetch_add (alphas, std::memory_order_relaxed);
+  updateMax (m_maxTreeNodes, nodes);
+  updateMax (m_maxTreeLeaves, leaves);
+  updateMax (m_maxTreeAlphas, alphas);
+}
+
+void Metrics::recordAllocation (const size_t &size, const bool &system)
+{
+  m_allocations.fetch_add (1, std::memory_order_relaxed);
+  m_allocatedBytes.fetch_add (size, std::memory_order_relaxed);
+  if (system)
+    m_systemBytes.fetch_add (size, std::memory_order_relaxed);
+}
+
+void Metrics::recordDeallocation (const size_t &size)
+{
+  m_deallocatedBytes.fetch_add (size, std::memory_order_relaxed);
+}
+
+double Metrics::elapsed ()
+{
+  return std::chrono::duration<double> (std::chrono::steady_clock::now () - m_start).count ();
+}
+
+const char* Metrics::phaseName (const MetricsPhase &phase)
+{
+  return s_phaseNames[phase];
+}
+
+const char* Metrics::counterName (const MetricsCounter &counter)
+{
+  return s_counterNames[counter];
+}
+
+void Metrics::writeJSON (std::ostream &out)
+{
+  out << std::setprecision (9) << "{\"elapsed\":" << Metrics::elapsed () << ",\"phases\":{";
+  for (int p=0; p<METRICS_NPHASES; p++)
+    out << (p ? "," : "") << "\"" << s_phaseNames[p] << "\":{\"seconds\":"
+	<< m_phaseTime[p].load () * 1e-9 << ",\"calls\":" << m_phaseCalls[p].load () << "}";
+  out << "},\"counters\":{";
+  for (int c=0; c<METRICS_NCOUNTERS; c++)
+    out << (c ? "," : "") << "\"" << s_counterNames[c] << "\":" << m_counters[c].load ();
+  out << "},\"trees\":{\"count\":" << m_trees.load ()
+      << ",\"nodes\":" << m_treeNodes.load () << ",\"leaves\":" << m_treeLeaves.load ()
+      << ",\"alpha_vectors\":" << m_treeAlphas.load ()
+      << ",\"max_nodes\":" << m_maxTreeNodes.load () << ",\"max_leaves\":" << m_maxTreeLeaves.load ()
+      << ",\"max_alpha_vectors\":" << m_maxTreeAlphas.load ()
+      << "},\"allocations\":{\"count\":" << m_allocations.load ()
+      << ",\"bytes\":" << m_allocatedBytes.load () << ",\"system_bytes\":" << m_systemBytes.load ()
+      << ",\"freed_bytes\":" << m_deallocatedBytes.load () << "}}" << std::endl;
+}
+
+void Metrics::writeCSVHeader (std::ostream &out)
+{
+  out << "elapsed";
+  for (int p=0; p<METRICS_NPHASES; p++)
+    out << "," << s_phaseNames[p] << "_seconds," << s_phaseNames[p] << "_calls";
+  for (int c=0; c<METRICS_NCOUNTERS; c++)
+    out << "," << s_counterNames[c];
+  out << ",trees,tree_nodes,tree_leaves,tree_alpha_vectors,max_tree_nodes,max_tree_leaves,max_tree_alpha_vectors"
+      << ",allocations,allocated_bytes,system_bytes,freed_bytes" << std::endl;
+}
+
+void Metrics::writeCSV (std::ostream &out)
+{
+  out << std::setprecision (9) << Metrics::elapsed ();
+  for (int p=0; p<METRICS_NPHASES; p++)
+    out << "," << m_phaseTime[p].load () * 1e-9 << "," << m_phaseCalls[p].load ();
+  for (int c=0; c<METRICS_NCOUNTERS; c++)
+    out << "," << m_counters[c].load ();
+  out << "," << m_trees.load () << "," << m_treeNodes.load () << "," << m_treeLeaves.load ()
+      << "," << m_treeAlphas.load () << "," << m_maxTreeNodes.load () << "," << m_maxTreeLeaves.load ()
+      << "," << m_maxTreeAlphas.load () << "," << m_allocations.load () << "," << m_allocatedBytes.load ()
+      << "," << m_systemBytes.load () << "," << m_deallocatedBytes.load () << std::endl;
+}
+
+void Metrics::writeSnapshot ()
+{
+  if (m_format == METRICS_CSV)
+    Metrics::writeCSV (m_out);
+  else Metrics::writeJSON (m_out);
+}
+
+bool Metrics::startOutput (const std::string &filename, const MetricsFormat &format,
+			   const double &interval)
+{
+  m_out.open (filename.c_str (), std::ios::out);
+  if (! m_out.is_open ())
+    {
+      std::cerr << "[Error]:Metrics::startOutput: cannot open " << filename << std::endl;
+      return false;
+    }
+  m_format = format;
+  m_interval = interval;
+  if (m_format == METRICS_CSV)
+    Metrics::writeCSVHeader (m_out);
+  Metrics::reset ();
+  Metrics::enable (true);
+  m_writerStop = false;
+  if (m_interval > 0.0)
+    m_writer = std::thread (&Metrics::writerLoop);
+  return true;
+}
+
+void Metrics::stopOutput ()
+{
+  if (! m_out.is_open ())
+    return;
+  if (m_writer.joinable ())
+    {
+      {
+	std::lock_guard<std::mutex> lock (m_writerMutex);
+	m_writerStop = true;
+      }
+      m_writerCond.notify_all ();
+      m_writer.join ();
+    }
+  Metrics::writeSnapshot ();
+  m_out.close ();
+  Metrics::enable (false);
+}
+
+void Metrics::writerLoop ()
+{
+  std::unique_lock<std::mutex> lock (m_writerMutex);
+  std::chrono::duration<double> interval (m_interval);
+  while (! m_writerCond.wait_for (lock, interval, [] () { return m_writerStop; }))
+    Metrics::writeSnapshot ();
+}
+
+} /* end of namespace */
@@ -0,0 +1,244 @@
+/**
+ * Copyright 2014 Emmanuel Benazera beniz@droidnik.fr
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * \brief solver metrics: time spent per phase, counters, sizes of the
+ *        value functions and allocation volume, with machine-readable
+ *        snapshots (JSON or CSV).
+ *
+ * \author E. Benazera
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace hmdp_base
+{
+
+  class BspTreeAlpha;
+
+/**
+ * \brief solver phases that are timed.
+ */
+enum MetricsPhase
+{
+  METRICS_DISCOVERY = 0,   /**< state-space discovery. */
+  METRICS_REWARD,          /**< rewards from goals, intersected with the next value functions. */
+  METRICS_TRANSITION,      /**< transition backups (convolutions of value functions). */
+  METRICS_MAX,             /**< max over the actions q-values. */
+  METRICS_RESIDUAL,        /**< Bellman residuals. */
+  METRICS_EXPECTATION,     /**< expectations of value functions over state distributions. */
+  METRICS_FRONTUP,         /**< state distributions front-up through transitions. */
+  METRICS_LP,              /**< linear programming pruning of alpha vectors. */
+  METRICS_NPHASES
+};
+
+/**
+ * \brief solver counters.
+ */
+enum MetricsCounter
+{
+  METRICS_STATES = 0,      /**< states added to the state graph. */
+  METRICS_STATE_BACKUPS,   /**< state backups that changed the state value function. */
+  METRICS_ACTION_BACKUPS,  /**< action (q-value) backups. */
+  METRICS_NCOUNTERS
+};
+
+/**
+ * \brief snapshots output formats.
+ */
+enum MetricsFormat
+{
+  METRICS_JSON,  /**< one JSON object per line and snapshot. */
+  METRICS_CSV    /**< a header line, then one line per snapshot. */
+};
+
+/**
+ * \class Metrics
+ * \brief static class collecting solver metrics. Metrics are collected only once
+ *        enabled, and are thread-safe. Time spent in a phase is measured with a
+ *        monotonic clock and summed over the threads running the phase.
+ */
+class Metrics
+{
+ public:
+  /**
+   * \brief enables (or disables) the collection of metrics.
+   */
+  static void enable (const bool &on) { m_enabled.store (on, std::memory_order_relaxed); }
+
+  /**
+   * \brief whether metrics are collected.
+   */
+  static bool isEnabled () { return m_enabled.load (std::memory_order_relaxed); }
+
+  /**
+   * \brief resets all metrics, and the elapsed time.
+   */
+  static void reset ();
+
+  /**
+   * \brief accounts for time spent in a phase.
+   * @param phase the phase,
+   * @param ns duration in nanoseconds.
+   */
+  static void addPhaseTime (const MetricsPhase &phase, const long long &ns);
+
+  /**
+   * \brief increments a counter.
+   */
+  static void count (const MetricsCounter &counter, const long long &n=1);
+
+  /**
+   * \brief accounts for the size of a value function (nodes, leaves and alpha vectors).
+   * @param bt tree.
+   */
+  static void recordTree (const BspTreeAlpha *bt);
+
+  /**
+   * \brief accounts for a pooled allocation.
+   * @param size block size in bytes,
+   * @param system whether the block comes from the system allocator.
+   */
+  static void recordAllocation (const size_t &size, const bool &system);
+
+  /**
+   * \brief accounts for a pooled deallocation.
+   * @param size block size in bytes.
+   */
+  static void recordDeallocation (const size_t &size);
+
+  /**
+   * \brief number of pooled allocations since the last reset.
+   */
+  static long long getAllocations () { return m_allocations.load (); }
+
+  /**
+   * \brief bytes of the pooled allocations since the last reset.
+   */
+  static long long getAllocatedBytes () { return m_allocatedBytes.load (); }
+
+  /**
+   * \brief writes a snapshot of all metrics as a JSON object, on a single line.
+   */
+  static void writeJSON (std::ostream &out);
+
+  /**
+   * \brief writes the header line of the CSV snapshots.
+   */
+  static void writeCSVHeader (std::ostream &out);
+
+  /**
+   * \brief writes a snapshot of all metrics as a CSV line.
+   */
+  static void writeCSV (std::ostream &out);
+
+  /**
+   * \brief enables metrics and starts writing snapshots to a file.
+   * @param filename output file,
+   * @param format snapshots format,
+   * @param interval seconds between snapshots, 0 for a final snapshot only.
+   * @return false if the file cannot be opened.
+   * @sa stopOutput
+   */
+  static bool startOutput (const std::string &filename, const MetricsFormat &format,
+			   const double &interval);
+
+  /**
+   * \brief writes a final snapshot and closes the output file.
+   */
+  static void stopOutput ();
+
+  /**
+   * \brief phase name, as used in snapshots.
+   */
+  static const char* phaseName (const MetricsPhase &phase);
+
+  /**
+   * \brief counter name, as used in snapshots.
+   */
+  static const char* counterName (const MetricsCounter &counter);
+
+ private:
+  static void writeSnapshot ();
+  static void writerLoop ();
+  static double elapsed ();
+  static void updateMax (std::atomic<long long> &m, const long long &v);
+
+  static std::atomic<bool> m_enabled;  /**< whether metrics are collected. */
+  static std::chrono::steady_clock::time_point m_start;  /**< time of the last reset. */
+  static std::atomic<long long> m_phaseTime[METRICS_NPHASES];  /**< time per phase, in ns. */
+  static std::atomic<long long> m_phaseCalls[METRICS_NPHASES];  /**< timed calls per phase. */
+  static std::atomic<long long> m_counters[METRICS_NCOUNTERS];
+  static std::atomic<long long> m_trees;  /**< recorded trees. */
+  static std::atomic<long long> m_treeNodes;  /**< nodes, over all recorded trees. */
+  static std::atomic<long long> m_treeLeaves;  /**< leaves, over all recorded trees. */
+  static std::atomic<long long> m_treeAlphas;  /**< alpha vectors, over all recorded trees. */
+  static std::atomic<long long> m_maxTreeNodes;
+  static std::atomic<long long> m_maxTreeLeaves;
+  static std::atomic<long long> m_maxTreeAlphas;
+  static std::atomic<long long> m_allocations;  /**< pooled allocations. */
+  static std::atomic<long long> m_allocatedBytes;  /**< bytes of the pooled allocations. */
+  static std::atomic<long long> m_systemBytes;  /**< bytes obtained from the system allocator. */
+  static std::atomic<long long> m_deallocatedBytes;  /**< bytes of the pooled deallocations. */
+
+  static std::ofstream m_out;  /**< snapshots output. */
+  static MetricsFormat m_format;
+  static double m_interval;
+  static std::thread m_writer;  /**< writes the periodic snapshots. */
+  static std::mutex m_writerMutex;
+  static std::condition_variable m_writerCond;
+  static bool m_writerStop;
+};
+
+/**
+ * \class MetricsTimer
+ * \brief accounts for the time spent in a phase, from construction to destruction.
+ */
+class MetricsTimer
+{
+ public:
+  MetricsTimer (const MetricsPhase &phase)
+    : m_phase (phase), m_on (Metrics::isEnabled ())
+  {
+    if (m_on)
+      m_start = std::chrono::steady_clock::now ();
+  }
+
+  ~MetricsTimer ()
+  {
+    if (m_on)
+      Metrics::addPhaseTime (m_phase, std::chrono::duration_cast<std::chrono::nanoseconds>
+			     (std::chrono::steady_clock::now () - m_start).count ());
+  }
+
+ private:
+  MetricsPhase m_phase;
+  bool m_on;
+  std::chrono::steady_clock::time_point m_start;
+};
+
+} /* end of namespace */
+
+#endif
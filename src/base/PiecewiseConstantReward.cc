@@ -56,7 +56,7 @@ PiecewiseConstantReward::PiecewiseConstantReward (const int &dimension, const in
      create a tree for each tile, and intersect them. */
   PiecewiseConstantReward *bsp_n = this;
   PiecewiseConstantReward *bsp_c = this;
-  BspTreeOperations::setIntersectionType (BTI_INIT); /* leaf intersection type */
+  BspOpContext ctx (BTI_INIT); /* leaf intersection type */
 
   for (int tiles=0; tiles<m_tilingDimension; tiles++)
     {
@@ -101,7 +101,7 @@ PiecewiseConstantReward::PiecewiseConstantReward (const int &dimension, const in
 	}
       if (tiles > 0)
 	{
-	  BspTree *intersectedTree = BspTreeOperations::intersectTrees (this, bsp_c, low, high);
+	  BspTree *intersectedTree = BspTreeOperations::intersectTrees (ctx, this, bsp_c, low, high);
 	  BspTree::deleteBspTree (bsp_c); bsp_c = 0; 
 	  if (m_lt) BspTree::deleteBspTree (m_lt);
 	  if (m_ge) BspTree::deleteBspTree (m_ge);
@@ -153,7 +153,7 @@ PiecewiseConstantReward::PiecewiseConstantReward (const PiecewiseConstantReward
   : ContinuousReward (cr.getTilingDimension (), cr.getSpaceDimension (), cr.getDimension (), cr.getPosition ())
 {
   m_bspType = PiecewiseConstantRewardT;
-  m_maxValue = cr.getSubTreeMaxValue ();
+  copySubTreeBounds (cr);
 
   /* copy alpha vectors */
   if (cr.getAlphaVectors ())
@@ -325,10 +325,10 @@ void PiecewiseConstantReward::mergeContiguousLeaves (ContinuousReward *root, Con
   double c1 = pcrlt->getConstantValue ();
   double c2 = pcrge->getConstantValue ();
   
-  if ((BspTreeOperations::m_piecesMergingByValue
-       && Alg::REqual (c1, c2, Alg::m_doubleEpsilon))     /* merge by value only. */
-      || (BspTreeOperations::m_piecesMergingEquality
-	  && Alg::REqual (c1, c2, Alg::m_doubleEpsilon)
+  if ((BspTreeOperations::context ().m_piecesMergingByValue
+       && Alg::REqual (c1, c2, BspTreeOperations::context ().m_epsilon))     /* merge by value only. */
+      || (BspTreeOperations::context ().m_piecesMergingEquality
+	  && Alg::REqual (c1, c2, BspTreeOperations::context ().m_epsilon)
 	  && (pcrlt->getAchievedGoals () && pcrge->getAchievedGoals ())
 	  && (Alg::eqVectorInt (*pcrlt->getAchievedGoals (),
 				*pcrge->getAchievedGoals ()))))
@@ -342,31 +342,6 @@ void PiecewiseConstantReward::mergeContiguousLeaves (ContinuousReward *root, Con
     }
 }
 
-/* stuff for asymetric operators. Warning: this applies to the constant case only (for now). */
-double PiecewiseConstantReward::updateSubTreeMaxValue ()
-{
-  if (isLeaf ())
-    {
-      if (m_alphaVectors)
-	{
-	  m_maxValue = getConstantValue ();
-	  return m_maxValue;
-	}
-      else return 0.0; /* beware. */
-    }
-  else
-    {
-      PiecewiseConstantReward *crlt 
-	= static_cast<PiecewiseConstantReward*> (getLowerTree ());
-      double low_max = crlt->updateSubTreeMaxValue ();
-      PiecewiseConstantReward *crge 
-	= static_cast<PiecewiseConstantReward*> (getGreaterTree ());
-      double high_max = crge->updateSubTreeMaxValue ();
-      m_maxValue = std::max (low_max, high_max);
-      return m_maxValue;
-    }
-}
-
 /* plot of a leaf uses a vrml box */
 void PiecewiseConstantReward::plot2DVrml2Leaf (const double &space, std::ofstream &output_vrml, 
 					       double *low, double *high,
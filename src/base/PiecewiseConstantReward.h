@@ -125,9 +125,6 @@ class PiecewiseConstantReward : public ContinuousReward
    */
   void mergeContiguousLeaves (ContinuousReward *root, ContinuousReward *lt, ContinuousReward *ge);
 
-  /* stuff for asymetric operators. */
-  double updateSubTreeMaxValue ();
-
   /* accessors */
   double getConstantValue () const 
   { if (m_alphaVectors) return (*m_alphaVectors)[0]->getAlphaNth (0);
@@ -94,7 +94,7 @@ PiecewiseConstantValueFunction::PiecewiseConstantValueFunction (const PiecewiseC
 {
   m_bspType = PiecewiseConstantVFT;
   m_csd = pcvf.getCSDFlag ();
-  m_maxValue = pcvf.getSubTreeMaxValue ();
+  copySubTreeBounds (pcvf);
 
   /* copy alpha vectors */
   if (pcvf.getAlphaVectors ())
@@ -122,11 +122,7 @@ PiecewiseConstantValueFunction::PiecewiseConstantValueFunction (const Continuous
   : ValueFunction (cr.getSpaceDimension (), cr.getDimension (), cr.getPosition ())
 {
   m_bspType = PiecewiseConstantVFT;
-  m_maxValue = cr.getSubTreeMaxValue ();
-
-  /* set max value. */
-  if (cr.getType () == PiecewiseConstantRewardT)
-    m_maxValue = cr.getSubTreeMaxValue ();
+  copySubTreeBounds (cr);
 
   /* copy alpha vectors. */
   if (cr.getAlphaVectors ())
@@ -308,9 +304,6 @@ void PiecewiseConstantValueFunction::leafDataIntersectMax (const BspTree &bt, co
   
   if (m_alphaVectors && getConstantValue () == 0.0)
     (*m_alphaVectors)[0]->clearActions ();
-
-  if (BspTreeOperations::m_asymetricOperators)
-    m_maxValue = getConstantValue ();
 }
 
 void PiecewiseConstantValueFunction::leafDataIntersectPlus (const BspTree &bt, const BspTree &btr,
@@ -336,9 +329,6 @@ void PiecewiseConstantValueFunction::leafDataIntersectPlus (const BspTree &bt, c
 
   /* unionize goal sets */
   unionGoalSets (pcvfa, pcvfb);
-
-  if (BspTreeOperations::m_asymetricOperators)
-    m_maxValue = getConstantValue ();
 }
 
 void PiecewiseConstantValueFunction::leafDataIntersectMinus (const BspTree &bt, const BspTree &btr,
@@ -373,9 +363,6 @@ void PiecewiseConstantValueFunction::leafDataIntersectMinus (const BspTree &bt,
 
   /* unionize goal sets */
   unionGoalSets (pcvfa, pcvfb);
-
-  if (BspTreeOperations::m_asymetricOperators)
-    m_maxValue = getConstantValue ();
 }
 
 void PiecewiseConstantValueFunction::mergeContiguousLeaves (ValueFunction *root, ValueFunction *lt,
@@ -388,13 +375,13 @@ void PiecewiseConstantValueFunction::mergeContiguousLeaves (ValueFunction *root,
   double c1 = pcvflt->getConstantValue ();
   double c2 = pcvfge->getConstantValue ();
 
-  if ((BspTreeOperations::m_piecesMergingByValue
-       && Alg::REqual (c1, c2, Alg::m_doubleEpsilon))     /* merge by value only. */
-      || (BspTreeOperations::m_piecesMergingByAction
+  if ((BspTreeOperations::context ().m_piecesMergingByValue
+       && Alg::REqual (c1, c2, BspTreeOperations::context ().m_epsilon))     /* merge by value only. */
+      || (BspTreeOperations::context ().m_piecesMergingByAction
 	  && AlphaVector::isEqualActionSets (pcvflt->bestTileActions (),
 					     pcvfge->bestTileActions ()))
-      || (BspTreeOperations::m_piecesMergingEquality
-	  && Alg::REqual (c1, c2, Alg::m_doubleEpsilon)
+      || (BspTreeOperations::context ().m_piecesMergingEquality
+	  && Alg::REqual (c1, c2, BspTreeOperations::context ().m_epsilon)
 	  && AlphaVector::isEqualActionSets (pcvflt->bestTileActions (),
 					     pcvfge->bestTileActions ())))
 	  /* && (pcvflt->getAchievedGoals () && pcvfge->getAchievedGoals ())
@@ -403,19 +390,12 @@ void PiecewiseConstantValueFunction::mergeContiguousLeaves (ValueFunction *root,
     {
       /* transfer data to root and delete leaves. */
       if (c1 < c2)
-	{
-	  transferData (*pcvflt);
-	  m_maxValue = c1;
-	}
-      else
-	{
-	  transferData (*pcvfge);
-	  m_maxValue = c2;
-	}
+	transferData (*pcvflt);
+      else transferData (*pcvfge);
 
       /* unionize goal sets */
-      if (BspTreeOperations::m_piecesMergingByValue
-	  || BspTreeOperations::m_piecesMergingByAction)
+      if (BspTreeOperations::context ().m_piecesMergingByValue
+	  || BspTreeOperations::context ().m_piecesMergingByAction)
 	{
 	  unionGoalSets (*pcvflt, *pcvfge);
 	}
@@ -455,46 +435,18 @@ void PiecewiseConstantValueFunction::expectedValueFromLeaves (double *val,
     }
 }
 
-std::set<int> PiecewiseConstantValueFunction::bestTileActions ()
+void PiecewiseConstantValueFunction::expectedValueInTile (const double &prob, const double *low,
+							  const double *high, double *val) const
 {
   if (m_alphaVectors)
-    return getAlphaVectorNth (0)->m_actions;
-  else return std::set<int> (); 
+    *val += getConstantValue () * prob;
 }
 
-/* stuff for asymetric operators. Warning: this applies to the constant case only (for now). */
-double PiecewiseConstantValueFunction::updateSubTreeMaxValue ()
-{
-  if (isLeaf ())
-    {
-      if (m_alphaVectors)
-	{
-	  m_maxValue = getConstantValue ();
-	  return m_maxValue;
-	}
-      else return 0.0; /* beware. */
-    }
-  else
-    {
-      PiecewiseConstantValueFunction *vflt 
-	= static_cast<PiecewiseConstantValueFunction*> (getLowerTree ());
-      double low_max = vflt->updateSubTreeMaxValue ();
-      PiecewiseConstantValueFunction *vfge 
-	= static_cast<PiecewiseConstantValueFunction*> (getGreaterTree ());
-      double high_max = vfge->updateSubTreeMaxValue ();
-      m_maxValue = std::max (low_max, high_max);
-      return m_maxValue;
-    }
-}
-
-double PiecewiseConstantValueFunction::updateSubTreeMaxValue (ValueFunction *vflt,
-							      ValueFunction *vfge)
+std::set<int> PiecewiseConstantValueFunction::bestTileActions ()
 {
-  PiecewiseConstantValueFunction *pcvflt 
-    = static_cast<PiecewiseConstantValueFunction*> (vflt);
-  PiecewiseConstantValueFunction *pcvfge 
-    = static_cast<PiecewiseConstantValueFunction*> (vfge);
-  return std::max (pcvflt->getSubTreeMaxValue (), pcvfge->getSubTreeMaxValue ());
+  if (m_alphaVectors)
+    return getAlphaVectorNth (0)->m_actions;
+  else return std::set<int> (); 
 }
 
 /* printing */
@@ -140,6 +140,9 @@ class PiecewiseConstantValueFunction : public ValueFunction
    * @sa ValueFunction::computeExpectation
    */
   void expectedValueFromLeaves (double *val, double *low, double *high);
+
+  void expectedValueInTile (const double &prob, const double *low, const double *high,
+			    double *val) const;
   
   /**
    * \brief get the best action in a tile (leaf).
@@ -156,11 +159,6 @@ class PiecewiseConstantValueFunction : public ValueFunction
       return 0.0;
     }}  /* beware error value */
 
-  /* stuff for asymetric operators. */
-  double updateSubTreeMaxValue ();
-
-  double updateSubTreeMaxValue (ValueFunction *vflt, ValueFunction *vfge);
-
  protected:
   /* printing */
   void plot1DVF (std::ofstream &box, double *low, double *high);
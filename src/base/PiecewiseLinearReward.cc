@@ -55,7 +55,7 @@ PiecewiseLinearReward::PiecewiseLinearReward (const int &dimension, const int &s
      create a tree for each tile, and intersect them. */
   PiecewiseLinearReward *bsp_n = this;
   PiecewiseLinearReward *bsp_c = this;
-  BspTreeOperations::setIntersectionType (BTI_INIT); /* leaf intersection type */
+  BspOpContext ctx (BTI_INIT); /* leaf intersection type */
 
   for (int tiles=0; tiles<m_tilingDimension; tiles++)
     {
@@ -106,7 +106,7 @@ PiecewiseLinearReward::PiecewiseLinearReward (const int &dimension, const int &s
 	}
       if (tiles > 0)
 	{
-	  BspTree *intersectedTree = BspTreeOperations::intersectTrees (this, bsp_c, low, high);
+	  BspTree *intersectedTree = BspTreeOperations::intersectTrees (ctx, this, bsp_c, low, high);
 	  BspTree::deleteBspTree (bsp_c); bsp_c = 0; 
 	  if (m_lt) BspTree::deleteBspTree (m_lt);
 	  if (m_ge) BspTree::deleteBspTree (m_ge);
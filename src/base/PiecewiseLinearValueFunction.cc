@@ -356,14 +356,18 @@ void PiecewiseLinearValueFunction::leafDataIntersectMax (const BspTree &bt, cons
 	delete (*m_alphaVectors)[i];
     }
 
-  if (plvfa.getAlphaVectors () && plvfb.getAlphaVectors ())
+  /* a leaf whose values are all above the other's is the max (see value bounds). */
+  bool adom = plvfa.getAlphaVectors () && plvfb.getAlphaVectors () && plvfa.dominates (plvfb, 0.0);
+  bool bdom = plvfa.getAlphaVectors () && plvfb.getAlphaVectors () && plvfb.dominates (plvfa, 0.0);
+
+  if (plvfa.getAlphaVectors () && plvfb.getAlphaVectors () && ! adom && ! bdom)
     {
       if (! m_alphaVectors)
         m_alphaVectors = new std::vector<AlphaVector*> ();
       AlphaVector::maxLinearAlphaVector (*plvfa.getAlphaVectors (), *plvfb.getAlphaVectors (), 
 					 low, high, m_alphaVectors);
     }
-  else if (plvfa.getAlphaVectors ())
+  else if (plvfa.getAlphaVectors () && ! bdom)
     {
       for (unsigned int i=0; i<plvfa.getAlphaVectorsSize (); i++)
 	m_alphaVectors->push_back (new AlphaVector (*plvfa.getAlphaVectorNth (i)));
@@ -538,15 +542,15 @@ void PiecewiseLinearValueFunction::mergeContiguousLeaves (ValueFunction *root, V
   if (! vavlt || ! vavge)
     return;
 
-  if (BspTreeOperations::m_piecesMergingByValue
+  if (BspTreeOperations::context ().m_piecesMergingByValue
       && AlphaVector::isVecEqual (*vavlt, *vavge))   /* TODO: merge by action & merge on equality */
     {
       /* transfer data to root and detete leaves. */
       transferData (*plvfge);
       
       /* unionize goal sets */
-      /* if (BspTreeOperations::m_piecesMergingByValue
-	 || BspTreeOperations::m_piecesMergingByAction) */
+      /* if (BspTreeOperations::context ().m_piecesMergingByValue
+	 || BspTreeOperations::context ().m_piecesMergingByAction) */
       unionGoalSets (*plvflt, *plvfge);
       
       delete plvflt; plvflt = 0;
@@ -554,7 +558,7 @@ void PiecewiseLinearValueFunction::mergeContiguousLeaves (ValueFunction *root, V
       setLowerTree (0);
       setGreaterTree (0);
     }
-  else if (BspTreeOperations::m_piecesMergingByAction
+  else if (BspTreeOperations::context ().m_piecesMergingByAction
 	   && AlphaVector::isVecEqual (*vavlt, *vavge))
     {
       /* transfer data to root and detete leaves. */
@@ -567,7 +571,7 @@ void PiecewiseLinearValueFunction::mergeContiguousLeaves (ValueFunction *root, V
       setGreaterTree (0);
     }
 #ifdef HAVE_LP
-  else if (BspTreeOperations::m_piecesMergingByValue)
+  else if (BspTreeOperations::context ().m_piecesMergingByValue)
     {
       bool pwl_merge = true;
       double low_piece[getSpaceDimension ()], high_piece[getSpaceDimension ()];
@@ -596,8 +600,8 @@ void PiecewiseLinearValueFunction::mergeContiguousLeaves (ValueFunction *root, V
 	      transferData (*plvfge);
 	      
 	      /* unionize goal sets */
-	      if (BspTreeOperations::m_piecesMergingByValue
-		  || BspTreeOperations::m_piecesMergingByAction)
+	      if (BspTreeOperations::context ().m_piecesMergingByValue
+		  || BspTreeOperations::context ().m_piecesMergingByAction)
 		unionGoalSets (*plvflt, *plvfge);
 	      
 	      delete plvflt; plvflt = 0;
@@ -650,6 +654,51 @@ void PiecewiseLinearValueFunction::expectedValueFromLeaves (double *val,
     }
 }
 
+void PiecewiseLinearValueFunction::expectedValueInTile (const double &prob, const double *low,
+							const double *high, double *val) const
+{
+  if (! m_alphaVectors)
+    return;
+  
+  /* 'witness' vector at tile center point, as in expectedValueFromLeaves, with the
+     semantics of AlphaVector::bestAlphaVector on the vectors multiplied by prob. */
+  double bval = -100000000.0;
+  AlphaVector *wtAv = 0;
+  for (unsigned int i=0; i<m_alphaVectors->size (); i++)
+    {
+      AlphaVector *av = (*m_alphaVectors)[i];
+      int last = av->getSize () - 1;
+      double v = av->getAlphaNth (last) * prob;  /* constant */
+      for (int j=0; j<last; j++)
+	v += (av->getAlphaNth (j) * prob * ((high[j] - low[j]) / 2.0));
+      if (v > bval)
+	{
+	  wtAv = av;
+	  bval = v;
+	}
+      else if (v == bval && wtAv)  /* lexicographical dominance. */
+	{
+	  for (int k=0; k<last; k++)
+	    if (av->getAlphaNth (k) > wtAv->getAlphaNth (k))
+	      {
+		wtAv = av;
+		break;
+	      }
+	}
+    }
+  if (! wtAv)
+    return;
+  
+  double expect_ct = 1.0, expect_fct = 1.0;
+  for (int i=0; i<m_nDim; i++)
+    {
+      expect_ct *= (high[i] - low[i]);
+      expect_fct *= 0.5*(wtAv->getAlphaNth (i) * prob) * (high[i]*high[i] - low[i]*low[i]);
+    }
+  expect_ct *= (wtAv->getAlphaNth (m_nDim) * prob); /* constant */
+  *val += expect_ct; *val += expect_fct;
+}
+
 double PiecewiseLinearValueFunction::getPointValueInLeaf (double *pos)
 {
   double val = 0.0;
@@ -658,4 +707,15 @@ double PiecewiseLinearValueFunction::getPointValueInLeaf (double *pos)
   return val;
 }
 
+int PiecewiseLinearValueFunction::getPointActionInLeaf (double *pos)
+{
+  if (! m_alphaVectors)
+    return -1;
+  double val;
+  AlphaVector *bav = AlphaVector::bestAlphaVector (*m_alphaVectors, pos, &val);
+  if (! bav || bav->m_actions.empty ())
+    return -1;
+  return (*bav->m_actions.begin ());  /* first action of the best vector at pos. */
+}
+
 } /* end of namespace */
@@ -139,6 +139,9 @@ class PiecewiseLinearValueFunction : public ValueFunction
    */
   void expectedValueFromLeaves (double *val, double *low, double *high);
 
+  void expectedValueInTile (const double &prob, const double *low, const double *high,
+			    double *val) const;
+
   int bestTileAction () { std::cout << "[Warning]: PiecewiseLinearValueFunction::bestTileAction: no implemented yet.\n";
     return 0;
   }
@@ -148,7 +151,7 @@ class PiecewiseLinearValueFunction : public ValueFunction
   
   double getPointValueInLeaf (double *pos);
 
-  int getPointActionInLeaf (double *pos) { /* TODO */ return 0;};
+  int getPointActionInLeaf (double *pos);
 };
 
 } /* end of namespace */
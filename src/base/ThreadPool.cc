@@ -0,0 +1,98 @@
+/**
+ * Copyright 2014 Emmanuel Benazera beniz@droidnik.fr
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ThreadPool.h"
+
+namespace hmdp_base
+{
+
+ThreadPool::ThreadPool (const int &nthreads)
+  : m_stop (false)
+{
+  for (int i=1; i<nthreads; i++)
+    m_workers.push_back (std::thread (&ThreadPool::workerLoop, this));
+}
+
+ThreadPool::~ThreadPool ()
+{
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_stop = true;
+  }
+  m_taskCond.notify_all ();
+  for (size_t i=0; i<m_workers.size (); i++)
+    m_workers[i].join ();
+}
+
+void ThreadPool::run (const std::vector<std::function<void ()> > &tasks)
+{
+  if (tasks.empty ())
+    return;
+  if (m_workers.empty () || tasks.size () == 1)
+    {
+      for (size_t i=0; i<tasks.size (); i++)
+	tasks[i] ();
+      return;
+    }
+
+  int remaining = static_cast<int> (tasks.size ());
+  std::unique_lock<std::mutex> lock (m_mutex);
+  for (size_t i=0; i<tasks.size (); i++)
+    {
+      Task t = { &tasks[i], &remaining };
+      m_queue.push_back (t);
+    }
+  m_taskCond.notify_all ();
+  m_doneCond.notify_all ();  /* threads waiting on their own batch can help. */
+
+  /* help with queued tasks (ours or others') until our batch is done. */
+  while (remaining > 0)
+    {
+      if (! m_queue.empty ())
+	{
+	  Task t = m_queue.front ();
+	  m_queue.pop_front ();
+	  runTask (t, lock);
+	}
+      else m_doneCond.wait (lock);
+    }
+}
+
+void ThreadPool::workerLoop ()
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+  while (true)
+    {
+      while (! m_stop && m_queue.empty ())
+	m_taskCond.wait (lock);
+      if (m_queue.empty ())  /* stopping. */
+	return;
+      Task t = m_queue.front ();
+      m_queue.pop_front ();
+      runTask (t, lock);
+    }
+}
+
+void ThreadPool::runTask (const Task &t, std::unique_lock<std::mutex> &lock)
+{
+  lock.unlock ();
+  (*t.m_fct) ();
+  lock.lock ();
+  if (--(*t.m_remaining) == 0)
+    m_doneCond.notify_all ();
+}
+
+} /* end of namespace */
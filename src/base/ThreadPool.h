@@ -0,0 +1,94 @@
+/**
+ * Copyright 2014 Emmanuel Benazera beniz@droidnik.fr
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * \brief a minimal pool of worker threads for running batches of
+ *        independent tasks (tree operations).
+ *
+ * \author E. Benazera
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace hmdp_base
+{
+
+/**
+ * \class ThreadPool
+ * \brief pool of worker threads executing batches of tasks.
+ *        The thread that submits a batch helps executing tasks until
+ *        its batch is complete, so tasks can themselves submit batches
+ *        to the same pool without deadlocking it.
+ */
+class ThreadPool
+{
+ public:
+  /**
+   * \brief constructor.
+   * @param nthreads total number of threads running tasks, including
+   *        the calling thread (nthreads-1 workers are spawned).
+   */
+  ThreadPool (const int &nthreads);
+
+  ~ThreadPool ();
+
+  /**
+   * \brief runs a batch of tasks and returns when all of them are done.
+   * @param tasks tasks to be run, in any order and concurrently.
+   */
+  void run (const std::vector<std::function<void ()> > &tasks);
+
+  /**
+   * \brief total number of threads running tasks.
+   */
+  int getNThreads () const { return static_cast<int> (m_workers.size ()) + 1; }
+
+ private:
+  ThreadPool (const ThreadPool &);
+  ThreadPool& operator= (const ThreadPool &);
+
+  struct Task
+  {
+    const std::function<void ()> *m_fct;
+    int *m_remaining;  /**< remaining tasks in the batch, guarded by m_mutex. */
+  };
+
+  void workerLoop ();
+
+  /**
+   * \brief runs a task that was just popped from the queue, with m_mutex held
+   *        by lock. The lock is released while running the task.
+   */
+  void runTask (const Task &t, std::unique_lock<std::mutex> &lock);
+
+  std::vector<std::thread> m_workers;
+  std::deque<Task> m_queue;
+  std::mutex m_mutex;
+  std::condition_variable m_taskCond;  /**< signals new tasks or pool shutdown. */
+  std::condition_variable m_doneCond;  /**< signals task completions. */
+  bool m_stop;
+};
+
+} /* end of namespace */
+#endif
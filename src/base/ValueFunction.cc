@@ -18,6 +18,8 @@
 #include "ContinuousOutcome.h"
 #include "ContinuousReward.h"
 #include "ContinuousStateDistribution.h"
+#include "FrozenValueFunction.h"
+#include "Metrics.h"
 #include <algorithm> /* max */
 #include <assert.h>
 
@@ -41,7 +43,7 @@ ValueFunction::ValueFunction (const ValueFunction &vf)
     m_achievedGoals (0), m_csd (vf.getCSDFlag ())
 {
   m_bspType = ValueFunctionT;
-  m_maxValue = vf.getSubTreeMaxValue ();
+  copySubTreeBounds (vf);
   
   /* copy alpha vectors */
   if (vf.getAlphaVectors ())
@@ -98,10 +100,10 @@ void ValueFunction::transferData (const BspTree &bt)
 	{
 	  m_alphaVectors = new std::vector<AlphaVector*> ();
 	  m_alphaVectors->push_back (new AlphaVector (co.getProbability ()));
+	  setSubTreeBounds (co.getProbability (), co.getProbability ());
 	}
-
-      /* set max value. */
-      m_maxValue = co.getProbability ();
+      else setSubTreeBounds (-std::numeric_limits<double>::max (),
+			     -std::numeric_limits<double>::max ());
     }
   else if (bt.getType () == PiecewiseConstantRewardT
 	   || bt.getType () == PiecewiseLinearRewardT)
@@ -124,8 +126,8 @@ void ValueFunction::transferData (const BspTree &bt)
 	    m_alphaVectors->push_back (new AlphaVector (*cr.getAlphaVectorNth (i)));
 	}
 
-       /* copy max value. */
-      m_maxValue = cr.getSubTreeMaxValue ();
+       /* copy value bounds. */
+      copySubTreeBounds (cr);
     }
   else if (bt.getType () == ContinuousStateDistributionT)
     {
@@ -136,8 +138,8 @@ void ValueFunction::transferData (const BspTree &bt)
 	  m_alphaVectors = new std::vector<AlphaVector*> ();
 	  m_alphaVectors->push_back (new AlphaVector (csd.getProbability ()));
 
-	  /* set max value. */
-	  m_maxValue = csd.getProbability ();
+	  /* set value bounds. */
+	  setSubTreeBounds (csd.getProbability (), csd.getProbability ());
 	}
     }
   else
@@ -161,8 +163,8 @@ void ValueFunction::transferData (const BspTree &bt)
 	    m_alphaVectors->push_back (new AlphaVector (*vf.getAlphaVectorNth (i)));
 	}
 
-      /* copy max value. */
-      m_maxValue = vf.getSubTreeMaxValue ();
+      /* copy value bounds. */
+      copySubTreeBounds (vf);
     }
 }
 
@@ -243,17 +245,26 @@ void ValueFunction::mergeTreeLeaves (double *low, double *high)
       vfge->mergeTreeLeaves (low, high);
       low[getDimension ()] = b;
       
+      /* update subtree value bounds, that hold for the merged leaf as well. */
+      updateNodeBounds ();
+
       /* find two contiguous rectangular cells */
       if (vflt->isLeaf () && vfge->isLeaf ())
-	mergeContiguousLeaves (this, vflt, vfge, low, high); /* virtual call */
-
-      /* update subtree max value. */
-       if (BspTreeOperations::m_asymetricOperators)
-	 m_maxValue = updateSubTreeMaxValue (vflt, vfge);
+	{
+	  double minv = getSubTreeMinValue (), maxv = getSubTreeMaxValue ();
+	  mergeContiguousLeaves (this, vflt, vfge, low, high); /* virtual call */
+	  setSubTreeBounds (minv, maxv);
+	}
     }
   else return;
 }
 
+void ValueFunction::mergeTreeLeaves (const BspOpContext &ctx, double *low, double *high)
+{
+  BspOpContextScope scope (ctx);
+  mergeTreeLeaves (low, high);
+}
+
 void ValueFunction::addGoals (const ValueFunction &vf)
 {
   if (! m_achievedGoals)
@@ -264,6 +275,19 @@ void ValueFunction::addGoals (const ValueFunction &vf)
       m_achievedGoals->push_back ((*ag)[i]);
 }
 
+void ValueFunction::addGoalsToLeaves (const ValueFunction &vf)
+{
+  if (! vf.getAchievedGoals ())
+    return;
+  if (isLeaf ())
+    addGoals (vf);
+  else
+    {
+      static_cast<ValueFunction*> (getLowerTree ())->addGoalsToLeaves (vf);
+      static_cast<ValueFunction*> (getGreaterTree ())->addGoalsToLeaves (vf);
+    }
+}
+
 void ValueFunction::unionGoalSets (const ValueFunction &vf1, const ValueFunction &vf2)
 {
   /* delete current alpha vectors if any */
@@ -354,6 +378,27 @@ void ValueFunction::tagWithGoal (const int &goalid)
     }
 }
 
+size_t ValueFunction::hashNodeData (const double &epsilon) const
+{
+  size_t h = BspTreeAlpha::hashNodeData (epsilon);
+  if (m_achievedGoals)
+    for (size_t i=0; i<m_achievedGoals->size (); i++)
+      Alg::hashCombine (h, static_cast<size_t> ((*m_achievedGoals)[i]));
+  return h;
+}
+
+bool ValueFunction::isEqualNodeData (const BspTree &bt, const double &epsilon) const
+{
+  const ValueFunction &vf = static_cast<const ValueFunction&> (bt);
+  if (m_csd != vf.getCSDFlag ()
+      || ! BspTreeAlpha::isEqualNodeData (bt, epsilon))
+    return false;
+  const std::vector<int> *g = vf.getAchievedGoals ();
+  if (! m_achievedGoals || ! g)
+    return (! m_achievedGoals || m_achievedGoals->empty ()) && (! g || g->empty ());
+  return *m_achievedGoals == *g;
+}
+
 void ValueFunction::addAction (const int &action)
 {
   if (! m_alphaVectors)
@@ -381,17 +426,96 @@ double ValueFunction::computeExpectation (const MDDiscreteDistribution &mdd,
 double ValueFunction::computeExpectation (ContinuousStateDistribution *csd, 
 					  double *low, double *high)
 {
-  /* proceed with intersection */
-  BspTreeOperations::setIntersectionType (BTI_MULT);
-  ValueFunction* vf 
-    = static_cast<ValueFunction*> (BspTreeOperations::intersectTrees (this, csd, low, high));
-  /* sum leaves values (virtual call) */
+  return computeExpectation (BspOpContext (), csd, low, high);
+}
+
+double ValueFunction::computeExpectation (const BspOpContext &ctx, ContinuousStateDistribution *csd,
+					  double *low, double *high)
+{
+  MetricsTimer timer (METRICS_EXPECTATION);
+  
+  /* walk both trees together, over the tiles of their intersection (BTI_MULT),
+     and sum the leaves values, without building the intersection. */
   double expect = 0.0;
-  vf->expectedValueFromLeaves (&expect, low, high);
-  BspTree::deleteBspTree (vf);
+  expectationFromNode (ctx, *csd, low, high, &expect);
   return expect;
 }
 
+void ValueFunction::expectationFromNode (const BspOpContext &ctx, const ContinuousStateDistribution &csd,
+					 double *low, double *high, double *expect) const
+{
+  if (isLeaf ())
+    {
+      expectationInLeaf (ctx, csd, low, high, expect);
+      return;
+    }
+  
+  double b = low[getDimension ()];
+  low[getDimension ()] = getPosition ();
+  static_cast<const ValueFunction*> (getGreaterTree ())->expectationFromNode (ctx, csd, low, high, expect);
+  low[getDimension ()] = b;
+  
+  b = high[getDimension ()];
+  high[getDimension ()] = getPosition ();
+  static_cast<const ValueFunction*> (getLowerTree ())->expectationFromNode (ctx, csd, low, high, expect);
+  high[getDimension ()] = b;
+}
+
+void ValueFunction::expectationInLeaf (const BspOpContext &ctx, const ContinuousStateDistribution &csd,
+				       double *low, double *high, double *expect) const
+{
+  if (! m_alphaVectors)
+    return;
+  
+  if (! csd.isLeaf ())
+    {
+      /* only visit the distribution tiles that overlap the leaf tile. */
+      int d = csd.getDimension ();
+      double pos = csd.getPosition ();
+      if (pos < high[d])
+	{
+	  double b = low[d];
+	  if (pos > low[d])
+	    low[d] = pos;
+	  expectationInLeaf (ctx, *static_cast<ContinuousStateDistribution*> (csd.getGreaterTree ()),
+			     low, high, expect);
+	  low[d] = b;
+	}
+      if (pos > low[d])
+	{
+	  double b = high[d];
+	  if (pos < high[d])
+	    high[d] = pos;
+	  expectationInLeaf (ctx, *static_cast<ContinuousStateDistribution*> (csd.getLowerTree ()),
+			     low, high, expect);
+	  high[d] = b;
+	}
+      return;
+    }
+
+  if (csd.getProbability () <= 0.0)
+    return;
+
+  /* tiles that are too small are 'dead-ends', as in the intersection. */
+  for (int d=0; d<m_nDim; d++)
+    if (Alg::REqual (high[d], low[d], ctx.m_epsilon))
+      return;
+
+  /* probability of the tile, as in leafDataIntersectMult. */
+  double prob = 1.0;
+  for (int d=0; d<m_nDim; d++)
+    prob *= (high[d] - low[d]);
+  prob *= csd.getProbability ();
+  expectedValueInTile (prob, low, high, expect);  /* virtual call */
+}
+
+void ValueFunction::getPointValues (const double *const *pos, const size_t &npts,
+				    double *values, int *actions) const
+{
+  FrozenValueFunction fvf (*this);
+  fvf.getPointValues (pos, npts, values, actions);
+}
+
 void ValueFunction::collectActions (std::set<int> *actionSet, double *low, double *high)
 {
   if (isLeaf ())
@@ -446,7 +570,7 @@ void ValueFunction::collectActions (std::set<int> *actionSet, double *low, doubl
 	{
 	    high[getDimension ()] = getPosition ();
 	    ValueFunction *vflt = static_cast<ValueFunction*> (getLowerTree ());
-	    vflt->collectActions (actionSet, low, high);
+	    vflt->collectActions (actionSet, low, high, min, max);
 	    high[getDimension ()] = b;
 	}
 
@@ -455,7 +579,7 @@ void ValueFunction::collectActions (std::set<int> *actionSet, double *low, doubl
 	{
 	    low[getDimension()] = getPosition ();
 	    ValueFunction *vfge = static_cast<ValueFunction*> (getGreaterTree ());
-	    vfge->collectActions (actionSet, low, high);
+	    vfge->collectActions (actionSet, low, high, min, max);
 	    low[getDimension ()] = b;
 	}
     }
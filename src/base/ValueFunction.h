@@ -103,9 +103,39 @@ class ValueFunction : public BspTreeAlpha
    */
   double computeExpectation (ContinuousStateDistribution *csd, double *low, double *high);
 
+  /**
+   * \brief compute expectation value from this value function and a continuous
+   *        state distribution, within a given operation context.
+   * @param ctx operation context,
+   * @param csd multi-dimensional discrete probability distribution,
+   * @param low lower bound on the continuous space,
+   * @param high upper bound on the continuous space,
+   * @return expected value.
+   */
+  double computeExpectation (const BspOpContext &ctx, ContinuousStateDistribution *csd,
+			     double *low, double *high);
+
  protected:
   virtual void expectedValueFromLeaves (double *val, double *low, double *high) {};
 
+  /**
+   * \brief adds the expected value of this leaf over a tile, as expectedValueFromLeaves
+   *        on the leaf intersected (BTI_MULT) with a distribution leaf.
+   * @param prob tile probability, i.e. the distribution leaf probability times the tile volume,
+   * @param low tile lower bounds,
+   * @param high tile upper bounds,
+   * @param val result value.
+   */
+  virtual void expectedValueInTile (const double &prob, const double *low, const double *high,
+				    double *val) const {};
+
+ private:
+  void expectationFromNode (const BspOpContext &ctx, const ContinuousStateDistribution &csd,
+			    double *low, double *high, double *expect) const;
+
+  void expectationInLeaf (const BspOpContext &ctx, const ContinuousStateDistribution &csd,
+			  double *low, double *high, double *expect) const;
+
  public:
   /**
    * \brief navigates through this tree and merges tree leaves with similar alpha vector values.
@@ -113,12 +143,41 @@ class ValueFunction : public BspTreeAlpha
    */
   void mergeTreeLeaves (double *low, double *high);
 
+  /**
+   * \brief merges tree leaves with the merging policy of a given operation context.
+   * @param ctx operation context.
+   */
+  void mergeTreeLeaves (const BspOpContext &ctx, double *low, double *high);
+
+  /**
+   * \brief values and actions at a batch of points of the continuous space.
+   *        The tree is first copied into a FrozenValueFunction, so this pays
+   *        off on large batches only.
+   * @param pos point coordinates, by dimension: pos[d][i] is the d-th coordinate
+   *        of the i-th point,
+   * @param npts number of points,
+   * @param values array of npts values, filled in,
+   * @param actions array of npts actions, filled in if not NULL.
+   * @sa FrozenValueFunction::getPointValues
+   */
+  void getPointValues (const double *const *pos, const size_t &npts,
+		       double *values, int *actions=NULL) const;
+
   /**
    * \brief collect all different actions attached to the tree leaves.
    * @param result set (contains each action index once).
    */
   void collectActions (std::set<int> *actionSet, double *low, double *high);
 
+  /**
+   * \brief collect the actions attached to the tree leaves with a positive value
+   *        that intersect a box.
+   * @param actionSet result set (contains each action index once),
+   * @param low domain lower bounds,
+   * @param high domain upper bounds,
+   * @param min lower corner of the box,
+   * @param max upper corner of the box.
+   */
   void collectActions (std::set<int> *actionSet, double *low, double *high,
 		       double *min, double *max);
 
@@ -159,6 +218,12 @@ class ValueFunction : public BspTreeAlpha
    * @param vf value function whose goals are to be added.
    */
   void addGoals (const ValueFunction &vf);
+
+  /**
+   * \brief add a value function's achieved goals to all the leaves of this function.
+   * @param vf value function whose goals are to be added.
+   */
+  void addGoalsToLeaves (const ValueFunction &vf);
   
   /**
    * \brief sets this function's goal sets to the union of two function' goal sets.
@@ -185,11 +250,17 @@ class ValueFunction : public BspTreeAlpha
 
   void tagWithGoal (const int &goalid);
 
-  /* stuff for asymetric operators */
-  double updateSubTreeMaxValue () { return 0.0; };
+  /**
+   * \brief hash of the node data, achieved goals included.
+   * @sa BspTreeStore
+   */
+  size_t hashNodeData (const double &epsilon) const;
 
-  virtual double updateSubTreeMaxValue (ValueFunction *vflt, ValueFunction *vfge) 
-  { return 0.0; }
+  /**
+   * \brief node data equality, achieved goals (in the same order) and csd flag included.
+   * @sa BspTreeStore
+   */
+  bool isEqualNodeData (const BspTree &bt, const double &epsilon) const;
 
   /* stats */
   void maxNumberOfAchievedGoals (unsigned int &mnag);
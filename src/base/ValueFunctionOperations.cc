@@ -24,11 +24,20 @@ ValueFunction* ValueFunctionOperations::sumValueFunctions (ValueFunction *vf1,
 							   ValueFunction *vf2,
 							   double *low, double *high)
 {
-  BspTreeOperations::m_currentIntersectionType = BTI_PLUS;  /* leaf intersection type */
-  BspTree *bt = BspTreeOperations::intersectTrees (vf1, vf2, low, high);
+  return ValueFunctionOperations::sumValueFunctions (BspOpContext (), vf1, vf2, low, high);
+}
+
+ValueFunction* ValueFunctionOperations::sumValueFunctions (const BspOpContext &ctx,
+							   ValueFunction *vf1,
+							   ValueFunction *vf2,
+							   double *low, double *high)
+{
+  BspOpContext sctx (ctx);
+  sctx.m_intersectionType = BTI_PLUS;  /* leaf intersection type */
+  BspTree *bt = BspTreeOperations::intersectTrees (sctx, vf1, vf2, low, high);
   ValueFunction *vf = static_cast<ValueFunction*> (bt);
-  if (BspTreeOperations::m_piecesMerging)
-    vf->mergeTreeLeaves (low, high);
+  if (sctx.m_piecesMerging)
+    vf->mergeTreeLeaves (sctx, low, high);
   return vf;
 }
 
@@ -36,20 +45,21 @@ ValueFunction* ValueFunctionOperations::subtractValueFunctions (ValueFunction *v
 								ValueFunction *vf2,
 								double *low, double *high)
 {
-  /* can't use the bsp balance. */
-  bool isBalance = false;
-  if (BspTreeOperations::m_bspBalance)
-    {
-      BspTreeOperations::m_bspBalance = false;
-      isBalance = true;
-    }
-  BspTreeOperations::m_currentIntersectionType = BTI_MINUS;
-  BspTree *bt = BspTreeOperations::intersectTrees (vf1, vf2, low, high);
-  if (isBalance)
-    BspTreeOperations::m_bspBalance = true;
+  return ValueFunctionOperations::subtractValueFunctions (BspOpContext (), vf1, vf2, low, high);
+}
+
+ValueFunction* ValueFunctionOperations::subtractValueFunctions (const BspOpContext &ctx,
+								ValueFunction *vf1,
+								ValueFunction *vf2,
+								double *low, double *high)
+{
+  BspOpContext sctx (ctx);
+  sctx.m_intersectionType = BTI_MINUS;
+  sctx.m_bspBalance = false;  /* can't use the bsp balance. */
+  BspTree *bt = BspTreeOperations::intersectTrees (sctx, vf1, vf2, low, high);
   ValueFunction *vf = static_cast<ValueFunction*> (bt);
-  if (BspTreeOperations::m_piecesMerging)
-    vf->mergeTreeLeaves (low, high);
+  if (sctx.m_piecesMerging)
+    vf->mergeTreeLeaves (sctx, low, high);
   return vf;
 }
 
@@ -57,11 +67,20 @@ ValueFunction* ValueFunctionOperations::maxValueFunction (ValueFunction *vf1,
 							  ValueFunction *vf2, 
 							  double *low, double *high)
 {
-  BspTreeOperations::m_currentIntersectionType = BTI_MAX;
-  BspTree *bt = BspTreeOperations::intersectTrees (vf1, vf2, low, high);
+  return ValueFunctionOperations::maxValueFunction (BspOpContext (), vf1, vf2, low, high);
+}
+
+ValueFunction* ValueFunctionOperations::maxValueFunction (const BspOpContext &ctx,
+							  ValueFunction *vf1,
+							  ValueFunction *vf2, 
+							  double *low, double *high)
+{
+  BspOpContext mctx (ctx);
+  mctx.m_intersectionType = BTI_MAX;
+  BspTree *bt = BspTreeOperations::intersectTrees (mctx, vf1, vf2, low, high);
   ValueFunction *vf = static_cast<ValueFunction*> (bt);
-  if (BspTreeOperations::m_piecesMerging)
-    vf->mergeTreeLeaves (low, high);
+  if (mctx.m_piecesMerging)
+    vf->mergeTreeLeaves (mctx, low, high);
   return vf;
 }
 
@@ -69,18 +88,85 @@ ValueFunction* ValueFunctionOperations::minValueFunction (ValueFunction *vf1,
                                                           ValueFunction *vf2,
                                                           double *low, double *high)
 {
-  BspTreeOperations::m_currentIntersectionType = BTI_MIN;
-  BspTree *bt = BspTreeOperations::intersectTrees (vf1, vf2, low, high);
+  return ValueFunctionOperations::minValueFunction (BspOpContext (), vf1, vf2, low, high);
+}
+
+ValueFunction* ValueFunctionOperations::minValueFunction (const BspOpContext &ctx,
+							  ValueFunction *vf1,
+                                                          ValueFunction *vf2,
+                                                          double *low, double *high)
+{
+  BspOpContext mctx (ctx);
+  mctx.m_intersectionType = BTI_MIN;
+  BspTree *bt = BspTreeOperations::intersectTrees (mctx, vf1, vf2, low, high);
   ValueFunction *vf = static_cast<ValueFunction*> (bt);
-  if (BspTreeOperations::m_piecesMerging)
-    vf->mergeTreeLeaves (low, high);
+  if (mctx.m_piecesMerging)
+    vf->mergeTreeLeaves (mctx, low, high);
   return vf;
 }
 
+ValueFunction* ValueFunctionOperations::sumValueFunctions (const BspOpContext &ctx,
+							   std::vector<ValueFunction*> &vfs,
+							   double *low, double *high)
+{
+  return ValueFunctionOperations::reduceValueFunctions (ctx, vfs, BTI_PLUS, low, high);
+}
+
+ValueFunction* ValueFunctionOperations::maxValueFunctions (const BspOpContext &ctx,
+							   std::vector<ValueFunction*> &vfs,
+							   double *low, double *high)
+{
+  return ValueFunctionOperations::reduceValueFunctions (ctx, vfs, BTI_MAX, low, high);
+}
+
+ValueFunction* ValueFunctionOperations::reduceValueFunctions (const BspOpContext &ctx,
+							      std::vector<ValueFunction*> &vfs,
+							      const BspTreeIntersectionType &btit,
+							      double *low, double *high)
+{
+  if (vfs.empty ())
+    return NULL;
+  
+  std::vector<ValueFunction*> level (vfs);
+  vfs.clear ();
+  while (level.size () > 1)
+    {
+      size_t npairs = level.size () / 2;
+      std::vector<ValueFunction*> next (npairs + level.size () % 2, NULL);
+      std::vector<std::function<void ()> > tasks;
+      for (size_t p=0; p<npairs; p++)
+	{
+	  ValueFunction *vf1 = level[2*p], *vf2 = level[2*p+1];
+	  ValueFunction **res = &next[p];
+	  tasks.push_back ([&ctx, vf1, vf2, res, btit, low, high] ()
+	    {
+	      /* intersections write into the bounds: each task has its own. */
+	      int dim = vf1->getSpaceDimension ();
+	      std::vector<double> lo (low, low+dim), hi (high, high+dim);
+	      if (btit == BTI_MAX)
+		*res = ValueFunctionOperations::maxValueFunction (ctx, vf1, vf2, &lo[0], &hi[0]);
+	      else *res = ValueFunctionOperations::sumValueFunctions (ctx, vf1, vf2, &lo[0], &hi[0]);
+	      BspTree::deleteBspTree (vf1); BspTree::deleteBspTree (vf2);
+	    });
+	}
+      if (ctx.m_pool)
+	ctx.m_pool->run (tasks);
+      else
+	for (size_t t=0; t<tasks.size (); t++)
+	  tasks[t] ();
+      if (level.size () % 2)
+	next[npairs] = level.back ();
+      level.swap (next);
+    }
+  return level[0];
+}
+
 bool ValueFunctionOperations::compareValueFunctions (ValueFunction *vf1,
 						     ValueFunction *vf2,
 						     double *low, double *high)
 {
+  if (vf1 == vf2)  /* shared (hash-consed) subtrees. */
+    return true;
   if ((vf1->isLeaf () && ! vf2->isLeaf ())
       || (! vf1->isLeaf () && vf2->isLeaf ()))
     return false;
@@ -112,23 +198,286 @@ bool ValueFunctionOperations::compareValueFunctions (ValueFunction *vf1,
   return true;
 }
 
+bool ValueFunctionOperations::identicalValueFunctions (const ValueFunction *vf1,
+						       const ValueFunction *vf2)
+{
+  if (vf1 == vf2)  /* shared (hash-consed) subtrees. */
+    return true;
+  if (vf1->isLeaf () != vf2->isLeaf ())
+    return false;
+  if (! vf1->isLeaf ())
+    return vf1->getDimension () == vf2->getDimension ()
+      && vf1->getPosition () == vf2->getPosition ()
+      && ValueFunctionOperations::identicalValueFunctions (static_cast<const ValueFunction*> (vf1->getLowerTree ()),
+							   static_cast<const ValueFunction*> (vf2->getLowerTree ()))
+      && ValueFunctionOperations::identicalValueFunctions (static_cast<const ValueFunction*> (vf1->getGreaterTree ()),
+							   static_cast<const ValueFunction*> (vf2->getGreaterTree ()));
+
+  /* leaves: alpha vectors in the same order, with their actions, and goals. */
+  const std::vector<AlphaVector*> *avs1 = vf1->getAlphaVectors ();
+  const std::vector<AlphaVector*> *avs2 = vf2->getAlphaVectors ();
+  if (! avs1 || ! avs2)
+    return avs1 == avs2;
+  if (avs1->size () != avs2->size ())
+    return false;
+  for (size_t i=0; i<avs1->size (); i++)
+    if (! (*avs1)[i]->isEqual (*(*avs2)[i])
+	|| (*avs1)[i]->m_actions != (*avs2)[i]->m_actions)
+      return false;
+  const std::vector<int> *g1 = vf1->getAchievedGoals ();
+  const std::vector<int> *g2 = vf2->getAchievedGoals ();
+  if (! g1 || ! g2)
+    return (! g1 || g1->empty ()) && (! g2 || g2->empty ());
+  return *g1 == *g2;
+}
+
+double ValueFunctionOperations::supNormDifference (const BspOpContext &ctx,
+						   const ValueFunction *vf1, const ValueFunction *vf2,
+						   double *low, double *high, const double &bound)
+{
+  double snorm = 0.0;
+  ValueFunctionOperations::supNormFromNode (ctx, vf1, vf2, low, high, bound, &snorm);
+  return snorm;
+}
+
+bool ValueFunctionOperations::supNormFromNode (const BspOpContext &ctx,
+					       const ValueFunction *vf1, const ValueFunction *vf2,
+					       double *low, double *high, const double &bound,
+					       double *snorm)
+{
+  if (vf1->isLeaf ())
+    return ValueFunctionOperations::supNormInLeaf (ctx, vf1, vf2, low, high, bound, snorm);
+
+  /* the bounds may be a part of the domain only. */
+  int d = vf1->getDimension ();
+  double pos = vf1->getPosition ();
+  bool cont = true;
+  if (pos > low[d])
+    {
+      double b = high[d];
+      if (pos < high[d])
+	high[d] = pos;
+      cont = ValueFunctionOperations::supNormFromNode (ctx, static_cast<const ValueFunction*> (vf1->getLowerTree ()),
+						       vf2, low, high, bound, snorm);
+      high[d] = b;
+    }
+  if (cont && pos < high[d])
+    {
+      double b = low[d];
+      if (pos > low[d])
+	low[d] = pos;
+      cont = ValueFunctionOperations::supNormFromNode (ctx, static_cast<const ValueFunction*> (vf1->getGreaterTree ()),
+						       vf2, low, high, bound, snorm);
+      low[d] = b;
+    }
+  return cont;
+}
+
+bool ValueFunctionOperations::supNormInLeaf (const BspOpContext &ctx,
+					     const ValueFunction *vf1, const ValueFunction *vf2,
+					     double *low, double *high, const double &bound,
+					     double *snorm)
+{
+  if (! vf2->isLeaf ())
+    {
+      /* only visit the vf2 tiles that overlap the vf1 leaf tile. */
+      int d = vf2->getDimension ();
+      double pos = vf2->getPosition ();
+      bool cont = true;
+      if (pos > low[d])
+	{
+	  double b = high[d];
+	  if (pos < high[d])
+	    high[d] = pos;
+	  cont = ValueFunctionOperations::supNormInLeaf (ctx, vf1, static_cast<const ValueFunction*> (vf2->getLowerTree ()),
+							 low, high, bound, snorm);
+	  high[d] = b;
+	}
+      if (cont && pos < high[d])
+	{
+	  double b = low[d];
+	  if (pos > low[d])
+	    low[d] = pos;
+	  cont = ValueFunctionOperations::supNormInLeaf (ctx, vf1, static_cast<const ValueFunction*> (vf2->getGreaterTree ()),
+							 low, high, bound, snorm);
+	  low[d] = b;
+	}
+      return cont;
+    }
+
+  if (! vf1->getAlphaVectors () && ! vf2->getAlphaVectors ())
+    return true;
+
+  /* tiles that are too small are 'dead-ends', as in the intersection. */
+  int nDim = vf1->getSpaceDimension ();
+  for (int d=0; d<nDim; d++)
+    if (Alg::REqual (high[d], low[d], ctx.m_epsilon))
+      return true;
+
+  /* sup of |vf1 - vf2| over the tile, from both sides. */
+  double tnorm = std::max (ValueFunctionOperations::maxDifferenceInTile (vf1->getAlphaVectors (), vf2->getAlphaVectors (),
+									 low, high, nDim),
+			   ValueFunctionOperations::maxDifferenceInTile (vf2->getAlphaVectors (), vf1->getAlphaVectors (),
+									 low, high, nDim));
+  if (tnorm > *snorm)
+    *snorm = tnorm;
+  return *snorm <= bound;
+}
+
+double ValueFunctionOperations::maxDifferenceInTile (const std::vector<AlphaVector*> *avs1,
+						     const std::vector<AlphaVector*> *avs2,
+						     const double *low, const double *high,
+						     const int &nDim)
+{
+  /* max_x (max_i a_i(x) - max_j b_j(x)) = max_x max_i min_j (a_i - b_j)(x)
+     <= max_i min_j max_x (a_i - b_j)(x), with equality when avs2 is a single vector.
+     Missing vectors are a zero vector. */
+  size_t n1 = avs1 ? avs1->size () : 1;
+  size_t n2 = avs2 ? avs2->size () : 1;
+  double mdiff = -std::numeric_limits<double>::max ();
+  for (size_t i=0; i<n1; i++)
+    {
+      const AlphaVector *av1 = avs1 ? (*avs1)[i] : 0;
+      double idiff = std::numeric_limits<double>::max ();
+      for (size_t j=0; j<n2; j++)
+	idiff = std::min (idiff, ValueFunctionOperations::maxDifferenceInTile (av1, avs2 ? (*avs2)[j] : 0,
+									       low, high, nDim));
+      mdiff = std::max (mdiff, idiff);
+    }
+  return mdiff;
+}
+
+double ValueFunctionOperations::maxDifferenceInTile (const AlphaVector *av1, const AlphaVector *av2,
+						     const double *low, const double *high,
+						     const int &nDim)
+{
+  /* the max of a linear function over a box is reached at a corner, independently
+     in each dimension. Constant vectors have their single coefficient last. */
+  int last1 = av1 ? av1->getSize () - 1 : -1;
+  int last2 = av2 ? av2->getSize () - 1 : -1;
+  double mdiff = (av1 ? av1->getAlphaNth (last1) : 0.0) - (av2 ? av2->getAlphaNth (last2) : 0.0);
+  for (int d=0; d<nDim; d++)
+    {
+      double c = (d < last1 ? av1->getAlphaNth (d) : 0.0) - (d < last2 ? av2->getAlphaNth (d) : 0.0);
+      mdiff += (c > 0.0) ? c * high[d] : c * low[d];
+    }
+  return mdiff;
+}
+
+ValueFunction* ValueFunctionOperations::maskValueFunction (const BspOpContext &ctx, ValueFunction *vf,
+							  const ContinuousStateDistribution *csd,
+							  double *low, double *high)
+{
+  BspOpContext lctx (ctx);
+  lctx.m_outputType = vf->getType ();
+  BspTree *bt = ValueFunctionOperations::mask (lctx, vf, csd, low, high);
+  if (! bt)
+    bt = BspTreeOperations::createTree (lctx, vf->getSpaceDimension ());  /* no mass at all. */
+  return static_cast<ValueFunction*> (bt);
+}
+
+BspTree* ValueFunctionOperations::mask (const BspOpContext &ctx, BspTree *bt,
+					const ContinuousStateDistribution *csd,
+					double *low, double *high)
+{
+  /* skip the distribution cuts that do not split the tile. */
+  while (! csd->isLeaf ())
+    {
+      int d = csd->getDimension ();
+      if (csd->getPosition () <= low[d])
+	csd = static_cast<const ContinuousStateDistribution*> (csd->getGreaterTree ());
+      else if (csd->getPosition () >= high[d])
+	csd = static_cast<const ContinuousStateDistribution*> (csd->getLowerTree ());
+      else break;
+    }
+  
+  if (! ValueFunctionOperations::hasMass (ctx, csd, low, high))
+    return 0;  /* 'don't care'. */
+  if (bt->isLeaf () || csd->isLeaf ())
+    return BspTreeOperations::shareTree (bt);  /* mass everywhere, or a leaf. */
+
+  int d = bt->getDimension ();
+  double b = high[d];
+  high[d] = bt->getPosition ();
+  BspTree *lt = ValueFunctionOperations::mask (ctx, bt->getLowerTree (), csd, low, high);
+  high[d] = b;
+  b = low[d];
+  low[d] = bt->getPosition ();
+  BspTree *ge = ValueFunctionOperations::mask (ctx, bt->getGreaterTree (), csd, low, high);
+  low[d] = b;
+
+  /* a 'don't care' subtree takes the values of its sibling, whose tile is extended. */
+  if (! lt)
+    return ge;
+  if (! ge)
+    return lt;
+  BspTree *bsp_n = BspTreeOperations::createTree (ctx, bt->getSpaceDimension (), d,
+						  bt->getPosition ());
+  bsp_n->setLowerTree (lt);
+  bsp_n->setGreaterTree (ge);
+  BspTreeOperations::setSubTreeBounds (ctx, bsp_n, *bt);
+  return bsp_n;
+}
+
+bool ValueFunctionOperations::hasMass (const BspOpContext &ctx, const ContinuousStateDistribution *csd,
+				       double *low, double *high)
+{
+  if (! csd->isLeaf ())
+    {
+      /* only visit the tiles that overlap the box. */
+      int d = csd->getDimension ();
+      double pos = csd->getPosition ();
+      bool mass = false;
+      if (pos > low[d])
+	{
+	  double b = high[d];
+	  if (pos < high[d])
+	    high[d] = pos;
+	  mass = ValueFunctionOperations::hasMass (ctx, static_cast<const ContinuousStateDistribution*> (csd->getLowerTree ()),
+						   low, high);
+	  high[d] = b;
+	}
+      if (! mass && pos < high[d])
+	{
+	  double b = low[d];
+	  if (pos > low[d])
+	    low[d] = pos;
+	  mass = ValueFunctionOperations::hasMass (ctx, static_cast<const ContinuousStateDistribution*> (csd->getGreaterTree ()),
+						   low, high);
+	  low[d] = b;
+	}
+      return mass;
+    }
+
+  if (csd->getProbability () <= 0.0)
+    return false;
+  
+  /* tiles that are too small are 'dead-ends', as in the intersection. */
+  for (int d=0; d<csd->getSpaceDimension (); d++)
+    if (Alg::REqual (high[d], low[d], ctx.m_epsilon))
+      return false;
+  return true;
+}
+
 PiecewiseLinearValueFunction* ValueFunctionOperations::mergeVFByActions (ValueFunction *vf,
 									 double *low, double *high)
+{
+  return ValueFunctionOperations::mergeVFByActions (BspOpContext (), vf, low, high);
+}
+
+PiecewiseLinearValueFunction* ValueFunctionOperations::mergeVFByActions (const BspOpContext &ctx,
+									 ValueFunction *vf,
+									 double *low, double *high)
 {
   /* convert to a pwl with action sets in place of pwl coeffs. */
   PiecewiseLinearValueFunction *pwlactions = new PiecewiseLinearValueFunction (*vf, true);
   
   /* do the merging. */
-  bool pm = BspTreeOperations::m_piecesMerging;
-  bool pmv = BspTreeOperations::m_piecesMergingByValue;
-  
-  BspTreeOperations::m_piecesMerging = true;
-  BspTreeOperations::m_piecesMergingByValue = false;
-  BspTreeOperations::m_piecesMergingByAction = true;
-  pwlactions->mergeTreeLeaves (low, high);  /* merging. */
-  if (! pmv) BspTreeOperations::m_piecesMergingByValue = false;
-  if (! pm) BspTreeOperations::m_piecesMerging = false;
-  BspTreeOperations::m_piecesMergingByAction = false;
+  BspOpContext mctx (ctx);
+  mctx.m_piecesMerging = true;
+  mctx.m_piecesMergingByValue = false;
+  mctx.m_piecesMergingByAction = true;
+  pwlactions->mergeTreeLeaves (mctx, low, high);  /* merging. */
 
   return pwlactions;
 }
@@ -144,6 +493,12 @@ void ValueFunctionOperations::breakTiesOnActionsWithMaxConsumption (ValueFunctio
 }
 
 void ValueFunctionOperations::breakTiesOnActionsWithCoverage (ValueFunction *vf, double *low, double *high)
+{
+  ValueFunctionOperations::breakTiesOnActionsWithCoverage (BspOpContext (), vf, low, high);
+}
+
+void ValueFunctionOperations::breakTiesOnActionsWithCoverage (const BspOpContext &ctx,
+							      ValueFunction *vf, double *low, double *high)
 {
   std::set<int> actions; std::set<int>::const_iterator actit;
   vf->collectActions (&actions, low, high);
@@ -165,11 +520,19 @@ void ValueFunctionOperations::breakTiesOnActionsWithCoverage (ValueFunction *vf,
 
   /* break ties on actions. */
   vf->breakTiesOnActions (&coverage);
-  if (BspTreeOperations::m_piecesMerging)
-      vf->mergeTreeLeaves (low, high);
+  if (ctx.m_piecesMerging)
+      vf->mergeTreeLeaves (ctx, low, high);
 }
 
 std::map<int, ValueFunction*> ValueFunctionOperations::breakVFByActions (ValueFunction *vfactions, const bool &prop, double *low, double *high)
+{
+  return ValueFunctionOperations::breakVFByActions (BspOpContext (), vfactions, prop, low, high);
+}
+
+std::map<int, ValueFunction*> ValueFunctionOperations::breakVFByActions (const BspOpContext &ctx,
+									 ValueFunction *vfactions,
+									 const bool &prop,
+									 double *low, double *high)
 {
   std::map<int, ValueFunction*> vfbyactions;
 
@@ -186,7 +549,7 @@ std::map<int, ValueFunction*> ValueFunctionOperations::breakVFByActions (ValueFu
   std::set<int>::const_iterator actit;
   for (actit = actions.begin (); actit != actions.end (); actit++)
     { 
-      ValueFunction *vfbyaction = ValueFunctionOperations::breakVFByAction (vfactions, (*actit), prop, low, high);
+      ValueFunction *vfbyaction = ValueFunctionOperations::breakVFByAction (ctx, vfactions, (*actit), prop, low, high);
       vfbyactions[(*actit)] = vfbyaction;
     }
 
@@ -198,6 +561,15 @@ ValueFunction* ValueFunctionOperations::breakVFByAction (ValueFunction *vfaction
 							 const int &action,
 							 const bool &prop,
 							 double *low, double *high)
+{
+  return ValueFunctionOperations::breakVFByAction (BspOpContext (), vfactions, action, prop, low, high);
+}
+
+ValueFunction* ValueFunctionOperations::breakVFByAction (const BspOpContext &ctx,
+							 ValueFunction *vfactions, 
+							 const int &action,
+							 const bool &prop,
+							 double *low, double *high)
 {
   ValueFunction *vfbyaction = NULL;
   
@@ -222,13 +594,10 @@ ValueFunction* ValueFunctionOperations::breakVFByAction (ValueFunction *vfaction
     }
 
   /* merge by value. */
-  bool mp = BspTreeOperations::m_piecesMerging;
-  bool mbv = BspTreeOperations::m_piecesMergingByValue;
-  BspTreeOperations::m_piecesMerging = true;
-  BspTreeOperations::m_piecesMergingByValue = true;
-  vfbyaction->mergeTreeLeaves (low, high);
-  if (! mp) BspTreeOperations::m_piecesMerging = false;
-  if (! mbv) BspTreeOperations::m_piecesMergingByValue = false;
+  BspOpContext mctx (ctx);
+  mctx.m_piecesMerging = true;
+  mctx.m_piecesMergingByValue = true;
+  vfbyaction->mergeTreeLeaves (mctx, low, high);
 
   return vfbyaction;
 }
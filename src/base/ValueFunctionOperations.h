@@ -20,6 +20,7 @@
 #include "BspTreeOperations.h"
 #include "PiecewiseConstantValueFunction.h"
 #include "PiecewiseLinearValueFunction.h"
+#include <limits>
 
 namespace hmdp_base
 {
@@ -38,10 +39,16 @@ class ValueFunctionOperations : public BspTreeOperations
    * @param low lower domain bound,
    * @param upper domain bound,
    * @returns a new value function as the result of the sum of vf1 and vf2.
+   * @note the variants that take an operation context leave the global
+   *       options untouched and are safe to call concurrently.
    */
   static ValueFunction* sumValueFunctions (ValueFunction *vf1, ValueFunction *vf2,
 					   double *low, double *high);
 
+  static ValueFunction* sumValueFunctions (const BspOpContext &ctx,
+					   ValueFunction *vf1, ValueFunction *vf2,
+					   double *low, double *high);
+
   /**
    * \brief subtract two value functions.
    * @param vf1 value function,
@@ -54,6 +61,11 @@ class ValueFunctionOperations : public BspTreeOperations
 						ValueFunction *vf2,
 						double *low, double *high);
 
+  static ValueFunction* subtractValueFunctions (const BspOpContext &ctx,
+						ValueFunction *vf1,
+						ValueFunction *vf2,
+						double *low, double *high);
+
   /**
    * \brief build the max of two value functions.
    * @param vf1 value function,
@@ -65,6 +77,10 @@ class ValueFunctionOperations : public BspTreeOperations
   static ValueFunction* maxValueFunction (ValueFunction *vf1, ValueFunction *vf2,
 					  double *low, double *high);
 
+  static ValueFunction* maxValueFunction (const BspOpContext &ctx,
+					  ValueFunction *vf1, ValueFunction *vf2,
+					  double *low, double *high);
+
   /**
    * \brief build the min of two value functions.
    * @param vf1 value function,
@@ -72,10 +88,47 @@ class ValueFunctionOperations : public BspTreeOperations
    * @param low lower domain bound,
    * @param upper domain bound,
    * @returns a new value function that is the min of vf1 and vf2.
+   * @warning not supported: there is no min leaf operation, since the min of alpha
+   *          vectors is not a max of alpha vectors. Leaves are not processed.
    */
   static ValueFunction* minValueFunction (ValueFunction *vf1, ValueFunction *vf2,
 					  double *low, double *high);
+
+  static ValueFunction* minValueFunction (const BspOpContext &ctx,
+					  ValueFunction *vf1, ValueFunction *vf2,
+					  double *low, double *high);
   
+  /**
+   * \brief sum of a set of value functions, reduced pairwise as a balanced tree.
+   *        Pairs of a same level are intersected concurrently when the context
+   *        holds a thread pool.
+   * @param ctx operation context,
+   * @param vfs value functions to be summed,
+   * @param low lower domain bound,
+   * @param upper domain bound,
+   * @return a new value function as the sum of vfs, NULL if vfs is empty.
+   * @warning value functions in vfs are consumed (deleted or returned).
+   */
+  static ValueFunction* sumValueFunctions (const BspOpContext &ctx,
+					   std::vector<ValueFunction*> &vfs,
+					   double *low, double *high);
+
+  /**
+   * \brief max of a set of value functions, reduced pairwise as a balanced tree.
+   * @sa sumValueFunctions
+   * @warning value functions in vfs are consumed (deleted or returned).
+   */
+  static ValueFunction* maxValueFunctions (const BspOpContext &ctx,
+					   std::vector<ValueFunction*> &vfs,
+					   double *low, double *high);
+
+ private:
+  static ValueFunction* reduceValueFunctions (const BspOpContext &ctx,
+					      std::vector<ValueFunction*> &vfs,
+					      const BspTreeIntersectionType &btit,
+					      double *low, double *high);
+
+ public:
   /**
    * \brief compare two value functions.
    * @param vf1 value function,
@@ -87,6 +140,81 @@ class ValueFunctionOperations : public BspTreeOperations
   static bool compareValueFunctions (ValueFunction *vf1, ValueFunction *vf2,
 				     double *low, double *high);
 
+  /**
+   * \brief exact identity of two value functions: same cuts, and same alpha vectors,
+   *        actions and achieved goals in the leaves.
+   * @param vf1 value function,
+   * @param vf2 value function,
+   * @returns true if vf1 and vf2 are identical, false otherwise.
+   */
+  static bool identicalValueFunctions (const ValueFunction *vf1, const ValueFunction *vf2);
+
+  /**
+   * \brief sup-norm of the difference of two value functions, i.e. max |vf1 - vf2| over
+   *        the domain, without building the difference: both trees are walked together,
+   *        over the tiles of their intersection, and linear pieces are bounded on each tile
+   *        by their min/max over the tile box. A missing value is 0, as in the subtraction.
+   *        The norm is exact for single alpha vectors in tiles, an upper bound otherwise.
+   * @param ctx operation context,
+   * @param vf1 value function,
+   * @param vf2 value function,
+   * @param low lower bound of the domain, or of a box within,
+   * @param high upper bound of the domain, or of a box within,
+   * @param bound the walk stops as soon as the norm is known to exceed bound, and
+   *        the returned value is then a lower bound of the norm greater than bound.
+   * @return the sup-norm of vf1 - vf2.
+   */
+  static double supNormDifference (const BspOpContext &ctx,
+				    const ValueFunction *vf1, const ValueFunction *vf2,
+				    double *low, double *high,
+				    const double &bound=std::numeric_limits<double>::max ());
+
+  /**
+   * \brief masks a value function with a distribution over its domain: subtrees whose tile
+   *        has no probability mass are 'don't care', and are replaced with their sibling,
+   *        whose tile is extended. A value function without mass at all is a single leaf
+   *        without alpha vectors.
+   * @param ctx operation context,
+   * @param vf value function,
+   * @param csd distribution over the domain,
+   * @param low lower domain bound,
+   * @param high upper domain bound,
+   * @return a new value function, equal to vf where csd has mass, whose subtrees may be
+   *         shared with vf if vf is shared.
+   */
+  static ValueFunction* maskValueFunction (const BspOpContext &ctx, ValueFunction *vf,
+					   const ContinuousStateDistribution *csd,
+					   double *low, double *high);
+
+  /**
+   * \brief whether a distribution has probability mass within a box, tiles that are too
+   *        small excepted.
+   * @param ctx operation context,
+   * @param csd distribution,
+   * @param low box lower bounds,
+   * @param high box upper bounds.
+   */
+  static bool hasMass (const BspOpContext &ctx, const ContinuousStateDistribution *csd,
+		       double *low, double *high);
+
+ private:
+  static BspTree* mask (const BspOpContext &ctx, BspTree *bt,
+			const ContinuousStateDistribution *csd,
+			double *low, double *high);
+  static bool supNormFromNode (const BspOpContext &ctx,
+			       const ValueFunction *vf1, const ValueFunction *vf2,
+			       double *low, double *high, const double &bound, double *snorm);
+  static bool supNormInLeaf (const BspOpContext &ctx,
+			     const ValueFunction *vf1, const ValueFunction *vf2,
+			     double *low, double *high, const double &bound, double *snorm);
+  static double maxDifferenceInTile (const std::vector<AlphaVector*> *avs1,
+				     const std::vector<AlphaVector*> *avs2,
+				     const double *low, const double *high, const int &nDim);
+  static double maxDifferenceInTile (const AlphaVector *av1, const AlphaVector *av2,
+				     const double *low, const double *high, const int &nDim);
+
+ public:
+
   /**
    * \brief merges a value function by action. Due the possibility of having 
    * several actions attached to the same resource space, a pwl value function
@@ -101,8 +229,15 @@ class ValueFunctionOperations : public BspTreeOperations
   static PiecewiseLinearValueFunction* mergeVFByActions (ValueFunction *vf,
 							 double *low, double *high);
 
+  static PiecewiseLinearValueFunction* mergeVFByActions (const BspOpContext &ctx,
+							 ValueFunction *vf,
+							 double *low, double *high);
+
   static void breakTiesOnActionsWithCoverage (ValueFunction *vf, double *low, double *high);
 
+  static void breakTiesOnActionsWithCoverage (const BspOpContext &ctx,
+					      ValueFunction *vf, double *low, double *high);
+
   static void breakTiesOnActionsWithMaxConsumption (ValueFunction *vf,
 						    std::map<int, double> &max_cons);
 
@@ -110,10 +245,20 @@ class ValueFunctionOperations : public BspTreeOperations
 							 const bool &prop,
 							 double *low, double *high);
 
+  static std::map<int, ValueFunction*> breakVFByActions (const BspOpContext &ctx,
+							 ValueFunction *vfactions,
+							 const bool &prop,
+							 double *low, double *high);
+
   static ValueFunction* breakVFByAction (ValueFunction *vfactions, 
 					 const int &action, const bool &prop,
 					 double *low, double *high);
 
+  static ValueFunction* breakVFByAction (const BspOpContext &ctx,
+					 ValueFunction *vfactions, 
+					 const int &action, const bool &prop,
+					 double *low, double *high);
+
 };
 
 } /* end of namespace */
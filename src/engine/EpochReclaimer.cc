@@ -0,0 +1,77 @@
+/**
+ * Copyright 2014 Emmanuel Benazera beniz@droidnik.fr
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "EpochReclaimer.h"
+#include <limits>
+
+namespace hmdp_engine
+{
+
+static const unsigned long s_idle = std::numeric_limits<unsigned long>::max ();
+
+/* retired vfs are collected by batches. */
+static const size_t s_collectSize = 64;
+
+EpochReclaimer::EpochReclaimer (const int &nworkers)
+  : m_globalEpoch (0), m_workerEpochs (nworkers), m_retired (nworkers)
+{
+  for (int w=0; w<nworkers; w++)
+    m_workerEpochs[w].store (s_idle);
+}
+
+EpochReclaimer::~EpochReclaimer ()
+{
+  for (size_t w=0; w<m_retired.size (); w++)
+    for (size_t i=0; i<m_retired[w].size (); i++)
+      BspTree::deleteBspTree (m_retired[w][i].second);
+}
+
+void EpochReclaimer::enter (const int &w)
+{
+  m_workerEpochs[w].store (m_globalEpoch.load ());
+}
+
+void EpochReclaimer::leave (const int &w)
+{
+  m_workerEpochs[w].store (s_idle);
+}
+
+void EpochReclaimer::retire (const int &w, ValueFunction *vf)
+{
+  /* readers that entered after this point cannot reach vf anymore. */
+  m_retired[w].push_back (std::pair<unsigned long,ValueFunction*> (m_globalEpoch.fetch_add (1), vf));
+  if (m_retired[w].size () >= s_collectSize)
+    collect (w);
+}
+
+void EpochReclaimer::collect (const int &w)
+{
+  unsigned long minEpoch = s_idle;
+  for (size_t i=0; i<m_workerEpochs.size (); i++)
+    minEpoch = std::min (minEpoch, m_workerEpochs[i].load ());
+
+  std::vector<std::pair<unsigned long,ValueFunction*> > &retired = m_retired[w];
+  size_t kept = 0;
+  for (size_t i=0; i<retired.size (); i++)
+    {
+      if (retired[i].first < minEpoch)
+	BspTree::deleteBspTree (retired[i].second);
+      else retired[kept++] = retired[i];
+    }
+  retired.resize (kept);
+}
+
+} /* end of namespace */
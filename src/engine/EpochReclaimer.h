@@ -0,0 +1,74 @@
+/**
+ * Copyright 2014 Emmanuel Benazera beniz@droidnik.fr
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * \brief deferred deletion of the value functions replaced while other
+ *        threads may still read them (epoch-based reclamation).
+ */
+
+#ifndef EPOCHRECLAIMER_H
+#define EPOCHRECLAIMER_H
+
+#include "ValueFunction.h"
+#include <vector>
+#include <atomic>
+
+using namespace hmdp_base;
+
+namespace hmdp_engine
+{
+
+/**
+ * \class EpochReclaimer
+ * \brief workers enter an epoch before reading shared value functions, and
+ *        leave it once done. A retired value function is deleted once every
+ *        worker that could have read it has left its epoch.
+ */
+class EpochReclaimer
+{
+ public:
+  /**
+   * \brief constructor.
+   * @param nworkers number of workers, indexed from 0.
+   */
+  EpochReclaimer (const int &nworkers);
+
+  /**
+   * \brief destructor. Deletes all retired value functions, workers must be done.
+   */
+  ~EpochReclaimer ();
+
+  void enter (const int &w);
+  void leave (const int &w);
+
+  /**
+   * \brief retires a value function that is not reachable anymore by new readers.
+   * @param w retiring worker,
+   * @param vf value function, deleted when safe.
+   */
+  void retire (const int &w, ValueFunction *vf);
+
+ private:
+  void collect (const int &w);
+
+  std::atomic<unsigned long> m_globalEpoch;  /**< incremented on each retirement. */
+  std::vector<std::atomic<unsigned long> > m_workerEpochs;  /**< epoch of each worker, idle if max. */
+  std::vector<std::vector<std::pair<unsigned long,ValueFunction*> > > m_retired;  /**< retired vfs per worker, with their epoch. */
+};
+
+} /* end of namespace */
+
+#endif
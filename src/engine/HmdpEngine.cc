@@ -17,159 +17,367 @@
 #include "HmdpEngine.h"
 #include "BackupOperations.h"
 #include "ValueFunctionOperations.h"
+#include "Metrics.h"
 #include <iomanip>
 #include <limits>
 #include <queue>
 #include "fiboqueue.h"
+#include "multiqueue.h"
+#include "EpochReclaimer.h"
+#include <thread>
 
 namespace hmdp_engine
 {
   
-std::unordered_map<unsigned int,std::unordered_map<int,std::vector<HmdpState*> > > HmdpEngine::m_nextStates;
-std::unordered_map<unsigned int,std::unordered_map<int,std::multimap<double,HmdpState*> > > HmdpEngine::m_parentStates;
-std::unordered_map<unsigned int,HmdpState*> HmdpEngine::m_states;
+StateGraph HmdpEngine::m_stateGraph;
+std::unordered_map<GoalRewardKey,ContinuousReward*,GoalRewardKeyHash> HmdpEngine::m_goalRewards;
+std::vector<CachedQValue> HmdpEngine::m_qValues;
 int HmdpEngine::m_nbackups = -1;
-int HmdpEngine::m_vf_nbackups = 0;
-int HmdpEngine::m_mean_backup_time = 0;
+std::atomic<int> HmdpEngine::m_vf_nbackups (0);
+double HmdpEngine::m_mean_backup_time = 0.0;
 int HmdpEngine::m_leaves = 0;
-std::chrono::time_point<std::chrono::system_clock> HmdpEngine::m_tstart = std::chrono::system_clock::now();
-std::chrono::time_point<std::chrono::system_clock> HmdpEngine::m_tend = std::chrono::system_clock::now();
+ThreadPool* HmdpEngine::m_backupPool = NULL;
+ThreadPool* HmdpEngine::m_viPool = NULL;
+bool HmdpEngine::m_maskedBackups = false;
+std::mutex HmdpEngine::m_worldMutex;
+std::chrono::time_point<std::chrono::steady_clock> HmdpEngine::m_tstart = std::chrono::steady_clock::now();
+std::chrono::time_point<std::chrono::steady_clock> HmdpEngine::m_tend = std::chrono::steady_clock::now();
   
 int owidth = 15;
   
+/**
+ * \brief state on the stack of the depth first search: its enabled actions, and the
+ *        next outcome to be visited.
+ */
+struct SearchFrame
+{
+  HmdpState *m_state;  /**< expanded state. */
+  std::vector<std::pair<size_t,HybridTransition*> > m_enabled;  /**< enabled actions. */
+  size_t m_slot;  /**< slot of the first action in the state graph. */
+  size_t m_action;  /**< next action. */
+  int m_outcome;  /**< next outcome of the action. */
+};
+
 void HmdpEngine::DepthFirstSearchBackupCSD (HmdpState *hst,
 					    const bool &backups,
 					    const bool &csd,
 					    const bool &pstates,
-					    const int &max_dfs_recur)
+					    const DiscoveryLimits &limits)
 {
-  static int s_calls = 0;
-  
+  if (backups && csd && HmdpEngine::m_maskedBackups)
+    {
+      /* masks require the complete distributions of the states, that are only known
+	 once all their predecessors are: discovery first, then masked backups. */
+      HmdpEngine::DiscoverStates (hst, limits);
+      HmdpEngine::prepareMaskedBackups (hst);
+      HmdpEngine::solveComponents (1.0, 0.0, 1, false, true);
+      HmdpEngine::clearGoalRewards ();
+      return;
+    }
+
   if (m_nbackups == -1)
     {
       std::cout << "Total time" << std::setw(owidth) << fixed << "#discs" << std::setw(owidth) << fixed << "#vf_backups"
 		<< std::setw(owidth) << fixed << "lbtime" << std::setw(owidth) << fixed << "mbtime" << std::setw(owidth) << fixed << "ntiles\n";;
       m_nbackups = 0;
     }
-  s_calls++;
-  if (max_dfs_recur != -1 && s_calls >= max_dfs_recur) // if there's an upper limit to the number of recursive call, leave.
-    return;
   
-  unsigned int hst_uint = hst->to_uint();
-  HmdpEngine::m_states.insert(std::pair<unsigned int,HmdpState*>(hst_uint,hst));
-  HmdpEngine::m_nextStates.insert(std::pair<unsigned int,std::unordered_map<int,std::vector<HmdpState*> > >(hst_uint,std::unordered_map<int,std::vector<HmdpState*> >()));
-  
-  /* iterate all actions in the world */
-  std::map<size_t, HybridTransition*>::const_iterator ai;
-  for (ai = HmdpWorld::actionsBegin (); ai != HmdpWorld::actionsEnd (); ai++)
+  StateGraph &graph = HmdpEngine::m_stateGraph;
+  if (hst->getGraphIndex () < 0)
+    graph.addState (hst);
+  size_t memory = 0;
+  for (size_t s=0; s<graph.getNStates (); s++)
+    memory += graph.getState (s)->getMemoryEstimate ();
+  const size_t edgeMemory = 2 * (sizeof (int) + sizeof (double));  /* successor and predecessor entries. */
+
+  /* states are expanded when pushed, and backed up when popped, once all their
+     successors have been visited. States at the limits are left unexpanded. */
+  std::vector<SearchFrame> stack;
+  HmdpState *pushed = hst;
+  while (pushed || ! stack.empty ())
     {
-      /* test if action is applicable to this state, check on the discrete state,
-	 and check on max resources (equivalent to not check on resources). */
-      if (HmdpWorld::isActionEnabled ((*ai).first, *hst))
+      if (pushed)
 	{
-	  
-	  /* iterate action discrete outcomes */
-	  HybridTransition *ht = (*ai).second;
-	  for (int i=0; i<ht->getNOutcomes (); i++)
+	  if ((limits.m_maxDepth >= 0 && static_cast<int> (stack.size ()) >= limits.m_maxDepth)
+	      || (limits.m_maxStates >= 0 && static_cast<long> (graph.getNStates ()) >= limits.m_maxStates)
+	      || (limits.m_maxMemory > 0 && memory >= limits.m_maxMemory))
 	    {
-	      /* apply discrete outcome effect */
-	      HmdpState *nextState = new HmdpState (*hst);
-	      HmdpWorld::applyNonResourceActionEffects ((*ai).first, nextState, i);
-
-	      /* test if state has been already visited. */
-	      HmdpState *existingState = NULL;
-	      if ((existingState = HmdpEngine::hasBeenVisited (nextState)) != NULL)
-		{
-		  HmdpEngine::addNextState (hst, ht->getActionIndex (), existingState);
-		  if (pstates)
-		    HmdpEngine::addParentState(hst,ht->getActionIndex(),ht->getOutcome(i)->getOutcomeProbability(),existingState);
-		  delete nextState;
-		  HmdpState::decrementStatesCounter ();
-
-		  if (csd)
-		    {
-		      /* 
-			 update existing state's distribution over resources:
-			 - compute the arrival state distribution,
-			 - add it to the existing state's distribution.
-		      */
-		      HybridTransitionOutcome *hto = ht->getOutcome (i);
-		      ContinuousStateDistribution *nextStateCSD
-			= ContinuousStateDistribution::frontUp (hst->getCSD (), 
-								hto->getContTransition (),
-								HmdpWorld::getRscLowBounds (),
-								HmdpWorld::getRscHighBounds (),
-								hto->getOutcomeProbability ());
-		      ContinuousStateDistribution *stateCSD
-			= ContinuousStateDistribution::addContinuousStateDistributions (nextStateCSD,
-											existingState->getCSD (),
-											HmdpWorld::getRscLowBounds (),
-											HmdpWorld::getRscHighBounds ());
-		      existingState->setCSD (stateCSD); /* previous csd is automatically deleted */
-		    }
-		  
-		  break;  /* skip that outcome == depth reached here. */
-		}
-
-	      if (csd)
-		{
-		  /* compute new state's distribution over resources */
-		  HybridTransitionOutcome *hto = ht->getOutcome (i);
-		  ContinuousStateDistribution *nextStateCSD 
-		    = ContinuousStateDistribution::frontUp (hst->getCSD (), hto->getContTransition (),
-							    HmdpWorld::getRscLowBounds (),
-							    HmdpWorld::getRscHighBounds (),
-							    hto->getOutcomeProbability ());
-		  nextState->setCSD (nextStateCSD);
-		}
+	      pushed = NULL;
+	      continue;
+	    }
 
-	      /* TODO: instantiate actions that could not be instantiated before */
+	  /* test if actions are applicable to this state, check on the discrete state,
+	     and check on max resources (equivalent to not check on resources).
+	     Slots for their successors are reserved in the states graph. */
+	  stack.push_back (SearchFrame ());
+	  SearchFrame &frame = stack.back ();
+	  frame.m_state = pushed;
+	  frame.m_action = 0;
+	  frame.m_outcome = 0;
+	  std::vector<std::pair<int,int> > slots;
+	  std::map<size_t, HybridTransition*>::const_iterator ai;
+	  for (ai = HmdpWorld::actionsBegin (); ai != HmdpWorld::actionsEnd (); ai++)
+	    if (HmdpWorld::isActionEnabled ((*ai).first, *pushed))
+	      {
+		frame.m_enabled.push_back (*ai);
+		slots.push_back (std::pair<int,int> ((*ai).second->getActionIndex (),
+						     (*ai).second->getNOutcomes ()));
+	      }
+	  frame.m_slot = graph.expandState (pushed, slots);
+	  pushed = NULL;
+	}
 
-	      /* add state to successors */
-	      HmdpEngine::addNextState (hst, ht->getActionIndex (), nextState);
-	      if (pstates)
-		HmdpEngine::addParentState(hst,ht->getActionIndex(),ht->getOutcome(i)->getOutcomeProbability(),nextState);
+      SearchFrame &frame = stack.back ();
+      if (frame.m_action == frame.m_enabled.size ())
+	{
+	  /* backup */
+	  HmdpState *bst = frame.m_state;
+	  stack.pop_back ();
+	  if (backups)
+	    {
+	      std::chrono::time_point<std::chrono::steady_clock> bu_start, bu_end;
+	      bu_start = std::chrono::steady_clock::now();
+	      HmdpEngine::BspBackup (bst);
+	      bu_end = m_tend = std::chrono::steady_clock::now();
+	      double elapsed = std::chrono::duration<double>(m_tend-m_tstart).count();
+	      double elapsed_bu = std::chrono::duration<double>(bu_end-bu_start).count();
+	      m_nbackups++;
+	      m_mean_backup_time += elapsed_bu;
+	      m_leaves += HmdpWorld::getFirstInitialState()->getVF()->countLeaves();
 	      
-	      /* dfs recursive backup */
-	      HmdpEngine::DepthFirstSearchBackupCSD (nextState,backups,csd,pstates,max_dfs_recur);
+	      // log total time, total number of backup states, total number of vf backups, last state backup time, mean state backup time
+	      std::cout << "\r" << std::setprecision(5) << elapsed << std::setw(owidth) << fixed << m_nbackups << std::setw(owidth) << fixed << m_vf_nbackups
+			<< std::setw(owidth) << fixed << elapsed_bu << std::setw(owidth) << fixed << m_mean_backup_time / static_cast<double>(m_nbackups) << std::setw(10) << m_leaves;
 	    }
-	}  /* end if enabled */
-    }  /* end for actions */
+	  continue;
+	}
 
-  /* backup */
-  if (backups)
-    {
-      std::chrono::time_point<std::chrono::system_clock> bu_start, bu_end;
-      bu_start = std::chrono::system_clock::now();
-      HmdpEngine::BspBackup (hst);
-      bu_end = m_tend = std::chrono::system_clock::now();
-      int elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(m_tend-m_tstart).count();
-      int elapsed_bu_ms = std::chrono::duration_cast<std::chrono::milliseconds>(bu_end-bu_start).count();
-      m_nbackups++;
-      m_mean_backup_time += elapsed_bu_ms / 1000.0;
-      m_leaves += HmdpWorld::getFirstInitialState()->getVF()->countLeaves();
+      /* next discrete outcome of the current action. */
+      HmdpState *cst = frame.m_state;
+      size_t a = frame.m_action;
+      HybridTransition *ht = frame.m_enabled[a].second;
+      int i = frame.m_outcome;
+      if (++frame.m_outcome == ht->getNOutcomes ())
+	{
+	  frame.m_action++;
+	  frame.m_outcome = 0;
+	}
+      HybridTransitionOutcome *hto = ht->getOutcome (i);
       
-      // log total time, total number of backup states, total number of vf backups, last state backup time, mean state backup time
-      std::cout << "\r" << std::setprecision(5) << elapsed_ms/1000.0 << std::setw(owidth) << fixed << m_nbackups << std::setw(owidth) << fixed << m_vf_nbackups
-		<< std::setw(owidth) << fixed << elapsed_bu_ms / 1000.0 << std::setw(owidth) << fixed << m_mean_backup_time / static_cast<double>(m_nbackups) << std::setw(10) << m_leaves;
+      /* discrete outcome effect, the successor state is created only if it
+	 has not been visited yet. */
+      StateChanges changes;
+      HmdpWorld::getNonResourceActionChanges (frame.m_enabled[a].first, *cst, i, changes);
+      memory += edgeMemory;
+
+      /* test if state has been already visited. */
+      HmdpState *existingState = NULL;
+      if ((existingState = graph.findSuccessor (*cst, changes)) != NULL)
+	{
+	  graph.setSuccessor (frame.m_slot + a, i, existingState, hto->getOutcomeProbability ());
+	  
+	  if (csd)
+	    {
+	      /* 
+		 update existing state's distribution over resources:
+		 - compute the arrival state distribution,
+		 - add it to the existing state's distribution.
+	      */
+	      ContinuousStateDistribution *nextStateCSD
+		= ContinuousStateDistribution::frontUp (cst->getCSD (), 
+							hto->getContTransition (),
+							HmdpWorld::getRscLowBounds (),
+							HmdpWorld::getRscHighBounds (),
+							hto->getOutcomeProbability ());
+	      ContinuousStateDistribution *stateCSD
+		= ContinuousStateDistribution::addContinuousStateDistributions (nextStateCSD,
+										existingState->getCSD (),
+										HmdpWorld::getRscLowBounds (),
+										HmdpWorld::getRscHighBounds ());
+	      existingState->setCSD (stateCSD); /* previous csd is automatically deleted */
+	    }
+	  
+	  continue;  /* skip that outcome == depth reached here. */
+	}
+      
+      /* compute new state's distribution over resources (none if
+	 distributions are not propagated). */
+      ContinuousStateDistribution *nextStateCSD = NULL;
+      if (csd)
+	nextStateCSD
+	  = ContinuousStateDistribution::frontUp (cst->getCSD (), hto->getContTransition (),
+						  HmdpWorld::getRscLowBounds (),
+						  HmdpWorld::getRscHighBounds (),
+						  hto->getOutcomeProbability ());
+      HmdpState *nextState = new HmdpState (*cst, changes, nextStateCSD);
+
+      /* TODO: instantiate actions that could not be instantiated before */
+
+      /* add state to successors, and search from it. */
+      graph.addState (nextState);
+      graph.setSuccessor (frame.m_slot + a, i, nextState, hto->getOutcomeProbability ());
+      memory += nextState->getMemoryEstimate ();
+      pushed = nextState;
     }
       
   //debug
   /*std::cout << "[Debug]:backup done for state:\n";
     hst->print (std::cout);*/
   //debug
+
+  /* once the search is done, index the predecessors of the states. */
+  if (pstates)
+    graph.buildPredecessors ();
+  HmdpEngine::clearGoalRewards ();
+}
+
+/**
+ * \brief successors of a state under discovery, in order of enabled actions and outcomes.
+ */
+struct StateExpansion
+{
+  std::vector<std::pair<size_t,HybridTransition*> > m_enabled;  /**< enabled actions. */
+  std::vector<StateChanges> m_changes;  /**< changes of each outcome to the state. */
+  std::vector<HmdpState*> m_successors;  /**< successors already in the graph, NULL if new. */
+};
+
+void HmdpEngine::DiscoverStates (HmdpState *initState,
+				 const DiscoveryLimits &limits)
+{
+  MetricsTimer timer (METRICS_DISCOVERY);
+  StateGraph &graph = HmdpEngine::m_stateGraph;
+  if (initState->getGraphIndex () < 0)
+    graph.addState (initState);
+  size_t memory = 0;
+  for (size_t s=0; s<graph.getNStates (); s++)
+    memory += graph.getState (s)->getMemoryEstimate ();
+  const size_t edgeMemory = 2 * (sizeof (int) + sizeof (double));  /* successor and predecessor entries. */
+  
+  std::vector<HmdpState*> frontier, next;
+  if (! graph.isExpanded (initState->getGraphIndex ()))
+    frontier.push_back (initState);
+  int depth = 0;
+  bool full = false;
+  while (! frontier.empty () && ! full)
+    {
+      if (limits.m_maxDepth >= 0 && depth >= limits.m_maxDepth)
+	break;
+      
+      /* the changes of the outcomes are computed sequentially, since the world
+	 is not thread-safe. */
+      std::vector<StateExpansion> expansions (frontier.size ());
+      for (size_t j=0; j<frontier.size (); j++)
+	{
+	  HmdpState *hst = frontier[j];
+	  StateExpansion &ex = expansions[j];
+	  std::map<size_t, HybridTransition*>::const_iterator ai;
+	  for (ai = HmdpWorld::actionsBegin (); ai != HmdpWorld::actionsEnd (); ai++)
+	    if (HmdpWorld::isActionEnabled ((*ai).first, *hst))
+	      {
+		ex.m_enabled.push_back (*ai);
+		for (int i=0; i<(*ai).second->getNOutcomes (); i++)
+		  {
+		    ex.m_changes.push_back (StateChanges ());
+		    HmdpWorld::getNonResourceActionChanges ((*ai).first, *hst, i, ex.m_changes.back ());
+		  }
+	      }
+	  ex.m_successors.resize (ex.m_changes.size (), NULL);
+	}
+
+      /* successors are then looked up concurrently, against the states
+	 of the graph, that is not modified in the meantime. */
+      size_t ntasks = 1;
+      if (HmdpEngine::m_viPool)
+	ntasks = std::max (static_cast<size_t> (1),
+			   std::min (frontier.size (),
+				     static_cast<size_t> (4 * HmdpEngine::m_viPool->getNThreads ())));
+      std::vector<std::function<void ()> > tasks;
+      for (size_t t=0; t<ntasks; t++)
+	tasks.push_back ([&, t] ()
+	  {
+	    for (size_t j=t; j<frontier.size (); j+=ntasks)
+	      {
+		HmdpState *hst = frontier[j];
+		StateExpansion &ex = expansions[j];
+		for (size_t k=0; k<ex.m_changes.size (); k++)
+		  ex.m_successors[k] = graph.findSuccessor (*hst, ex.m_changes[k]);
+	      }
+	  });
+      if (HmdpEngine::m_viPool && ntasks > 1)
+	HmdpEngine::m_viPool->run (tasks);
+      else tasks[0] ();
+
+      /* new states are created in order, as in a sequential breadth first search. */
+      next.clear ();
+      for (size_t j=0; j<frontier.size (); j++)
+	{
+	  HmdpState *hst = frontier[j];
+	  StateExpansion &ex = expansions[j];
+	  long nnew = 0;
+	  for (size_t k=0; k<ex.m_successors.size (); k++)
+	    if (! ex.m_successors[k]
+		&& ! (ex.m_successors[k] = graph.findSuccessor (*hst, ex.m_changes[k])))
+	      nnew++;
+	  if ((limits.m_maxStates >= 0
+	       && static_cast<long> (graph.getNStates ()) + nnew > limits.m_maxStates)
+	      || (limits.m_maxMemory > 0 && memory >= limits.m_maxMemory))
+	    {
+	      full = true;  /* this state and the next ones are left unexpanded. */
+	      break;
+	    }
+	  
+	  std::vector<std::pair<int,int> > slots;
+	  for (size_t a=0; a<ex.m_enabled.size (); a++)
+	    slots.push_back (std::pair<int,int> (ex.m_enabled[a].second->getActionIndex (),
+						 ex.m_enabled[a].second->getNOutcomes ()));
+	  size_t slot = graph.expandState (hst, slots);
+	  size_t k = 0;
+	  for (size_t a=0; a<ex.m_enabled.size (); a++)
+	    {
+	      HybridTransition *ht = ex.m_enabled[a].second;
+	      for (int i=0; i<ht->getNOutcomes (); i++, k++)
+		{
+		  /* an earlier outcome of the state may have created the successor. */
+		  HmdpState *nextState = ex.m_successors[k];
+		  if (! nextState && ! (nextState = graph.findSuccessor (*hst, ex.m_changes[k])))
+		    {
+		      nextState = new HmdpState (*hst, ex.m_changes[k], NULL);
+		      graph.addState (nextState);
+		      next.push_back (nextState);
+		      memory += nextState->getMemoryEstimate ();
+		    }
+		  graph.setSuccessor (slot + a, i, nextState,
+				      ht->getOutcome (i)->getOutcomeProbability ());
+		  memory += edgeMemory;
+		}
+	    }
+	}
+      frontier.swap (next);
+      ++depth;
+    }
+  graph.buildPredecessors ();
+  std::cerr << "discovered states: " << graph.getNStates () << " -- expanded: "
+	    << graph.getNExpandedStates () << " -- depth: " << depth
+	    << " -- estimated memory: " << memory / 1024 << "KB" << std::endl;
 }
 
 void HmdpEngine::ValueIteration(HmdpState *initState,
 				const double &gamma,
 				const double &epsilon,
 				const int &T,
-				const int &max_dfs_recur)
+				const DiscoveryLimits &limits,
+				const ValueIterationMode &mode)
 {
   int i = 0;
 
-  // fillup the set of all states with dfs.
-  HmdpEngine::DepthFirstSearchBackupCSD(initState,false,false,false,max_dfs_recur);
+  // fillup the set of all states.
+  HmdpEngine::DiscoverStates(initState,limits);
+
+  // sweeps go over the expanded states, in order of discovery.
+  bool parallel = (HmdpEngine::m_viPool || mode == VI_JACOBI);
+  std::vector<HmdpState*> states;
+  HmdpEngine::m_stateGraph.getExpandedStates(states);
+  HmdpEngine::initQValues();
   
   double residual = std::numeric_limits<double>::min();
   while(i == 0 || residual > epsilon)
@@ -186,13 +394,16 @@ void HmdpEngine::ValueIteration(HmdpState *initState,
       //debug
 
       residual = std::numeric_limits<double>::min();
-      std::unordered_map<unsigned int,HmdpState*>::iterator mit = HmdpEngine::m_states.begin();
-      while(mit!=HmdpEngine::m_states.end())
+      if (parallel)
+	residual = HmdpEngine::parallelSweep(states,gamma,epsilon,mode);
+      else
 	{
-	  HmdpState *hst = (*mit).second;
-	  HmdpEngine::BspBackup(hst,true,gamma);
-	  residual = std::max(residual,hst->getResidual());
-	  ++mit;
+	  for (size_t s=0;s<states.size();s++)
+	    {
+	      HmdpState *hst = states[s];
+	      HmdpEngine::BspBackup(hst,true,gamma,epsilon);
+	      residual = std::max(residual,hst->getResidual());
+	    }
 	}
       double expectation = initState->getVF()->computeExpectation(initState->getCSD(),
 								  HmdpWorld::getRscLowBounds (),
@@ -202,29 +413,455 @@ void HmdpEngine::ValueIteration(HmdpState *initState,
       if (T > 0 && i >= T)
 	break;
     }
+  HmdpEngine::clearQValues();
+  HmdpEngine::clearGoalRewards();
+}
+
+double HmdpEngine::parallelSweep (const std::vector<HmdpState*> &states,
+				  const double &gamma,
+				  const double &epsilon,
+				  const ValueIterationMode &mode)
+{
+  /* states are spread over the tasks, each task backs its states up on its own bounds. */
+  size_t ntasks = 1;
+  if (HmdpEngine::m_viPool)
+    ntasks = std::max (static_cast<size_t> (1),
+		       std::min (states.size (),
+				 static_cast<size_t> (4 * HmdpEngine::m_viPool->getNThreads ())));
+  std::vector<double> residuals (ntasks, std::numeric_limits<double>::min ());
+  std::vector<std::vector<ValueFunction*> > retiredVFs (ntasks);
+  std::vector<std::function<void ()> > tasks;
+  for (size_t t=0; t<ntasks; t++)
+    tasks.push_back ([&, t] ()
+      {
+	std::vector<double> low (HmdpWorld::getRscLowBounds (),
+				 HmdpWorld::getRscLowBounds () + HmdpWorld::getNResources ());
+	std::vector<double> high (HmdpWorld::getRscHighBounds (),
+				  HmdpWorld::getRscHighBounds () + HmdpWorld::getNResources ());
+	BspOpContext ctx;
+	ctx.m_pool = HmdpEngine::m_backupPool;
+	for (size_t j=t; j<states.size (); j+=ntasks)
+	  {
+	    HmdpState *hst = states[j];
+	    ValueFunction *vf = HmdpEngine::backUpState (ctx, hst, true, gamma, &low[0], &high[0], epsilon);
+	    residuals[t] = std::max (residuals[t], hst->getResidual ());
+	    if (! vf)
+	      continue;  /* unchanged. */
+	    
+	    /* Jacobi: the new value function is visible after the sweep only.
+	       Gauss-Seidel: it is visible right away, the previous one is kept
+	       until the end of the sweep as other tasks may still be reading it. */
+	    if (mode == VI_JACOBI)
+	      hst->setNextVF (vf);
+	    else retiredVFs[t].push_back (hst->exchangeVF (vf));
+	  }
+      });
+  if (HmdpEngine::m_viPool)
+    HmdpEngine::m_viPool->run (tasks);
+  else tasks[0] ();
+
+  double residual = std::numeric_limits<double>::min ();
+  for (size_t t=0; t<ntasks; t++)
+    {
+      residual = std::max (residual, residuals[t]);
+      for (size_t v=0; v<retiredVFs[t].size (); v++)
+	BspTree::deleteBspTree (retiredVFs[t][v]);
+    }
+  if (mode == VI_JACOBI)
+    for (size_t j=0; j<states.size (); j++)
+      states[j]->commitNextVF ();
+  return residual;
+}
+
+void HmdpEngine::TopologicalValueIteration (HmdpState *initState,
+					     const double &gamma,
+					     const double &epsilon,
+					     const int &T,
+					     const DiscoveryLimits &limits)
+{
+  /* fillup the set of all states, and solve it component by component. */
+  HmdpEngine::DiscoverStates (initState, limits);
+  if (HmdpEngine::m_maskedBackups)
+    HmdpEngine::prepareMaskedBackups (initState);
+  HmdpEngine::initQValues ();
+  HmdpEngine::solveComponents (gamma, epsilon, T, true, HmdpEngine::m_maskedBackups);
+  HmdpEngine::clearQValues ();
+  HmdpEngine::clearGoalRewards ();
+
+  double expectation = initState->getVF ()->computeExpectation (initState->getCSD (),
+								HmdpWorld::getRscLowBounds (),
+								HmdpWorld::getRscHighBounds ());
+  std::cerr << "backups: " << m_vf_nbackups.load () << " -- expected: " << expectation << std::endl;
+}
+
+void HmdpEngine::HeuristicSearch (HmdpState *initState,
+				   const double &gamma,
+				   const double &epsilon,
+				   const int &T,
+				   const double &minMass,
+				   const double &heuristic)
+{
+  double h = heuristic;
+  if (h < 0.0 && ! HmdpEngine::computeHeuristic (gamma, h))
+    {
+      std::cerr << "[Error]:HmdpEngine::HeuristicSearch: undiscounted recurrent rewards have no upper bound, a heuristic value is required.\n";
+      return;
+    }
+  std::cerr << "heuristic: " << h << std::endl;
+  
+  /* the initial state is the first tip. */
+  if (initState->getGraphIndex () < 0)
+    HmdpEngine::m_stateGraph.addState (initState);
+  if (! HmdpEngine::m_stateGraph.isExpanded (initState->getGraphIndex ()))
+    initState->setVF (new PiecewiseConstantValueFunction (static_cast<int> (HmdpWorld::getNResources ()),
+							  HmdpWorld::getRscLowBounds (),
+							  HmdpWorld::getRscHighBounds (), h));
+
+  int i = 0;
+  std::vector<HmdpState*> tips;
+  while (true)
+    {
+      /* expands the tips of the best partial solution, then revises the values. */
+      HmdpEngine::collectSolutionTips (initState, minMass, tips);
+      if (tips.empty ())
+	break;
+      for (size_t t=0; t<tips.size (); t++)
+	HmdpEngine::expandTip (tips[t], h);
+      HmdpEngine::initQValues ();
+      HmdpEngine::solveComponents (gamma, epsilon, T, false);
+      
+      double expectation = initState->getVF ()->computeExpectation (initState->getCSD (),
+								    HmdpWorld::getRscLowBounds (),
+								    HmdpWorld::getRscHighBounds ());
+      std::cerr << "iteration #" << i << " -- expanded: " << tips.size () << " -- states: "
+		<< HmdpEngine::m_stateGraph.getNStates () << " -- expected: " << expectation << std::endl;
+      ++i;
+    }
+  HmdpEngine::clearQValues ();
+  HmdpEngine::clearGoalRewards ();
+  std::cerr << "expanded states: " << HmdpEngine::m_stateGraph.getNExpandedStates ()
+	    << " -- backups: " << m_vf_nbackups.load () << std::endl;
+}
+
+bool HmdpEngine::computeHeuristic (const double &gamma, double &h)
+{
+  /* all goals rewards at every step, once per goal with sink goals. */
+  double rsum = 0.0;
+  std::vector<double> low (HmdpWorld::getRscLowBounds (),
+			   HmdpWorld::getRscLowBounds () + HmdpWorld::getNResources ());
+  std::vector<double> high (HmdpWorld::getRscHighBounds (),
+			    HmdpWorld::getRscHighBounds () + HmdpWorld::getNResources ());
+  std::map<std::string, ContinuousReward*>::const_iterator gi;
+  for (gi = HmdpWorld::goalsBegin (); gi != HmdpWorld::goalsEnd (); gi++)
+    {
+      double mval = 0.0;
+      (*gi).second->getMaxValue (mval, &low[0], &high[0]);
+      rsum += std::max (mval, 0.0);
+    }
+  if (gamma < 1.0)
+    h = rsum / (1.0 - gamma);
+  else if (HmdpWorld::m_oneTimeReward)
+    h = rsum;
+  else return false;
+  return true;
+}
+
+void HmdpEngine::propagateDistributions (HmdpState *initState, const double &minMass,
+					 const bool &greedy, std::vector<bool> &reached,
+					 std::vector<bool> *exact)
+{
+  const StateGraph &graph = HmdpEngine::m_stateGraph;
+  size_t nstates = graph.getNStates ();
+  int nrsc = static_cast<int> (HmdpWorld::getNResources ());
+  std::vector<double> low (HmdpWorld::getRscLowBounds (), HmdpWorld::getRscLowBounds () + nrsc);
+  std::vector<double> high (HmdpWorld::getRscHighBounds (), HmdpWorld::getRscHighBounds () + nrsc);
+  
+  /* resource distributions are propagated from the initial state, components first
+     (reverse order), along the greedy or all enabled actions. Within a cyclic component,
+     a state passes on the mass it has received by the time it is visited. */
+  reached.assign (nstates, false);
+  if (exact)
+    exact->assign (nstates, true);
+  for (size_t s=0; s<nstates; s++)
+    if (graph.getState (s) != initState)
+      graph.getState (s)->setCSD (NULL);
+  reached[initState->getGraphIndex ()] = true;
+  
+  std::vector<std::vector<int> > components;
+  std::vector<bool> cyclic;
+  std::vector<int> levels;
+  graph.getComponents (components, cyclic, levels);
+  for (size_t c=components.size (); c-->0; )
+    for (size_t j=components[c].size (); j-->0; )
+      {
+	int s = components[c][j];
+	HmdpState *hst = graph.getState (s);
+	ContinuousStateDistribution *csd = hst->getCSD ();
+	if (! reached[s] || ! csd)
+	  continue;
+	double mass = 0.0;
+	csd->sumUpProbabilities (&mass, &low[0], &high[0]);
+	if (mass < minMass && hst != initState)
+	  continue;
+	
+	/* greedy actions over the support of the distribution, all actions if the
+	   value function does not tell (e.g. piecewise linear value functions). */
+	std::set<int> greedyActions;
+	if (greedy)
+	  {
+	    std::vector<double> min (high), max (low);
+	    csd->getSupportBounds (&min[0], &max[0], &low[0], &high[0]);
+	    hst->getVF ()->collectActions (&greedyActions, &low[0], &high[0], &min[0], &max[0]);
+	  }
+
+	std::map<size_t, HybridTransition*>::const_iterator ai;
+	for (ai = HmdpWorld::actionsBegin (); ai != HmdpWorld::actionsEnd (); ai++)
+	  {
+	    HybridTransition *ht = (*ai).second;
+	    if (! HmdpWorld::isActionEnabled ((*ai).first, *hst)
+		|| (! greedyActions.empty ()
+		    && greedyActions.find (ht->getActionIndex ()) == greedyActions.end ()))
+	      continue;
+	    for (int i=0; i<ht->getNOutcomes (); i++)
+	      {
+		HmdpState *nextState = graph.getSuccessor (hst, ht->getActionIndex (), i);
+		if (! nextState)
+		  continue;
+		HybridTransitionOutcome *hto = ht->getOutcome (i);
+		ContinuousStateDistribution *nextStateCSD
+		  = ContinuousStateDistribution::frontUp (csd, hto->getContTransition (),
+							  &low[0], &high[0],
+							  hto->getOutcomeProbability ());
+		if (nextState->getCSD ())
+		  {
+		    ContinuousStateDistribution *stateCSD
+		      = ContinuousStateDistribution::addContinuousStateDistributions (nextStateCSD,
+										      nextState->getCSD (),
+										      &low[0], &high[0]);
+		    BspTree::deleteBspTree (nextStateCSD);
+		    nextStateCSD = stateCSD;
+		  }
+		if (nextState != initState)
+		  nextState->setCSD (nextStateCSD);
+		else BspTree::deleteBspTree (nextStateCSD);
+		reached[nextState->getGraphIndex ()] = true;
+		if (exact && (cyclic[c] || ! (*exact)[s]))
+		  (*exact)[nextState->getGraphIndex ()] = false;
+	      }
+	  }
+      }
+}
+
+void HmdpEngine::prepareMaskedBackups (HmdpState *initState)
+{
+  std::vector<bool> reached, exact;
+  HmdpEngine::propagateDistributions (initState, 0.0, false, reached, &exact);
+  int nrsc = static_cast<int> (HmdpWorld::getNResources ());
+  for (size_t s=0; s<HmdpEngine::m_stateGraph.getNStates (); s++)
+    {
+      HmdpState *hst = HmdpEngine::m_stateGraph.getState (s);
+      if (! reached[s])
+	hst->setCSD (new ContinuousStateDistribution (nrsc));  /* no mass. */
+      else if (! exact[s] && hst != initState)
+	hst->setCSD (NULL);
+    }
+}
+
+void HmdpEngine::collectSolutionTips (HmdpState *initState, const double &minMass,
+				      std::vector<HmdpState*> &tips)
+{
+  tips.clear ();
+  const StateGraph &graph = HmdpEngine::m_stateGraph;
+  size_t nstates = graph.getNStates ();
+  int nrsc = static_cast<int> (HmdpWorld::getNResources ());
+  std::vector<double> low (HmdpWorld::getRscLowBounds (), HmdpWorld::getRscLowBounds () + nrsc);
+  std::vector<double> high (HmdpWorld::getRscHighBounds (), HmdpWorld::getRscHighBounds () + nrsc);
+  std::vector<bool> reached;
+  HmdpEngine::propagateDistributions (initState, minMass, true, reached);
+
+  /* tips: reached states that are not expanded yet, with enough mass. */
+  for (size_t s=0; s<nstates; s++)
+    {
+      HmdpState *hst = graph.getState (s);
+      if (! reached[s] || graph.isExpanded (s))
+	continue;
+      double mass = 0.0;
+      if (hst->getCSD ())
+	hst->getCSD ()->sumUpProbabilities (&mass, &low[0], &high[0]);
+      if (hst == initState || mass >= minMass)
+	tips.push_back (hst);
+    }
+}
+
+void HmdpEngine::expandTip (HmdpState *hst, const double &heuristic)
+{
+  MetricsTimer timer (METRICS_DISCOVERY);
+  std::vector<std::pair<size_t,HybridTransition*> > enabled;
+  std::vector<std::pair<int,int> > slots;
+  std::map<size_t, HybridTransition*>::const_iterator ai;
+  for (ai = HmdpWorld::actionsBegin (); ai != HmdpWorld::actionsEnd (); ai++)
+    if (HmdpWorld::isActionEnabled ((*ai).first, *hst))
+      {
+	enabled.push_back (*ai);
+	slots.push_back (std::pair<int,int> ((*ai).second->getActionIndex (),
+					     (*ai).second->getNOutcomes ()));
+      }
+  size_t slot = HmdpEngine::m_stateGraph.expandState (hst, slots);
+
+  /* new successors are tips, valued with the heuristic. */
+  StateChanges changes;
+  for (size_t a=0; a<enabled.size (); a++)
+    {
+      HybridTransition *ht = enabled[a].second;
+      for (int i=0; i<ht->getNOutcomes (); i++)
+	{
+	  HmdpWorld::getNonResourceActionChanges (enabled[a].first, *hst, i, changes);
+	  HmdpState *nextState = HmdpEngine::m_stateGraph.findSuccessor (*hst, changes);
+	  if (! nextState)
+	    {
+	      nextState = new HmdpState (*hst, changes, NULL);
+	      nextState->setVF (new PiecewiseConstantValueFunction (static_cast<int> (HmdpWorld::getNResources ()),
+								    HmdpWorld::getRscLowBounds (),
+								    HmdpWorld::getRscHighBounds (), heuristic));
+	      HmdpEngine::m_stateGraph.addState (nextState);
+	    }
+	  HmdpEngine::m_stateGraph.setSuccessor (slot + a, i, nextState,
+						 ht->getOutcome (i)->getOutcomeProbability ());
+	}
+    }
+}
+
+void HmdpEngine::solveComponents (const double &gamma, const double &epsilon, const int &T,
+				  const bool &log, const bool &masked)
+{
+  std::vector<std::vector<int> > components;
+  std::vector<bool> cyclic;
+  std::vector<int> levels;
+  HmdpEngine::m_stateGraph.getComponents (components, cyclic, levels);
+  
+  /* components of a same level only depend on components of lower levels. */
+  int nlevels = 0;
+  size_t ncyclic = 0;
+  for (size_t c=0; c<components.size (); c++)
+    {
+      nlevels = std::max (nlevels, levels[c] + 1);
+      if (cyclic[c])
+	ncyclic++;
+    }
+  std::vector<std::vector<int> > levelComponents (nlevels);
+  for (size_t c=0; c<components.size (); c++)
+    levelComponents[levels[c]].push_back (c);
+  if (log)
+    std::cerr << "components: " << components.size () << " -- cyclic: " << ncyclic
+	      << " -- levels: " << nlevels << std::endl;
+
+  for (int l=0; l<nlevels; l++)
+    {
+      const std::vector<int> &lcomps = levelComponents[l];
+      std::vector<int> sweeps (lcomps.size (), 0);
+      std::vector<std::function<void ()> > tasks;
+      for (size_t k=0; k<lcomps.size (); k++)
+	tasks.push_back ([&, k] ()
+	  {
+	    std::vector<double> low (HmdpWorld::getRscLowBounds (),
+				     HmdpWorld::getRscLowBounds () + HmdpWorld::getNResources ());
+	    std::vector<double> high (HmdpWorld::getRscHighBounds (),
+				      HmdpWorld::getRscHighBounds () + HmdpWorld::getNResources ());
+	    BspOpContext ctx;
+	    ctx.m_pool = HmdpEngine::m_backupPool;
+	    int c = lcomps[k];
+	    sweeps[k] = HmdpEngine::solveComponent (ctx, components[c], cyclic[c], gamma, epsilon, T,
+						    &low[0], &high[0], masked);
+	  });
+      if (HmdpEngine::m_viPool && tasks.size () > 1)
+	HmdpEngine::m_viPool->run (tasks);
+      else
+	for (size_t k=0; k<tasks.size (); k++)
+	  tasks[k] ();
+      if (log)
+	{
+	  int maxSweeps = 0;
+	  for (size_t k=0; k<sweeps.size (); k++)
+	    maxSweeps = std::max (maxSweeps, sweeps[k]);
+	  std::cerr << "level #" << l << " -- components: " << lcomps.size ()
+		    << " -- max sweeps: " << maxSweeps << std::endl;
+	}
+    }
+}
+
+int HmdpEngine::solveComponent (const BspOpContext &ctx, const std::vector<int> &states,
+				const bool &cyclic, const double &gamma, const double &epsilon,
+				const int &T, double *low, double *high,
+				const bool &masked)
+{
+  /* states of the component are not read by other components being solved,
+     their value functions are replaced right away (Gauss-Seidel). */
+  int i = 0;
+  double residual = std::numeric_limits<double>::max ();
+  while (residual > epsilon)
+    {
+      residual = 0.0;
+      for (size_t j=0; j<states.size (); j++)
+	{
+	  HmdpState *hst = HmdpEngine::m_stateGraph.getState (states[j]);
+	  const ContinuousStateDistribution *csd = (masked && ! cyclic) ? hst->getCSD () : NULL;
+	  if (csd && ! ValueFunctionOperations::hasMass (ctx, csd, low, high))
+	    {
+	      /* not reached: a single 'don't care' leaf, without backup. */
+	      hst->setVF (ValueFunctionOperations::maskValueFunction (ctx, hst->getVF (), csd, low, high));
+	      continue;
+	    }
+	  ValueFunction *vf = HmdpEngine::backUpState (ctx, hst, cyclic, gamma, low, high, epsilon);
+	  if (vf && csd)
+	    {
+	      ValueFunction *mvf = ValueFunctionOperations::maskValueFunction (ctx, vf, csd, low, high);
+	      BspTree::deleteBspTree (vf);
+	      vf = mvf;
+	    }
+	  if (vf)
+	    hst->setVF (vf);
+	  if (cyclic)
+	    residual = std::max (residual, hst->getResidual ());
+	}
+      ++i;
+      if (! cyclic || (T > 0 && i >= T))
+	break;
+    }
+  return i;
 }
 
 void HmdpEngine::prioritizedValueIteration(HmdpState *initState,
 					   const double &gamma,
 					   const double &epsilon,
 					   const int &T,
-					   const int &max_dfs_recur)
+					   const DiscoveryLimits &limits)
 {
   int i = 0;
   
-  // fillup the set of all states with dfs.
-  HmdpEngine::DepthFirstSearchBackupCSD(initState,false,false,true,max_dfs_recur);
+  // fillup the set of all states.
+  HmdpEngine::DiscoverStates(initState,limits);
+  HmdpEngine::initQValues();
+
+  if (HmdpEngine::m_viPool)
+    {
+      HmdpEngine::parallelPrioritizedValueIteration(initState,gamma,epsilon,T);
+      HmdpEngine::clearQValues();
+      HmdpEngine::clearGoalRewards();
+      return;
+    }
 
   FibQueue<double> pqueue;
   std::unordered_map<int,FibHeap<double>::FibNode*> hstates;
   std::unordered_map<int,FibHeap<double>::FibNode*>::iterator hsit;
     
   // initial filling of the queue.
-  for (auto hit=HmdpEngine::m_states.begin();hit!=HmdpEngine::m_states.end();++hit)
+  std::vector<HmdpState*> states;
+  HmdpEngine::m_stateGraph.getExpandedStates(states);
+  for (size_t s=0;s<states.size();s++)
     {
-      (*hit).second->setPriority(-epsilon);
-      hstates.insert(std::pair<unsigned int,FibHeap<double>::FibNode*>((*hit).second->getStateIndex(),
-								       pqueue.push((*hit).second->getPriority(),(*hit).second)));
+      states[s]->setPriority(-epsilon);
+      hstates.insert(std::pair<unsigned int,FibHeap<double>::FibNode*>(states[s]->getStateIndex(),
+								       pqueue.push(states[s]->getPriority(),states[s])));
     }
   
   while(!pqueue.empty())
@@ -245,34 +882,28 @@ void HmdpEngine::prioritizedValueIteration(HmdpState *initState,
       HmdpEngine::BspBackup(hst,true,gamma);
       
       // update priorities of all its predecessors. (requires additional structure).
-      std::unordered_map<int,std::multimap<double,HmdpState*> > pred_states = HmdpEngine::getParentStates(hst);
-      auto hit = pred_states.begin();
-      while(hit!=pred_states.end())
+      int s = hst->getGraphIndex();
+      for (size_t p=HmdpEngine::m_stateGraph.getPredecessorsBegin(s);p<HmdpEngine::m_stateGraph.getPredecessorsEnd(s);p++)
 	{
-	  std::multimap<double,HmdpState*>::iterator pit = (*hit).second.begin();
-	  while(pit!=(*hit).second.end())
+	  HmdpState *pred_hst = HmdpEngine::m_stateGraph.getState(HmdpEngine::m_stateGraph.getPredecessor(p));
+	  double prob = HmdpEngine::m_stateGraph.getPredecessorProbability(p);
+	  //std::cerr << "residual: " << hst->getResidual() << " -- prob " << prob << " -- tentative new priority: " << prob*hst->getResidual() << std::endl;
+	  if (hst != pred_hst)
+	    pred_hst->setPriority(std::min(pred_hst->getPriority(),-prob*hst->getResidual()));
+	  else pred_hst->setPriority(-prob*hst->getResidual()); // TODO: this does not max over all outcomes from itself.
+	  if (pred_hst->getPriority() < -epsilon)
 	    {
-	      HmdpState *pred_hst = (*pit).second;
-	      //std::cerr << "residual: " << hst->getResidual() << " -- prob " << (*pit).first << " -- tentative new priority: " << (*pit).first*hst->getResidual() << std::endl;
-	      if (hst != pred_hst)
-		pred_hst->setPriority(std::min(pred_hst->getPriority(),-(*pit).first*hst->getResidual()));
-	      else pred_hst->setPriority(-(*pit).first*hst->getResidual()); // TODO: this does not max over all outcomes from itself.
-	      if (pred_hst->getPriority() < -epsilon)
+	      if ((hsit=hstates.find(pred_hst->getStateIndex()))!=hstates.end())
 		{
-		  if ((hsit=hstates.find(pred_hst->getStateIndex()))!=hstates.end())
-		    {
-		      //std::cerr << "updating state " << pred_hst->getStateIndex() << " with priority " << pred_hst->getPriority() << std::endl;
-		      pqueue.decrease_key((*hsit).second,pred_hst->getPriority());
-		    }
-		  else
-		    {
-		      //std::cerr << "reinserting state " << pred_hst->getStateIndex() << " with priority " << pred_hst->getPriority() << std::endl;
-		      hstates.insert(std::pair<unsigned int,FibHeap<double>::FibNode*>(pred_hst->getStateIndex(),pqueue.push(pred_hst->getPriority(),pred_hst)));
-		    }
+		  //std::cerr << "updating state " << pred_hst->getStateIndex() << " with priority " << pred_hst->getPriority() << std::endl;
+		  pqueue.decrease_key((*hsit).second,pred_hst->getPriority());
+		}
+	      else
+		{
+		  //std::cerr << "reinserting state " << pred_hst->getStateIndex() << " with priority " << pred_hst->getPriority() << std::endl;
+		  hstates.insert(std::pair<unsigned int,FibHeap<double>::FibNode*>(pred_hst->getStateIndex(),pqueue.push(pred_hst->getPriority(),pred_hst)));
 		}
-	      ++pit;
 	    }
-	  ++hit;
 	}
       
       // update priority queue (inefficient, requires a Fibonacci heap instead).
@@ -284,16 +915,237 @@ void HmdpEngine::prioritizedValueIteration(HmdpState *initState,
       if (T > 0 && i >= T)
 	break;
     }
+  HmdpEngine::clearQValues();
+  HmdpEngine::clearGoalRewards();
 }
  
+/**
+ * \brief queueing status of a state in parallel prioritized sweeping.
+ */
+struct PrioritySlot
+{
+  PrioritySlot ()
+  : m_queued (false), m_busy (false), m_deferred (false) {}
+
+  std::mutex m_mutex;  /**< lock on the slot and the state's priority. */
+  bool m_queued;  /**< whether the state has a valid entry in the queue. */
+  bool m_busy;  /**< whether the state is being backed up. */
+  bool m_deferred;  /**< whether the state must be queued again once backed up. */
+};
+
+void HmdpEngine::parallelPrioritizedValueIteration(HmdpState *initState,
+						   const double &gamma,
+						   const double &epsilon,
+						   const int &T)
+{
+  // states and their predecessors are indexed by the states graph, and do not change during the sweeps.
+  const StateGraph &graph = HmdpEngine::m_stateGraph;
+  size_t nstates = graph.getNStates();
+
+  // initial filling of the queue.
+  int nworkers = HmdpEngine::m_viPool->getNThreads();
+  MultiQueue<double> pqueue(4*nworkers);
+  std::vector<PrioritySlot> slots(nstates);
+  std::atomic<int> work(0); // queue entries plus states being backed up.
+  std::atomic<int> nbackups(0);
+  for (size_t s=0;s<nstates;s++)
+    {
+      if (!graph.isExpanded(s))
+	continue;
+      HmdpState *hst = graph.getState(s);
+      hst->setPriority(-epsilon);
+      slots[s].m_queued = true;
+      ++work;
+      pqueue.push(hst->getPriority(),hst);
+    }
+
+  // replaced value functions are deleted once no worker may read them.
+  EpochReclaimer reclaimer(nworkers);
+  std::mutex logMutex;
+  std::vector<std::function<void ()> > tasks;
+  for (int w=0;w<nworkers;w++)
+    tasks.push_back([&, w] ()
+      {
+	std::vector<double> low(HmdpWorld::getRscLowBounds(),
+				HmdpWorld::getRscLowBounds() + HmdpWorld::getNResources());
+	std::vector<double> high(HmdpWorld::getRscHighBounds(),
+				 HmdpWorld::getRscHighBounds() + HmdpWorld::getNResources());
+	BspOpContext ctx;
+	ctx.m_pool = HmdpEngine::m_backupPool;
+	while(work.load() > 0 && (T <= 0 || nbackups.load() < T))
+	  {
+	    double key = 0.0;
+	    void *pl = NULL;
+	    if (!pqueue.pop(key,pl))
+	      {
+		std::this_thread::yield(); // other workers may still queue states.
+		continue;
+	      }
+	    HmdpState *hst = static_cast<HmdpState*>(pl);
+	    int s = hst->getGraphIndex();
+
+	    // claim the state, skipping entries whose priority has been updated since,
+	    // and deferring states being backed up by another worker.
+	    {
+	      std::lock_guard<std::mutex> lock(slots[s].m_mutex);
+	      if (!slots[s].m_queued || key != hst->getPriority())
+		{
+		  --work;
+		  continue;
+		}
+	      slots[s].m_queued = false;
+	      if (slots[s].m_busy)
+		{
+		  slots[s].m_deferred = true;
+		  --work;
+		  continue;
+		}
+	      slots[s].m_busy = true;
+	    }
+	    int i = nbackups++;
+	    if (T > 0 && i >= T)
+	      {
+		std::lock_guard<std::mutex> lock(slots[s].m_mutex);
+		slots[s].m_busy = false;
+		--work;
+		break;
+	      }
+	    
+	    // back it up.
+	    reclaimer.enter(w);
+	    ValueFunction *vf = HmdpEngine::backUpState(ctx,hst,true,gamma,&low[0],&high[0]);
+	    if (vf)
+	      reclaimer.retire(w,hst->exchangeVF(vf));
+	    reclaimer.leave(w);
+	    double residual = hst->getResidual();
+	    
+	    // update priorities of all its predecessors.
+	    for (size_t p=graph.getPredecessorsBegin(s);p<graph.getPredecessorsEnd(s);p++)
+	      {
+		int ps = graph.getPredecessor(p);
+		HmdpState *pred_hst = graph.getState(ps);
+		double prob = graph.getPredecessorProbability(p);
+		std::lock_guard<std::mutex> lock(slots[ps].m_mutex);
+		double priority = pred_hst->getPriority();
+		if (hst != pred_hst)
+		  pred_hst->setPriority(std::min(pred_hst->getPriority(),-prob*residual));
+		else pred_hst->setPriority(-prob*residual); // TODO: this does not max over all outcomes from itself.
+		if (pred_hst->getPriority() < -epsilon)
+		  {
+		    if (slots[ps].m_busy)
+		      slots[ps].m_deferred = true;
+		    else if (!slots[ps].m_queued || pred_hst->getPriority() != priority)
+		      {
+			// previous entry, if any, becomes stale.
+			slots[ps].m_queued = true;
+			++work;
+			pqueue.push(pred_hst->getPriority(),pred_hst);
+		      }
+		  }
+	      }
+
+	    // release the state, and queue it again if it was updated in the meantime.
+	    {
+	      std::lock_guard<std::mutex> lock(slots[s].m_mutex);
+	      slots[s].m_busy = false;
+	      if (slots[s].m_deferred)
+		{
+		  slots[s].m_deferred = false;
+		  if (hst->getPriority() < -epsilon)
+		    {
+		      slots[s].m_queued = true;
+		      ++work;
+		      pqueue.push(hst->getPriority(),hst);
+		    }
+		}
+	    }
+	    {
+	      std::lock_guard<std::mutex> lock(logMutex);
+	      std::cerr << "iteration #" << i << " -- state: " << hst->getStateIndex() << " -- priority: " << key << " -- residual: " << residual << " -- queue size: " << pqueue.size() << std::endl;
+	    }
+	    --work;
+	  }
+      });
+  HmdpEngine::m_viPool->run(tasks);
+
+  double expectation = initState->getVF()->computeExpectation(initState->getCSD(),
+							      HmdpWorld::getRscLowBounds (),
+							      HmdpWorld::getRscHighBounds ());
+  int n = nbackups.load();
+  if (T > 0)
+    n = std::min(n,T);
+  std::cerr << "backups: " << n << " -- expected: " << expectation << std::endl;
+}
+
+ValueFunction* HmdpEngine::backUpAction (const BspOpContext &ctx,
+					 HybridTransition *ht, ValueFunction **nextVFs,
+					 ContinuousReward **goalsR,
+					 const double &gamma,
+					 double *low, double *high)
+{
+  /* the discount is a lazy multiplier of the next value functions, that is applied
+     to the outcome q-values (backups are linear), except for a null discount. */
+  double scale = gamma > 0.0 ? gamma : 1.0;
+  ValueFunction **discStatesVF = new ValueFunction*[ht->getNOutcomes ()];
+  for (int i=0; i<ht->getNOutcomes (); i++)
+    {
+      ValueFunction *nextVF = nextVFs[i];
+      if (gamma > 0.0)
+	discStatesVF[i] = nextVF;
+      else
+	{
+	  discStatesVF[i] = static_cast<ValueFunction*>(BspTreeOperations::copyTree(nextVF));
+	  discStatesVF[i]->multiplyByScalar(gamma);
+	}
+      if (goalsR[i])
+	{
+	  /* the reward is weighted by the outcome probability along with the
+	     outcome q-value, in the backup. */
+	  MetricsTimer timer (METRICS_REWARD);
+	  ValueFunction *vfr = BackupOperations::intersectVFWithReward (ctx, discStatesVF[i], goalsR[i],
+									low, high, scale);
+	  if (discStatesVF[i] != nextVF)
+	    BspTree::deleteBspTree (discStatesVF[i]);
+	  discStatesVF[i] = vfr;
+	}
+    }
+	  
+  /* back it up and get q-value for this action */
+  ValueFunction *htVF = NULL;
+  {
+    MetricsTimer timer (METRICS_TRANSITION);
+    htVF = BackupOperations::backUp (ctx, *ht, discStatesVF, low, high, scale);
+  }
+  for (int i=0; i<ht->getNOutcomes (); i++)
+    if (discStatesVF[i] != nextVFs[i])
+      BspTree::deleteBspTree(discStatesVF[i]);
+  delete []discStatesVF;
+  return htVF;
+}
+
 void HmdpEngine::BspBackup (HmdpState *hst,
 			    const bool &with_residual,
-			    const double &gamma)
+			    const double &gamma,
+			    const double &residualBound)
+{
+  BspOpContext ctx;  /* all tree operations of this backup share the same options. */
+  ctx.m_pool = HmdpEngine::m_backupPool;
+  ValueFunction *maxActionVF = HmdpEngine::backUpState (ctx, hst, with_residual, gamma,
+							HmdpWorld::getRscLowBounds (),
+							HmdpWorld::getRscHighBounds (),
+							residualBound);
+  if (maxActionVF)
+    hst->setVF (maxActionVF);
+}
+
+ValueFunction* HmdpEngine::backUpState (const BspOpContext &ctx, HmdpState *hst,
+					const bool &with_residual, const double &gamma,
+					double *low, double *high,
+					const double &residualBound)
 { 
   ValueFunction *maxActionVF 
     = new PiecewiseConstantValueFunction (static_cast<int> (HmdpWorld::getNResources ()),
-					  HmdpWorld::getRscLowBounds (), 
-					  HmdpWorld::getRscHighBounds (), 0.0);
+					  low, high, 0.0);
   bool firstaction = true;
 
   //debug
@@ -302,6 +1154,13 @@ void HmdpEngine::BspBackup (HmdpState *hst,
   //debug
 
   /* iterate all actions in the world */
+  std::vector<HybridTransition*> actions;
+  std::vector<ValueFunction**> actionsNextVFs;
+  std::vector<ContinuousReward**> actionsGoalsR;
+  std::vector<CachedQValue*> actionsQ;  /* cached q-values, NULL if not cached. */
+  std::vector<bool> actionsValid;  /* whether the cached q-values are up to date. */
+  bool allValid = true;
+  std::unique_lock<std::mutex> wlock (HmdpEngine::m_worldMutex);
   std::map<size_t, HybridTransition*>::const_iterator ai;
   for (ai = HmdpWorld::actionsBegin (); ai != HmdpWorld::actionsEnd (); ai++)
     {
@@ -315,41 +1174,115 @@ void HmdpEngine::BspBackup (HmdpState *hst,
 	     HmdpWorld::getRscHighBounds ()); */
 	  //debug
 	  
+	  /* successors and rewards from goals achieved in the outcomes
+	     (reads the state graph and the world, under lock). */
 	  HybridTransition *ht = (*ai).second;
-	  ValueFunction **discStatesVF = new ValueFunction*[ht->getNOutcomes ()];
+	  ValueFunction **nextVFs = new ValueFunction*[ht->getNOutcomes ()];
+	  ContinuousReward **goalsR = new ContinuousReward*[ht->getNOutcomes ()];
+	  std::vector<unsigned long> versions (ht->getNOutcomes ());
 	  for (int i=0; i<ht->getNOutcomes (); i++)
 	    {
 	      HmdpState *nextState =  HmdpEngine::getNextState (hst, ht->getActionIndex (), i);
-	      if (gamma == 1.0)
-		discStatesVF[i] = nextState->getVF ();
-	      else
-		{
-		  discStatesVF[i] = static_cast<ValueFunction*>(BspTreeOperations::copyTree(nextState->getVF()));
-		  discStatesVF[i]->multiplyByScalar(gamma);
-		}
-	      HybridTransitionOutcome *hto = ht->getOutcome (i);
-	      ContinuousReward *actionGoalR = HmdpEngine::computeRewardFromGoals (hto, nextState);
-	      if (actionGoalR)
-		{
-		  ValueFunction *vfr = BackupOperations::intersectVFWithReward (discStatesVF[i], actionGoalR,
-										HmdpWorld::getRscLowBounds (),
-										HmdpWorld::getRscHighBounds ());
-		  BspTree::deleteBspTree (actionGoalR);
-		  discStatesVF[i] = vfr;
-		}
+	      nextVFs[i] = nextState->getVFLocked (versions[i]);
 	    }
 	  
-	  /* back it up and get q-value for this action */
-	  ValueFunction *htVF = BackupOperations::backUp (*ht, discStatesVF, 
-							  HmdpWorld::getRscLowBounds (), 
-							  HmdpWorld::getRscHighBounds ());
-	  if (gamma != 1.0)
+	  /* the cached q-value, if any, is reused if no successor value function has changed. */
+	  CachedQValue *cq = NULL;
+	  size_t slot = HmdpEngine::m_stateGraph.findActionSlot (hst, ht->getActionIndex ());
+	  if (slot < HmdpEngine::m_qValues.size ())
+	    cq = &HmdpEngine::m_qValues[slot];
+	  bool valid = (cq && cq->m_qVF && cq->m_versions == versions);
+	  for (int i=0; i<ht->getNOutcomes (); i++)
+	    goalsR[i] = valid ? NULL
+	      : HmdpEngine::computeRewardFromGoals (HmdpEngine::getNextState (hst, ht->getActionIndex (), i));
+	  if (cq && ! valid)
+	    cq->m_versions.swap (versions);
+	  allValid = allValid && valid;
+	  actions.push_back (ht);
+	  actionsNextVFs.push_back (nextVFs);
+	  actionsGoalsR.push_back (goalsR);
+	  actionsQ.push_back (cq);
+	  actionsValid.push_back (valid);
+	}  /* end if enabled */
+    }
+  wlock.unlock ();
+
+  /* no q-value has changed since the state's value function was computed from them. */
+  if (allValid && ! actions.empty ())
+    {
+      for (size_t a=0; a<actions.size (); a++)
+	{
+	  delete []actionsNextVFs[a];
+	  delete []actionsGoalsR[a];
+	}
+      BspTree::deleteBspTree (maxActionVF);
+      if (with_residual)
+	hst->setResidual (0.0);
+      return NULL;
+    }
+
+  if (ctx.m_pool && actions.size () > 1)
+    {
+      /* q-values of all actions are computed concurrently, each on its own bounds,
+	 then maxed over as a tree. */
+      std::vector<ValueFunction*> htVFs (actions.size (), NULL);
+      std::vector<std::function<void ()> > tasks;
+      for (size_t a=0; a<actions.size (); a++)
+	if (! actionsValid[a])
+	  tasks.push_back ([&, a] ()
+	    {
+	      std::vector<double> alow (low, low + HmdpWorld::getNResources ());
+	      std::vector<double> ahigh (high, high + HmdpWorld::getNResources ());
+	      htVFs[a] = HmdpEngine::backUpAction (ctx, actions[a], actionsNextVFs[a], actionsGoalsR[a],
+						   gamma, &alow[0], &ahigh[0]);
+	    });
+      ctx.m_pool->run (tasks);
+      m_vf_nbackups += tasks.size ();
+      Metrics::count (METRICS_ACTION_BACKUPS, tasks.size ());
+
+      /* the max consumes its inputs, cached q-values are copied (shared if interned). */
+      for (size_t a=0; a<actions.size (); a++)
+	{
+	  CachedQValue *cq = actionsQ[a];
+	  if (! cq)
+	    continue;
+	  if (! actionsValid[a])
+	    {
+	      if (cq->m_qVF)
+		BspTree::deleteBspTree (cq->m_qVF);
+	      cq->m_qVF = HmdpState::internVF (htVFs[a]);
+	    }
+	  htVFs[a] = static_cast<ValueFunction*> (BspTreeOperations::shareTree (cq->m_qVF));
+	}
+      
+      BspTree::deleteBspTree (maxActionVF);
+      MetricsTimer timer (METRICS_MAX);
+      maxActionVF = ValueFunctionOperations::maxValueFunctions (ctx, htVFs, low, high);
+    }
+  else
+    {
+      bool ownsMax = true;  /* cached q-values are not deleted by the max. */
+      for (size_t a=0; a<actions.size (); a++)
+	{
+	  ValueFunction *htVF = NULL;
+	  CachedQValue *cq = actionsQ[a];
+	  if (actionsValid[a])
+	    htVF = cq->m_qVF;
+	  else
 	    {
-	      for (int i=0; i<ht->getNOutcomes (); i++)  /* fill up array */
-		BspTree::deleteBspTree(discStatesVF[i]);
+	      htVF = HmdpEngine::backUpAction (ctx, actions[a], actionsNextVFs[a],
+					       actionsGoalsR[a], gamma, low, high);
+	      m_vf_nbackups++;
+	      Metrics::count (METRICS_ACTION_BACKUPS);
+	      if (cq)
+		{
+		  if (cq->m_qVF)
+		    BspTree::deleteBspTree (cq->m_qVF);
+		  htVF = HmdpState::internVF (htVF);
+		  cq->m_qVF = htVF;
+		}
 	    }
-	  delete []discStatesVF;
-	  m_vf_nbackups++;
+	  bool ownsQ = (cq == NULL);
 	  
 	  //debug
 	  /* std::cout << "[Debug]: htVF:\n";
@@ -358,30 +1291,40 @@ void HmdpEngine::BspBackup (HmdpState *hst,
 	  //debug
 	  
 	  /* intersect q-values: max over the actions */
- 	  if (firstaction)
+	  if (firstaction)
 	    {
 	      BspTree::deleteBspTree(maxActionVF);
 	      maxActionVF = htVF;
+	      ownsMax = ownsQ;
 	      firstaction = false;
 	    }
 	  else
 	    {
+	      MetricsTimer timer (METRICS_MAX);
 	      ValueFunction *tempVF
-		= ValueFunctionOperations::maxValueFunction (htVF, maxActionVF,
-							     HmdpWorld::getRscLowBounds (),
-							     HmdpWorld::getRscHighBounds ());
+		= ValueFunctionOperations::maxValueFunction (ctx, htVF, maxActionVF, low, high);
 	      //debug
 	      /* std::cout << "[Debug]: temVF (max):\n";
 		 tempVF->print (std::cout, HmdpWorld::getRscLowBounds (), 
 		 HmdpWorld::getRscHighBounds ()); */
 	      //debug
-
-	      BspTree::deleteBspTree (htVF); BspTree::deleteBspTree (maxActionVF);
+	      
+	      if (ownsQ)
+		BspTree::deleteBspTree (htVF);
+	      if (ownsMax)
+		BspTree::deleteBspTree (maxActionVF);
 	      maxActionVF = tempVF;
+	      ownsMax = true;
 	    }
-	  
-	}  /* end if enabled */
-    }  /* end loop over actions */
+	}  /* end loop over actions */
+      if (! ownsMax)
+	maxActionVF = static_cast<ValueFunction*> (BspTreeOperations::shareTree (maxActionVF));
+    }
+  for (size_t a=0; a<actions.size (); a++)
+    {
+      delete []actionsNextVFs[a];
+      delete []actionsGoalsR[a];
+    }
   
   /* set hybrid state vf */
   //debug
@@ -391,55 +1334,108 @@ void HmdpEngine::BspBackup (HmdpState *hst,
   //std::cout << "set it to state: " << hst->getStateIndex () << std::endl;
   //debug
 
+  /* with hash-consing, an unchanged value function is the state's one. */
+  maxActionVF = HmdpState::internVF (maxActionVF);
+
+  /* a value function that has not changed is kept, along with its version, so that
+     the cached q-values of the predecessors remain valid. */
+  if (maxActionVF == hst->getVF ()
+      || (! HmdpEngine::m_qValues.empty ()
+	  && ValueFunctionOperations::identicalValueFunctions (hst->getVF (), maxActionVF)))
+    {
+      BspTree::deleteBspTree (maxActionVF);
+      if (with_residual)
+	hst->setResidual (0.0);
+      return NULL;
+    }
+
   if (with_residual)
     {
-      ValueFunction *rVF = ValueFunctionOperations::subtractValueFunctions(hst->getVF(),maxActionVF,
-									   HmdpWorld::getRscLowBounds (),
-									   HmdpWorld::getRscHighBounds ());
-
-      /*std::cout << "[Debug]::HmdpEngine::BspBackup: rVF:\n";
-      rVF->print (std::cout, HmdpWorld::getRscLowBounds (),
-      HmdpWorld::getRscHighBounds ());*/
-
-      double residual = 0.0;
-      rVF->maxAbsValue(residual,
-		       HmdpWorld::getRscLowBounds (),
-		       HmdpWorld::getRscHighBounds ());
-      //std::cout << "residual: " << residual << std::endl;
-      BspTree::deleteBspTree(rVF);
+      MetricsTimer timer (METRICS_RESIDUAL);
+
+      /* sup-norm of the difference, without building the difference tree. */
+      double residual = ValueFunctionOperations::supNormDifference (ctx, hst->getVF (), maxActionVF,
+								     low, high, residualBound);
       hst->setResidual(residual);
     }
-  
-  hst->setVF (maxActionVF);
+
+  Metrics::count (METRICS_STATE_BACKUPS);
+  Metrics::recordTree (maxActionVF);
+  return maxActionVF;
 }
 
-HmdpState* HmdpEngine::hasBeenVisited (const HmdpState *hst)
+void HmdpEngine::initQValues ()
 {
-  std::unordered_map<unsigned int,HmdpState*>::const_iterator nsi;
-  
-    //std::unordered_map<unsigned int, std::unordered_map<short, std::vector<HmdpState*> > >::const_iterator nsi;
-  /*for (nsi = HmdpEngine::m_nextStates.begin (); 
-       nsi != HmdpEngine::m_nextStates.end (); nsi++)
-    {
-      if ((*nsi).first->isEqual (hst))
-	return (*nsi).first;
-	}*/
-  if ((nsi = HmdpEngine::m_states.find(hst->to_uint()))!=HmdpEngine::m_states.end())
-    {
-      return (*nsi).second;
-    }
-  return NULL;
+  /* slots of the expanded states do not move as the graph grows. */
+  HmdpEngine::m_qValues.resize (HmdpEngine::m_stateGraph.getNActionSlots ());
+}
+
+void HmdpEngine::clearQValues ()
+{
+  for (size_t q=0; q<HmdpEngine::m_qValues.size (); q++)
+    if (HmdpEngine::m_qValues[q].m_qVF)
+      BspTree::deleteBspTree (HmdpEngine::m_qValues[q].m_qVF);
+  HmdpEngine::m_qValues.clear ();
 }
 
-ContinuousReward* HmdpEngine::computeRewardFromGoals (HybridTransitionOutcome *hto,
-							  HmdpState *nextState)
+void HmdpEngine::clearGoalRewards ()
 {
-  ValueFunction *stateVF = nextState->getVF ();
+  std::unordered_map<GoalRewardKey,ContinuousReward*,GoalRewardKeyHash>::iterator ri;
+  for (ri = HmdpEngine::m_goalRewards.begin (); ri != HmdpEngine::m_goalRewards.end (); ri++)
+    if ((*ri).second)
+      BspTree::deleteBspTree ((*ri).second);
+  HmdpEngine::m_goalRewards.clear ();
+}
+
+void HmdpEngine::setBackupThreads (const int &nthreads)
+{
+  delete HmdpEngine::m_backupPool;
+  HmdpEngine::m_backupPool = NULL;
+  if (nthreads > 1)
+    HmdpEngine::m_backupPool = new ThreadPool (nthreads);
+}
+
+void HmdpEngine::setValueIterationThreads (const int &nthreads)
+{
+  delete HmdpEngine::m_viPool;
+  HmdpEngine::m_viPool = NULL;
+  if (nthreads > 1)
+    HmdpEngine::m_viPool = new ThreadPool (nthreads);
+}
+
+size_t GoalRewardKeyHash::operator() (const GoalRewardKey &k) const
+{
+  size_t h = std::hash<int> () (k.m_state);
+  for (size_t w=0; w<k.m_goals.size (); w++)
+    h ^= std::hash<uint64_t> () (k.m_goals[w]) + 0x9e3779b9 + (h << 6) + (h >> 2);
+  return h;
+}
+
+ContinuousReward* HmdpEngine::computeRewardFromGoals (HmdpState *nextState)
+{
+  GoalRewardKey key;
+  key.m_state = nextState->getGraphIndex ();
   
-  /* test goals and return total reward for this outcome (sum of achieved goal). */
-  std::set<int> *achievedGoals = new std::set<int> ();
-  stateVF->collectAchievedGoals (achievedGoals);
+  /* goals already achieved matter to sink goals only. */
+  std::set<int> achievedGoals;
+  if (HmdpWorld::m_oneTimeReward)
+    {
+      ValueFunction *stateVF = nextState->getVFLocked ();
+      stateVF->collectAchievedGoals (&achievedGoals);
+      std::set<int>::const_iterator gi;
+      for (gi = achievedGoals.begin (); gi != achievedGoals.end (); gi++)
+	{
+	  size_t w = static_cast<size_t> (*gi) / 64;
+	  if (key.m_goals.size () <= w)
+	    key.m_goals.resize (w + 1, 0);
+	  key.m_goals[w] |= static_cast<uint64_t> (1) << (*gi % 64);
+	}
+    }
   
+  std::unordered_map<GoalRewardKey,ContinuousReward*,GoalRewardKeyHash>::const_iterator ri;
+  if ((ri = HmdpEngine::m_goalRewards.find (key)) != HmdpEngine::m_goalRewards.end ())
+    return (*ri).second;
+
   //debug
   /* std::cout << "[Debug]:HmdpEngine::computeRewardFromGoals: checking for goals in state:\n";
      nextState->print (std::cout); */
@@ -451,13 +1447,9 @@ ContinuousReward* HmdpEngine::computeRewardFromGoals (HybridTransitionOutcome *h
      under-valued value functions and sub-optimal 
      policies ! TODO... */
   ContinuousReward *totalStateReward = HmdpWorld::sumGoalReward (*nextState, 
-								 achievedGoals); 
-  
-  delete achievedGoals;
+								 &achievedGoals); 
   
-  if (totalStateReward)
-    totalStateReward->multiplyByScalar (hto->getOutcomeProbability ());
-
+  HmdpEngine::m_goalRewards.insert (std::pair<GoalRewardKey,ContinuousReward*> (key, totalStateReward));
   return totalStateReward;
 }
 
@@ -472,10 +1464,15 @@ ContinuousReward* HmdpEngine::computeRewardFromGoals (HmdpState *hst, HybridTran
       HmdpState *nextState = HmdpEngine::getNextState (hst, ht->getActionIndex (), i);
       
       ContinuousReward *totalStateReward
-	= HmdpEngine::computeRewardFromGoals (hto, nextState); 
+	= HmdpEngine::computeRewardFromGoals (nextState); 
       
       if (totalStateReward)
-	outcomesR.push_back (totalStateReward);
+	{
+	  /* cached rewards are shared, weight a copy. */
+	  totalStateReward = static_cast<ContinuousReward*> (BspTreeOperations::copyTree (totalStateReward));
+	  totalStateReward->multiplyByScalar (hto->getOutcomeProbability ());
+	  outcomesR.push_back (totalStateReward);
+	}
     }
   
   /* if no goal achieved in that state. */
@@ -485,53 +1482,25 @@ ContinuousReward* HmdpEngine::computeRewardFromGoals (HmdpState *hst, HybridTran
   /* average total reward over probabilistic discrete outcomes.
      TODO: put in within the previous loop. */
   ContinuousReward *finalReward = outcomesR[0];
-  BspTreeOperations::setIntersectionType (BTI_PLUS);
+  BspOpContext ctx (BTI_PLUS);
   for (unsigned int i=1; i<outcomesR.size (); i++)
     {
       ContinuousReward *sumR 
-	= dynamic_cast<ContinuousReward*> (BspTreeOperations::intersectTrees (finalReward, outcomesR[i],
+	= dynamic_cast<ContinuousReward*> (BspTreeOperations::intersectTrees (ctx, finalReward, outcomesR[i],
 									      HmdpWorld::getRscLowBounds (),
 									      HmdpWorld::getRscHighBounds ()));
       
-      if (BspTreeOperations::m_piecesMerging)
-	sumR->mergeTreeLeaves ();
-      BspTree::deleteBspTree (finalReward);
+      if (ctx.m_piecesMerging)
+	sumR->mergeTreeLeaves (ctx);
+      BspTree::deleteBspTree (finalReward); BspTree::deleteBspTree (outcomesR[i]);
       finalReward = sumR;
-      BspTree::deleteBspTree (outcomesR[i]);
     }
-  if (finalReward != outcomesR[0])
-    BspTree::deleteBspTree (outcomesR[0]);
   return finalReward;
 }
 
-void HmdpEngine::addNextState (HmdpState *hst, const short &action, HmdpState *nextState)
-{
-  HmdpEngine::m_nextStates[hst->to_uint()][action].push_back(nextState);
-}
-
-void HmdpEngine::addParentState(HmdpState *hst, const short &action, const double &outcome, HmdpState *nextState)
-{
-  unsigned int hst_uint = nextState->to_uint();
-  std::unordered_map<unsigned int,std::unordered_map<int,std::multimap<double,HmdpState*> > >::iterator hit;
-  if ((hit=HmdpEngine::m_parentStates.find(hst_uint))==HmdpEngine::m_parentStates.end())
-    {
-      HmdpEngine::m_parentStates.insert(std::pair<unsigned int,std::unordered_map<int,std::multimap<double,HmdpState*> > >(hst_uint,std::unordered_map<int,std::multimap<double,HmdpState*> >()));
-      HmdpEngine::m_parentStates[hst_uint][action].insert(std::pair<double,HmdpState*>(outcome,hst));
-    }
-  else (*hit).second[action].insert(std::pair<double,HmdpState*>(outcome,hst));
-}
-  
 HmdpState* HmdpEngine::getNextState (HmdpState *hst, const short &action, const size_t &pos)
 {
-  return HmdpEngine::m_nextStates[hst->to_uint()][action][pos];
-}
-
-std::unordered_map<int,std::multimap<double,HmdpState*> > HmdpEngine::getParentStates(HmdpState *hst)
-{
-  std::unordered_map<unsigned int,std::unordered_map<int,std::multimap<double,HmdpState*> > >::iterator hit;
-  if ((hit=HmdpEngine::m_parentStates.find(hst->to_uint()))!=HmdpEngine::m_parentStates.end())
-    return (*hit).second;
-  return std::unordered_map<int,std::multimap<double,HmdpState*> >();
+  return HmdpEngine::m_stateGraph.getSuccessor (hst, action, static_cast<int> (pos));
 }
   
 } /* end of namespace */
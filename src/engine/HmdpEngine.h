@@ -19,7 +19,11 @@
 
 #include "HmdpWorld.h"
 #include "HmdpState.h"
+#include "StateGraph.h"
 #include <chrono>
+#include <atomic>
+#include <mutex>
+#include <limits>
 
 using namespace hmdp_base;
 using namespace hmdp_loader;
@@ -27,6 +31,59 @@ using namespace hmdp_loader;
 namespace hmdp_engine
 {
 
+/**
+ * \brief value iteration sweeps: Jacobi backs all states up from the
+ *        previous sweep's value functions, Gauss-Seidel from the latest ones.
+ */
+enum ValueIterationMode {
+  VI_JACOBI, VI_GAUSS_SEIDEL
+};
+
+/**
+ * \brief limits of the discovery of the state space, -1 (or 0 for memory) for none.
+ *        States at the limits are left unexpanded.
+ */
+struct DiscoveryLimits
+{
+  DiscoveryLimits ()
+  : m_maxDepth (-1), m_maxStates (-1), m_maxMemory (0) {}
+
+  int m_maxDepth;  /**< max number of steps from the initial state. */
+  long m_maxStates;  /**< max number of discovered states. */
+  size_t m_maxMemory;  /**< max estimated memory of the discovered states, in bytes. */
+};
+
+/**
+ * \brief key of a cached reward from goals: successor state, and goals already
+ *        achieved in its value function (bitmask).
+ */
+struct GoalRewardKey
+{
+  bool operator== (const GoalRewardKey &k) const
+  { return m_state == k.m_state && m_goals == k.m_goals; }
+
+  int m_state;  /**< successor state index in the state graph. */
+  std::vector<uint64_t> m_goals;  /**< achieved goals, bit i of word i/64 for goal i. */
+};
+
+struct GoalRewardKeyHash
+{
+  size_t operator() (const GoalRewardKey &k) const;
+};
+
+/**
+ * \brief q-value of an action in a state, with the versions of the successors
+ *        value functions it was computed from.
+ */
+struct CachedQValue
+{
+  CachedQValue ()
+  : m_qVF (NULL) {}
+
+  ValueFunction *m_qVF;  /**< q-value, NULL if none. */
+  std::vector<unsigned long> m_versions;  /**< successors value functions versions, one per outcome. */
+};
+
 class HmdpEngine
 {
  public:
@@ -34,43 +91,176 @@ class HmdpEngine
    * \brief depth first search back up that computes each discrete
    *        state's probability distribution over resources during the search.
    *        For this reason, this procedure is slower than the previous one.
+   *        The search runs on an explicit stack: states are expanded when first
+   *        reached, and backed up once all their successors have been visited.
+   *        States reached at the limits (depth along the search path, number of
+   *        discovered states, estimated memory) are left unexpanded.
    * @param initState the initial to start the search from.
    * @param backups whether to perform backups.
    * @param csd whether to propagate probability distribution forward with actions.
-   * @param max_dfs_recur maximum number of recursive calls (default is -1 for unlimited).
+   * @param pstates whether to index the predecessors of the states, once the search is done.
+   * @param limits limits of the search (default is unlimited).
    * @sa HmdpState
    */
   static void DepthFirstSearchBackupCSD (HmdpState *initState,
 					 const bool &backups=true,
 					 const bool &csd=false,
 					 const bool &pstates=false,
-					 const int &max_dfs_recur=-1);
+					 const DiscoveryLimits &limits=DiscoveryLimits ());
+
+  /**
+   * \brief discovery of the states reachable from an initial state, breadth first.
+   *        Outcomes of the states of a level are computed from the world sequentially,
+   *        their successors are looked up in the graph concurrently if threads were set,
+   *        then created in order, so that the state graph does not depend on the number
+   *        of threads. Predecessors are indexed once the discovery is done.
+   * @param initState the initial state.
+   * @param limits limits of the discovery (default is unlimited).
+   * @sa HmdpEngine::setValueIterationThreads, StateGraph
+   */
+  static void DiscoverStates (HmdpState *initState,
+			      const DiscoveryLimits &limits=DiscoveryLimits ());
 
+  /**
+   * \brief value iteration over the set of states discovered from the initial state.
+   *        Sweeps are run concurrently over the states if threads were set.
+   * @param initState the initial state to discover the states from.
+   * @param gamma discount factor.
+   * @param epsilon precision on the residual, for convergence.
+   * @param T maximum number of sweeps, -1 for unlimited.
+   * @param limits limits of the discovery (default is unlimited).
+   * @param mode Jacobi or Gauss-Seidel sweeps (default).
+   * @sa HmdpEngine::setValueIterationThreads
+   */
   static void ValueIteration(HmdpState *initState,
 			     const double &gamma,
 			     const double &epsilon,
 			     const int &T,
-			     const int &max_dfs_recur=-1);
+			     const DiscoveryLimits &limits=DiscoveryLimits (),
+			     const ValueIterationMode &mode=VI_GAUSS_SEIDEL);
 
+  /**
+   * \brief prioritized sweeping value iteration over the set of states discovered
+   *        from the initial state. If threads were set, several workers pop
+   *        and back up states from a relaxed concurrent priority queue.
+   * @param initState the initial state to discover the states from.
+   * @param gamma discount factor.
+   * @param epsilon priority threshold under which states are not queued anymore.
+   * @param T maximum number of state backups, -1 for unlimited.
+   * @param limits limits of the discovery (default is unlimited).
+   * @sa HmdpEngine::setValueIterationThreads
+   */
   static void prioritizedValueIteration(HmdpState *initState,
 					const double &gamma,
 					const double &epsilon,
 					const int &T,
-					const int &max_dfs_recur=-1);
+					const DiscoveryLimits &limits=DiscoveryLimits ());
   
+  /**
+   * \brief topological value iteration: the discovered states are decomposed into strongly
+   *        connected components, that are solved in reverse topological order. States of
+   *        an acyclic component are backed up once, cyclic components are swept until their
+   *        residual falls below epsilon. Components that do not depend on each other are
+   *        solved concurrently if threads were set.
+   * @param initState the initial state to discover the states from.
+   * @param gamma discount factor.
+   * @param epsilon precision on the residual of cyclic components, for convergence.
+   * @param T maximum number of sweeps of a cyclic component, -1 for unlimited.
+   * @param limits limits of the discovery (default is unlimited).
+   * @sa StateGraph::getComponents, HmdpEngine::setValueIterationThreads
+   */
+  static void TopologicalValueIteration (HmdpState *initState,
+					 const double &gamma,
+					 const double &epsilon,
+					 const int &T,
+					 const DiscoveryLimits &limits=DiscoveryLimits ());
+
+  /**
+   * \brief heuristic search (HAO*): expands only the states reached by the current greedy
+   *        policy from the initial state with enough probability mass over resources.
+   *        Unexpanded states (tips) are valued with an admissible upper bound, and the
+   *        expanded states are revised component by component after each expansion,
+   *        until the best partial solution has no tip left.
+   * @param initState the initial state.
+   * @param gamma discount factor.
+   * @param epsilon precision on the residual of cyclic components, for convergence.
+   * @param T maximum number of sweeps of a cyclic component, -1 for unlimited.
+   * @param minMass probability mass under which a reached state is not expanded.
+   * @param heuristic upper bound on the value of any state, negative to compute it from
+   *        the goals rewards (requires gamma < 1 or one-time rewards).
+   * @sa HmdpEngine::collectSolutionTips
+   */
+  static void HeuristicSearch (HmdpState *initState,
+			       const double &gamma,
+			       const double &epsilon,
+			       const int &T,
+			       const double &minMass,
+			       const double &heuristic=-1.0);
+
   static void BspBackup (HmdpState *hst,
 			 const bool &with_residual=false,
-			 const double &gamma=1.0);
+			 const double &gamma=1.0,
+			 const double &residualBound=std::numeric_limits<double>::max ());
+
+  /**
+   * \brief sets the number of threads used within a state backup: actions,
+   *        and discrete and continuous outcomes are then backed up concurrently.
+   * @param nthreads number of threads, 1 for sequential backups (default).
+   */
+  static void setBackupThreads (const int &nthreads);
+
+  /**
+   * \brief sets the number of threads used by value iteration: states of
+   *        a sweep, or popped from the priority queue in prioritized sweeping,
+   *        are then backed up concurrently.
+   * @param nthreads number of threads, 1 for sequential sweeps (default).
+   */
+  static void setValueIterationThreads (const int &nthreads);
+
+  /**
+   * \brief sets masked backups, with depth first search with distributions propagation,
+   *        and with topological value iteration: the value function of a state is only
+   *        computed where its distribution over resources has mass, and is a 'don't care'
+   *        leaf elsewhere. States are then discovered first (breadth first, within the
+   *        discovery limits), the distributions propagated over the whole state graph,
+   *        and the states backed up, successors first.
+   *        States in or after a cycle are backed up without a mask.
+   * @param on whether backups are masked (default is false).
+   */
+  static void setMaskedBackups (const bool &on) { m_maskedBackups = on; }
+
+  /**
+   * \brief deletes the cached rewards from goals. Called at the end of each solver,
+   *        to be called as well once the state graph or the goals have changed.
+   * @sa HmdpEngine::computeRewardFromGoals
+   */
+  static void clearGoalRewards ();
+
+  /**
+   * \brief deletes the cached q-values, and disables caching.
+   * @sa HmdpEngine::initQValues
+   */
+  static void clearQValues ();
 
   /* accessors */
-  static size_t getNStates () { return HmdpEngine::m_nextStates.size (); }
+  static size_t getNStates () { return HmdpEngine::m_stateGraph.getNExpandedStates (); }
 
  private:
-  static ContinuousReward* computeRewardFromGoals (HybridTransitionOutcome *hto,
-						   HmdpState *nextState);
+  /**
+   * \brief reward from the goals achieved in a successor state, not weighted by the
+   *        probability of the outcome that leads to it: the backup of the outcome applies
+   *        it. Rewards are cached per successor state and set of goals already achieved,
+   *        and shared by all actions and backups: the returned tree must not be modified
+   *        nor deleted.
+   * @param nextState the successor state, in the state graph.
+   * @return the reward (bsp tree), NULL if no goal is achieved.
+   * @sa BackupOperations::backUp
+   */
+  static ContinuousReward* computeRewardFromGoals (HmdpState *nextState);
   
   /**
-   * \brief average rewards from goals over an action outcomes.
+   * \brief average rewards from goals over an action outcomes, weighted by
+   *        their probabilities.
    * @param hst the hmdp state from which the action is applied,
    * @param ht the hybrid transition (i.e. action).
    * @return the averaged reward (bsp tree).
@@ -79,30 +269,183 @@ class HmdpEngine
   static ContinuousReward* computeRewardFromGoals (HmdpState *hst, HybridTransition *ht);
 
   /**
-   * \brief tests if a state has already been visited (dfs), and return
-   *        the existing pointer, if any.
-   * @param hst state.
+   * \brief enables caching of the q-values, one per action of the expanded states,
+   *        for a value iteration run over the current state graph and discount factor.
+   *        A cached q-value is reused as long as none of the successors value
+   *        functions it was computed from has changed.
+   * @sa HmdpEngine::clearQValues
+   */
+  static void initQValues ();
+
+  /**
+   * \brief computes the backed up value function of a state, without setting it.
+   *        When q-values are cached, the backup of an action is skipped if its
+   *        successors value functions have not changed since it was last computed.
+   * @param ctx operation context,
+   * @param hst the hmdp state,
+   * @param with_residual whether to set the state residual, w.r.t. its current value function,
+   * @param gamma discount factor,
+   * @param low domain lower bounds,
+   * @param high domain upper bounds,
+   * @param residualBound the residual is exact up to this bound only: above it, it is
+   *        any value greater than the bound, which is enough for convergence tests.
+   * @return the state's new value function (bsp tree), NULL if it is unchanged,
+   *         i.e. when q-values are cached, all of them are up to date or the backed up
+   *         value function is identical to the current one.
+   */
+  static ValueFunction* backUpState (const BspOpContext &ctx, HmdpState *hst,
+				     const bool &with_residual, const double &gamma,
+				     double *low, double *high,
+				     const double &residualBound=std::numeric_limits<double>::max ());
+
+  /**
+   * \brief one sweep of value iteration, with states backed up concurrently.
+   * @param states the states to back up,
+   * @param gamma discount factor,
+   * @param epsilon convergence threshold, residuals are exact up to epsilon only,
+   * @param mode Jacobi or Gauss-Seidel sweep.
+   * @return the max residual over the states.
+   */
+  static double parallelSweep (const std::vector<HmdpState*> &states,
+			       const double &gamma,
+			       const double &epsilon,
+			       const ValueIterationMode &mode);
+
+  /**
+   * \brief solves the expanded states of the state graph, component by component
+   *        in reverse topological order.
+   * @param gamma discount factor,
+   * @param epsilon precision on the residual of cyclic components, for convergence,
+   * @param T maximum number of sweeps of a cyclic component, -1 for unlimited,
+   * @param log whether to log the components and levels,
+   * @param masked whether to mask the value functions of the states of acyclic components
+   *        with their distributions over resources, that must then be complete.
+   * @sa HmdpEngine::TopologicalValueIteration, HmdpEngine::setMaskedBackups
+   */
+  static void solveComponents (const double &gamma, const double &epsilon, const int &T,
+			       const bool &log, const bool &masked=false);
+
+  /**
+   * \brief admissible upper bound on the value of any state: the sum of the max goals
+   *        rewards, over 1-gamma if discounted.
+   * @param gamma discount factor,
+   * @param h the upper bound (result).
+   * @return false if there is no such bound, i.e. undiscounted recurrent rewards.
    */
-  static HmdpState* hasBeenVisited (const HmdpState *hst);
+  static bool computeHeuristic (const double &gamma, double &h);
 
-  /* states dag setter/accessor */
-  static void addNextState (HmdpState *hst, const short &action, HmdpState *nextState);
+  /**
+   * \brief propagates the initial distribution over resources forward over the expanded
+   *        states, components first, in topological order. Within a cyclic component, a state
+   *        passes on the mass it has received by the time it is visited.
+   * @param initState the initial state, whose distribution is left untouched,
+   * @param minMass probability mass under which a state does not pass its distribution on,
+   * @param greedy whether to propagate along the greedy actions only, i.e. those of the
+   *        value function over the support of the distribution, all enabled actions if
+   *        the value function holds none,
+   * @param reached whether each state of the graph is reached (result),
+   * @param exact whether the distribution of each state is complete (result, if not NULL), i.e.
+   *        all its predecessors are in acyclic components and have complete distributions.
+   *        Requires a null minMass.
+   */
+  static void propagateDistributions (HmdpState *initState, const double &minMass,
+				      const bool &greedy, std::vector<bool> &reached,
+				      std::vector<bool> *exact=NULL);
+
+  /**
+   * \brief propagates the initial distribution over resources along all actions, for
+   *        masked backups: states keep their distribution if it is complete, unreached
+   *        states have an empty distribution, others have none.
+   * @param initState the initial state.
+   * @sa HmdpEngine::setMaskedBackups
+   */
+  static void prepareMaskedBackups (HmdpState *initState);
+
+  /**
+   * \brief propagates the initial distribution over resources along the greedy actions
+   *        of the expanded states, and collects the unexpanded states it reaches.
+   *        Greedy actions of a state are those of its value function over the support
+   *        of its distribution, all enabled actions if the value function holds none.
+   * @param initState the initial state,
+   * @param minMass probability mass under which a state does not pass its distribution on,
+   *        and is not a tip,
+   * @param tips the reached unexpanded states (result).
+   */
+  static void collectSolutionTips (HmdpState *initState, const double &minMass,
+				   std::vector<HmdpState*> &tips);
+
+  /**
+   * \brief expands a state in the state graph, without recursion. New successors are
+   *        valued with the heuristic.
+   * @param hst the state to expand,
+   * @param heuristic the heuristic value.
+   */
+  static void expandTip (HmdpState *hst, const double &heuristic);
+
+  /**
+   * \brief solves a strongly connected component of the state graph, whose successors
+   *        components are solved already.
+   * @param ctx operation context,
+   * @param states the states of the component,
+   * @param cyclic whether the component has a cycle,
+   * @param gamma discount factor,
+   * @param epsilon precision on the residual, for convergence,
+   * @param T maximum number of sweeps, -1 for unlimited,
+   * @param low domain lower bounds,
+   * @param high domain upper bounds,
+   * @param masked whether to mask the value functions of the states of an acyclic
+   *        component with their distributions over resources.
+   * @return the number of sweeps.
+   */
+  static int solveComponent (const BspOpContext &ctx, const std::vector<int> &states,
+			     const bool &cyclic, const double &gamma, const double &epsilon,
+			     const int &T, double *low, double *high,
+			     const bool &masked=false);
+
+  /**
+   * \brief prioritized sweeping with several workers, over the already discovered states.
+   * @sa HmdpEngine::prioritizedValueIteration
+   */
+  static void parallelPrioritizedValueIteration(HmdpState *initState,
+						const double &gamma,
+						const double &epsilon,
+						const int &T);
+
+  /**
+   * \brief computes the q-value of an action in a state.
+   * @param ctx operation context,
+   * @param ht the hybrid transition (i.e. action),
+   * @param nextVFs value functions of the successor states, one per outcome of ht,
+   * @param goalsR rewards from goals, one per outcome of ht, or NULL (shared, not deleted),
+   * @param gamma discount factor,
+   * @param low domain lower bounds,
+   * @param high domain upper bounds.
+   * @return the q-value (bsp tree).
+   */
+  static ValueFunction* backUpAction (const BspOpContext &ctx,
+				      HybridTransition *ht, ValueFunction **nextVFs,
+				      ContinuousReward **goalsR,
+				      const double &gamma,
+				      double *low, double *high);
+
+  /* states graph accessor */
   static HmdpState* getNextState (HmdpState *hst, const short &action, const size_t &pos);
-  static void addParentState(HmdpState *hst, const short &action, const double &outcome, HmdpState *nextState);
-  static std::unordered_map<int,std::multimap<double,HmdpState*> > getParentStates(HmdpState *hst);
   
  public:
-  static std::unordered_map<unsigned int,std::unordered_map<int,std::vector<HmdpState*> > > m_nextStates; /**< map of successor states, for each state, filled up during the dfs search. */
-  static std::unordered_map<unsigned int,std::unordered_map<int,std::multimap<double,HmdpState*> > > m_parentStates; /**< map of parent states, for each state. */
-  static std::unordered_map<unsigned int,HmdpState*> m_states;
-  
+  static StateGraph m_stateGraph; /**< graph of the states explored by the dfs search. */
+  static std::unordered_map<GoalRewardKey,ContinuousReward*,GoalRewardKeyHash> m_goalRewards; /**< cached rewards from goals, NULL if none. */
+  static std::vector<CachedQValue> m_qValues; /**< cached q-values, per action slot of the state graph, empty if disabled. */
   
   static int m_nbackups;
-  static int m_vf_nbackups;
-  static int m_mean_backup_time;
+  static std::atomic<int> m_vf_nbackups;
+  static double m_mean_backup_time;
   static int m_leaves;
-  static std::chrono::time_point<std::chrono::system_clock> m_tstart;
-  static std::chrono::time_point<std::chrono::system_clock> m_tend;
+  static ThreadPool *m_backupPool; /**< pool for concurrent backups, NULL if sequential. */
+  static ThreadPool *m_viPool; /**< pool for concurrent value iteration sweeps, NULL if sequential. */
+  static bool m_maskedBackups; /**< whether backups are masked by the states distributions. */
+  static std::mutex m_worldMutex; /**< lock on the world and the states graph, that are not thread-safe. */
+  static std::chrono::time_point<std::chrono::steady_clock> m_tstart;
+  static std::chrono::time_point<std::chrono::steady_clock> m_tend;
 };
 
 } /* end of namespace */
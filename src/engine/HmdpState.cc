@@ -17,61 +17,19 @@
 #include "HmdpState.h"
 #include "HmdpWorld.h"
 #include "BspTreeOperations.h"
+#include "BspTreeStore.h"
 #include <algorithm>
 
 using namespace hmdp_loader;
 
-static unsigned int seed = 4294967291UL; // prime.
-unsigned int murmurhash2 ( const void * key, int len, unsigned int seed )
+/* 64 bit finalizer (splitmix64). */
+static inline uint64_t mix64 (uint64_t x)
 {
-	// 'm' and 'r' are mixing constants generated offline.
-	// They're not really 'magic', they just happen to work well.
-
-	const unsigned int m = 0x5bd1e995;
-	const int r = 24;
-
-	// Initialize the hash to a 'random' value
-
-	unsigned int h = seed ^ len;
-
-	// Mix 4 bytes at a time into the hash
-
-	const unsigned char * data = (const unsigned char *)key;
-
-	while(len >= 4)
-	{
-		unsigned int k = *(unsigned int *)data;
-
-		k *= m; 
-		k ^= k >> r; 
-		k *= m; 
-		
-		h *= m; 
-		h ^= k;
-
-		data += 4;
-		len -= 4;
-	}
-	
-	// Handle the last few bytes of the input array
-
-	switch(len)
-	{
-	case 3: h ^= data[2] << 16;
-	case 2: h ^= data[1] << 8;
-	case 1: h ^= data[0];
-	        h *= m;
-	};
-
-	// Do a few final mixes of the hash to ensure the last few
-	// bytes are well-incorporated.
-
-	h ^= h >> 13;
-	h *= m;
-	h ^= h >> 15;
-
-	return h;
-} 
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
 
 namespace hmdp_engine
 {
@@ -79,7 +37,8 @@ namespace hmdp_engine
 int HmdpState::m_statesCount = 0;
 
 HmdpState::HmdpState ()
-  : m_stateIndex (HmdpState::m_statesCount), m_stateCSD (NULL), m_residual(0.0), m_priority(0.0)
+  : m_stateIndex (HmdpState::m_statesCount), m_nextVF (NULL), m_vfVersion (0), m_stateCSD (NULL), m_residual(0.0), m_priority(0.0),
+    m_hash (0), m_hashValid (false), m_graphIndex (-1)
 {
   HmdpState::m_statesCount++;
   m_stateVF = new PiecewiseConstantValueFunction (static_cast<int> (HmdpWorld::getNResources ()),
@@ -87,7 +46,8 @@ HmdpState::HmdpState ()
 }
 
 HmdpState::HmdpState (ContinuousStateDistribution *csd)
-  : m_stateIndex (HmdpState::m_statesCount), m_stateCSD (csd), m_residual(0.0), m_priority(0.0)
+  : m_stateIndex (HmdpState::m_statesCount), m_nextVF (NULL), m_vfVersion (0), m_stateCSD (csd), m_residual(0.0), m_priority(0.0),
+    m_hash (0), m_hashValid (false), m_graphIndex (-1)
 {
   HmdpState::m_statesCount++;
   m_stateVF = new PiecewiseConstantValueFunction (static_cast<int> (HmdpWorld::getNResources ()),
@@ -95,7 +55,8 @@ HmdpState::HmdpState (ContinuousStateDistribution *csd)
 }
 
 HmdpState::HmdpState (const HmdpState &hst)
-  : m_stateIndex (HmdpState::m_statesCount), m_residual(hst.getResidual()), m_priority(hst.getPriority())
+  : m_stateIndex (HmdpState::m_statesCount), m_nextVF (NULL), m_vfVersion (0), m_residual(hst.getResidual()), m_priority(hst.getPriority()),
+    m_hash (hst.getHash ()), m_hashValid (true), m_graphIndex (-1)
 {
   HmdpState::m_statesCount++;
   
@@ -110,7 +71,7 @@ HmdpState::HmdpState (const HmdpState &hst)
 #endif
   
   if (hst.getVF ())
-    m_stateVF = static_cast<ValueFunction*> (BspTreeOperations::copyTree (hst.getVF ()));
+    m_stateVF = static_cast<ValueFunction*> (BspTreeOperations::shareTree (hst.getVF ()));
   else m_stateVF = 0;
 
   if (hst.getCSD ())
@@ -118,10 +79,31 @@ HmdpState::HmdpState (const HmdpState &hst)
   else m_stateCSD = 0;
 }
 
+HmdpState::HmdpState (const HmdpState &hst, const StateChanges &changes,
+		      ContinuousStateDistribution *csd)
+  : m_stateIndex (HmdpState::m_statesCount), m_nextVF (NULL), m_vfVersion (0), m_stateCSD (csd),
+    m_residual(hst.getResidual()), m_priority(hst.getPriority()),
+    m_hash (hst.getHash ()), m_hashValid (true), m_graphIndex (-1)
+{
+  HmdpState::m_statesCount++;
+
+#ifdef HAVE_PPDDL
+  m_atoms = hst.getDiscStateConst ();
+  applyAtomChanges (changes.m_adds, changes.m_deletes);
+  m_values = changes.m_values;
+#endif
+
+  if (hst.getVF ())
+    m_stateVF = static_cast<ValueFunction*> (BspTreeOperations::shareTree (hst.getVF ()));
+  else m_stateVF = 0;
+}
+
 HmdpState::~HmdpState ()
 {
   if (m_stateVF)
     BspTree::deleteBspTree (m_stateVF);
+  if (m_nextVF)
+    BspTree::deleteBspTree (m_nextVF);
   if (m_stateCSD)
     BspTree::deleteBspTree (m_stateCSD);
 }
@@ -159,11 +141,154 @@ bool HmdpState::isDiscreteEqual (const HmdpState &hst)
 #endif
 }
 
+#ifdef HAVE_PPDDL
+/* whether an atom is in the first n elements of a list. */
+static bool inAtomList (const AtomList &al, const Atom *atom, const size_t &n)
+{
+  for (size_t i=0; i<n; i++)
+    if (al[i] == atom)
+      return true;
+  return false;
+}
+
+/* atoms of a state that changes remove, and atoms that changes add, without
+   duplicates. Deletions apply first, an atom both removed and added stays. */
+static void effectiveAtomChanges (const AtomSet &atoms, const StateChanges &changes,
+				  std::vector<const Atom*> &removed,
+				  std::vector<const Atom*> &added)
+{
+  const AtomList &adds = changes.m_adds;
+  const AtomList &deletes = changes.m_deletes;
+  for (size_t i=0; i<deletes.size (); i++)
+    if (atoms.find (deletes[i]) != atoms.end ()
+	&& ! inAtomList (adds, deletes[i], adds.size ())
+	&& ! inAtomList (deletes, deletes[i], i))
+      removed.push_back (deletes[i]);
+  for (size_t i=0; i<adds.size (); i++)
+    if (atoms.find (adds[i]) == atoms.end ()
+	&& ! inAtomList (adds, adds[i], i))
+      added.push_back (adds[i]);
+}
+#endif
+
+bool HmdpState::isEqualAfterChanges (const HmdpState &hst, const StateChanges &changes) const
+{
+#ifdef HAVE_PPDDL
+  const ValueMap &values = changes.m_values;
+  if (m_values.size () != values.size ()) return false;
+  ValueMap::const_iterator vmi;
+  for (vmi = m_values.begin (); vmi != m_values.end (); vmi++)
+    if (values.find ((*vmi).first) == values.end ())
+      return false;
+  
+  const AtomSet &atoms = hst.getDiscStateConst ();
+  std::vector<const Atom*> removed, added;
+  effectiveAtomChanges (atoms, changes, removed, added);
+  if (m_atoms.size () != atoms.size () - removed.size () + added.size ()) return false;
+  AtomSet::const_iterator asi;
+  for (asi = m_atoms.begin (); asi != m_atoms.end (); asi++)
+    {
+      if (inAtomList (changes.m_adds, *asi, changes.m_adds.size ()))
+	continue;
+      if (atoms.find (*asi) == atoms.end ()
+	  || inAtomList (changes.m_deletes, *asi, changes.m_deletes.size ()))
+	return false;
+    }
+  return true;
+#else
+  return false;
+#endif
+}
+
+/* estimated memory of a value function: its nodes, and the alpha vectors of its
+   leaves with their elements and action sets (red-black tree nodes). */
+static size_t vfMemoryEstimate (const ValueFunction *vf)
+{
+  size_t mem = sizeof (ValueFunction);
+  if (! vf->isLeaf ())
+    return mem + vfMemoryEstimate (static_cast<const ValueFunction*> (vf->getLowerTree ()))
+      + vfMemoryEstimate (static_cast<const ValueFunction*> (vf->getGreaterTree ()));
+  std::vector<AlphaVector*> *vav = vf->getAlphaVectors ();
+  if (vav)
+    {
+      mem += sizeof (std::vector<AlphaVector*>) + vav->capacity () * sizeof (AlphaVector*);
+      for (size_t i=0; i<vav->size (); i++)
+	mem += sizeof (AlphaVector) + (*vav)[i]->getSize () * sizeof (double)
+	  + (*vav)[i]->getActionsSize () * (4 * sizeof (void*) + sizeof (int));
+    }
+  return mem;
+}
+
+size_t HmdpState::getMemoryEstimate () const
+{
+  /* hash table nodes hold the next node and the cached hash besides the element,
+     and the table holds one pointer per bucket. */
+  const size_t hashNode = sizeof (void*) + sizeof (size_t);
+  size_t mem = sizeof (HmdpState);
+#ifdef HAVE_PPDDL
+  mem += m_atoms.size () * (hashNode + sizeof (AtomSet::value_type))
+    + m_atoms.bucket_count () * sizeof (void*);
+  mem += m_values.size () * (hashNode + sizeof (ValueMap::value_type))
+    + m_values.bucket_count () * sizeof (void*);
+#endif
+  if (m_stateVF)
+    mem += vfMemoryEstimate (m_stateVF);
+  if (m_stateCSD)
+    mem += (2 * m_stateCSD->countLeaves () - 1) * sizeof (ContinuousStateDistribution);
+  return mem;
+}
+
+ValueFunction* HmdpState::internVF (ValueFunction *vf)
+{
+  if (! vf || ! BspTreeStore::isEnabled ())
+    return vf;
+  return static_cast<ValueFunction*> (BspTreeStore::intern (vf));
+}
+
 void HmdpState::setVF (ValueFunction *vf)
 {
   if (m_stateVF)
     BspTree::deleteBspTree (m_stateVF);
+  m_stateVF = HmdpState::internVF (vf);
+  m_vfVersion++;
+}
+
+ValueFunction* HmdpState::getVFLocked () const
+{
+  std::lock_guard<std::mutex> lock (m_vfMutex);
+  return m_stateVF;
+}
+
+ValueFunction* HmdpState::getVFLocked (unsigned long &version) const
+{
+  std::lock_guard<std::mutex> lock (m_vfMutex);
+  version = m_vfVersion;
+  return m_stateVF;
+}
+
+ValueFunction* HmdpState::exchangeVF (ValueFunction *vf)
+{
+  vf = HmdpState::internVF (vf);  /* outside of the lock. */
+  std::lock_guard<std::mutex> lock (m_vfMutex);
+  ValueFunction *previous = m_stateVF;
   m_stateVF = vf;
+  m_vfVersion++;
+  return previous;
+}
+
+void HmdpState::setNextVF (ValueFunction *vf)
+{
+  if (m_nextVF)
+    BspTree::deleteBspTree (m_nextVF);
+  m_nextVF = HmdpState::internVF (vf);
+}
+
+void HmdpState::commitNextVF ()
+{
+  if (! m_nextVF)
+    return;
+  setVF (m_nextVF);
+  m_nextVF = NULL;
 }
 
 void HmdpState::setCSD (ContinuousStateDistribution *csd)
@@ -202,10 +327,54 @@ std::string HmdpState::to_str() const
 #endif
 }
 
-unsigned int HmdpState::to_uint() const
+#ifdef HAVE_PPDDL
+uint64_t HmdpState::atomHash (const Atom *atom)
+{
+  uint64_t h = mix64 (static_cast<uint64_t> (atom->predicate ()));
+  for (size_t i=0; i<atom->arity (); i++)
+    h = mix64 (h ^ static_cast<uint64_t> (atom->term (i)));
+  return h;
+}
+
+void HmdpState::applyAtomChanges (const AtomList &adds, const AtomList &deletes)
+{
+  uint64_t h = getHash ();
+  for (AtomList::const_iterator ai = deletes.begin (); ai != deletes.end (); ai++)
+    if (m_atoms.erase (*ai))
+      h -= HmdpState::atomHash (*ai);
+  for (AtomList::const_iterator ai = adds.begin (); ai != adds.end (); ai++)
+    if (m_atoms.insert (*ai).second)
+      h += HmdpState::atomHash (*ai);
+  m_hash = h;
+}
+#endif
+
+uint64_t HmdpState::getHashAfterChanges (const StateChanges &changes) const
+{
+  uint64_t h = getHash ();
+#ifdef HAVE_PPDDL
+  std::vector<const Atom*> removed, added;
+  effectiveAtomChanges (m_atoms, changes, removed, added);
+  for (size_t i=0; i<removed.size (); i++)
+    h -= HmdpState::atomHash (removed[i]);
+  for (size_t i=0; i<added.size (); i++)
+    h += HmdpState::atomHash (added[i]);
+#endif
+  return h;
+}
+
+uint64_t HmdpState::getHash () const
 {
-  std::string str = to_str();
-  return murmurhash2(str.c_str(),str.length(),seed);
+  if (! m_hashValid)
+    {
+      m_hash = 0;
+#ifdef HAVE_PPDDL
+      for (AtomSet::const_iterator ai = m_atoms.begin (); ai != m_atoms.end (); ai++)
+	m_hash += HmdpState::atomHash (*ai);
+#endif
+      m_hashValid = true;
+    }
+  return m_hash;
 }
   
 /* printing */
@@ -27,6 +27,8 @@
 #include "config.h"
 #include "ValueFunction.h"
 #include "ContinuousStateDistribution.h"
+#include <mutex>
+#include <cstdint>
 
 #ifdef HAVE_PPDDL
 #include "expressions.h"  /* structures for the non-resource state are
@@ -39,10 +41,26 @@ using namespace hmdp_base;
 #ifdef HAVE_PPDDL
 using ppddl_parser::ValueMap;
 using ppddl_parser::AtomSet;
+using ppddl_parser::AtomList;
+using ppddl_parser::Atom;
 #endif
 
 namespace hmdp_engine
 {
+
+/**
+ * \brief changes of an action outcome to the non-resource part of a state,
+ *        computed before the successor state is created.
+ * @sa HmdpWorld::getNonResourceActionChanges
+ */
+struct StateChanges
+{
+#ifdef HAVE_PPDDL
+  AtomList m_adds;  /**< added atoms. */
+  AtomList m_deletes;  /**< removed atoms (before the additions). */
+  ValueMap m_values;  /**< non-resource continuous values, once changed. */
+#endif
+};
   
 /**
  * \class HmdpState
@@ -67,6 +85,16 @@ class HmdpState
    */
   HmdpState (const HmdpState &hst);
 
+  /**
+   * \brief constructor of a successor state: the argument state with the
+   *        changes of an action outcome applied. The value function is copied.
+   * @param hst the predecessor state,
+   * @param changes changes of the outcome,
+   * @param csd distribution over resources of the new state (taken over), or NULL.
+   */
+  HmdpState (const HmdpState &hst, const StateChanges &changes,
+	     ContinuousStateDistribution *csd);
+
   ~HmdpState ();
   
   /**
@@ -80,6 +108,15 @@ class HmdpState
   
   bool isDiscreteEqual (const HmdpState &hst);
 
+  /**
+   * \brief tests if this state is identical to the argument state once changed,
+   *        as with isEqual, without creating the changed state.
+   * @param hst the argument state,
+   * @param changes changes to the argument state.
+   * @sa HmdpState::isEqual
+   */
+  bool isEqualAfterChanges (const HmdpState &hst, const StateChanges &changes) const;
+
   /* accessors */
   /**
    * \brief accessor the state unique index.
@@ -99,10 +136,12 @@ class HmdpState
   ValueMap& getContState () { return m_values; }
 
   /**
-   * \brief accessor to the discrete state.
+   * \brief accessor to the discrete state. The state hash is recomputed on its
+   *        next access, as the atoms may be modified through the returned set.
    * @return the set of atoms that form the discrete state.
+   * @sa HmdpState::applyAtomChanges
    */
-  AtomSet& getDiscState () { return m_atoms; }
+  AtomSet& getDiscState () { m_hashValid = false; return m_atoms; }
 
   /**
    * \brief const accessor to the state continuous values.
@@ -113,6 +152,14 @@ class HmdpState
    * \brief const accessor to the discrete state.
    */
   const AtomSet& getDiscStateConst () const { return m_atoms; }
+
+  /**
+   * \brief removes and adds atoms to the discrete state, and updates the state
+   *        hash incrementally.
+   * @param adds atoms to be added,
+   * @param deletes atoms to be removed (before the additions).
+   */
+  void applyAtomChanges (const AtomList &adds, const AtomList &deletes);
 #endif
   
   /**
@@ -131,8 +178,61 @@ class HmdpState
 
   static int getStateCounter () { return HmdpState::m_statesCount; }
 
+  /**
+   * \brief estimated memory held by the state: the state itself, the hash tables of
+   *        its discrete and continuous values, its value function nodes and alpha
+   *        vectors, and its distribution nodes. Subtrees shared with other states
+   *        are counted in each of them.
+   * @return estimated memory, in bytes.
+   */
+  size_t getMemoryEstimate () const;
+
+  /**
+   * \brief accessor to the state's value function, under the state lock.
+   *        To be used when other threads may replace the value function
+   *        concurrently (e.g. Gauss-Seidel value iteration).
+   * @return value function.
+   * @sa HmdpState::exchangeVF
+   */
+  ValueFunction* getVFLocked () const;
+
+  /**
+   * \brief accessor to the state's value function and its version, under the state lock.
+   * @param version the number of times the value function has been replaced.
+   * @return value function.
+   */
+  ValueFunction* getVFLocked (unsigned long &version) const;
+
   /* setters */
+  /**
+   * \brief replaces (and deletes) the state's value function.
+   *        Value functions are interned if hash-consing is enabled.
+   * @param vf the new value function.
+   * @sa HmdpState::internVF
+   */
   void setVF (ValueFunction *vf);
+
+  /**
+   * \brief replaces the state's value function under the state lock. The previous
+   *        value function is not deleted, as concurrent readers may still use it.
+   * @param vf the new value function.
+   * @return the previous value function.
+   */
+  ValueFunction* exchangeVF (ValueFunction *vf);
+
+  /**
+   * \brief buffers the next value function of the state, that replaces the
+   *        current one on commit (e.g. Jacobi value iteration).
+   * @param vf the next value function.
+   * @sa HmdpState::commitNextVF
+   */
+  void setNextVF (ValueFunction *vf);
+
+  /**
+   * \brief replaces the state's value function with the buffered one, if any.
+   */
+  void commitNextVF ();
+
   void setCSD (ContinuousStateDistribution *csd);
   void setCSDToNull ();
   void setResidual(const double &residual) { m_residual = residual; };
@@ -146,7 +246,46 @@ class HmdpState
 
   /* hashing. */
   std::string to_str() const;
-  unsigned int to_uint() const;
+
+  /**
+   * \brief 64 bit hash of the discrete state: commutative sum of the atoms hashes,
+   *        that are computed from their (interned) predicate and term indexes.
+   *        Different states may share a hash, so equality must be checked on a match.
+   *        Non-resource values are not hashed: states that only differ in their
+   *        value maps share a hash and are told apart by the equality check.
+   * @return the state hash.
+   * @sa HmdpState::isEqual
+   */
+  uint64_t getHash () const;
+
+  /**
+   * \brief hash of the state once changed, from its own hash.
+   * @param changes changes to this state.
+   * @return the hash of the changed state.
+   */
+  uint64_t getHashAfterChanges (const StateChanges &changes) const;
+
+  /**
+   * \brief accessor to the index of the state in the engine's state graph.
+   * @return the state index in the graph, -1 if none.
+   * @sa StateGraph
+   */
+  int getGraphIndex () const { return m_graphIndex; }
+
+  void setGraphIndex (const int &s) { m_graphIndex = s; }
+
+  /**
+   * \brief interns a value function if hash-consing is enabled, so that its
+   *        subtrees are shared with the identical subtrees of other value functions.
+   * @param vf value function, consumed.
+   * @return the interned value function, or vf if hash-consing is disabled or vf is NULL.
+   * @sa BspTreeStore
+   */
+  static ValueFunction* internVF (ValueFunction *vf);
+
+#ifdef HAVE_PPDDL
+  static uint64_t atomHash (const Atom *atom);
+#endif
   
  public:
   static int m_statesCount;  /**< hybrid states counter. */
@@ -157,10 +296,16 @@ class HmdpState
   AtomSet m_atoms;  /**< discrete values in this state. */
 #endif  
   ValueFunction *m_stateVF;  /**< value function attached to this state */
+  ValueFunction *m_nextVF;  /**< buffered next value function, NULL if none. */
+  mutable std::mutex m_vfMutex;  /**< lock on the state's value function. */
+  unsigned long m_vfVersion;  /**< number of times the value function has been replaced. */
   ContinuousStateDistribution *m_stateCSD;  /**< state discretized probability distribution
 					       over resources. */
   double m_residual; /**< VF residual, when applicable (e.g. VI). */
   double m_priority; /**< State priority in prioritized backups (e.g. prioritized VI). */
+  mutable uint64_t m_hash;  /**< cached hash of the discrete state. */
+  mutable bool m_hashValid;  /**< whether the cached hash is up to date. */
+  int m_graphIndex;  /**< index in the engine's state graph, -1 if none. */
 };
 
   struct CompareStateResiduals
@@ -0,0 +1,276 @@
+/**
+ * Copyright 2014 Emmanuel Benazera beniz@droidnik.fr
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "StateGraph.h"
+#include "Metrics.h"
+#include <limits>
+#include <algorithm>
+
+namespace hmdp_engine
+{
+
+const size_t StateGraph::m_noAction = std::numeric_limits<size_t>::max ();
+
+StateGraph::StateGraph ()
+  : m_nExpanded (0)
+{
+  m_firstSuccessor.push_back (0);
+  m_firstPred.push_back (0);
+}
+
+StateGraph::~StateGraph ()
+{
+}
+
+HmdpState* StateGraph::findState (const HmdpState &hst) const
+{
+  std::unordered_map<uint64_t,int>::const_iterator ki;
+  uint64_t key = hst.getHash ();
+  while ((ki = m_keys.find (key)) != m_keys.end ())
+    {
+      HmdpState *st = m_states[(*ki).second];
+      if (st == &hst || st->isEqual (hst))
+	return st;
+      key++;  /* hash collision, probe the next key. */
+    }
+  return NULL;
+}
+
+HmdpState* StateGraph::findSuccessor (const HmdpState &hst, const StateChanges &changes) const
+{
+  std::unordered_map<uint64_t,int>::const_iterator ki;
+  uint64_t key = hst.getHashAfterChanges (changes);
+  while ((ki = m_keys.find (key)) != m_keys.end ())
+    {
+      HmdpState *st = m_states[(*ki).second];
+      if (st->isEqualAfterChanges (hst, changes))
+	return st;
+      key++;  /* hash collision, probe the next key. */
+    }
+  return NULL;
+}
+
+int StateGraph::addState (HmdpState *hst)
+{
+  uint64_t key = hst->getHash ();
+  while (m_keys.find (key) != m_keys.end ())
+    key++;
+  int s = static_cast<int> (m_states.size ());
+  m_keys.insert (std::pair<uint64_t,int> (key, s));
+  m_states.push_back (hst);
+  m_firstAction.push_back (m_noAction);
+  Metrics::count (METRICS_STATES);
+  m_nActions.push_back (0);
+  hst->setGraphIndex (s);
+  return s;
+}
+
+size_t StateGraph::expandState (const HmdpState *hst, const std::vector<std::pair<int,int> > &actions)
+{
+  int s = hst->getGraphIndex ();
+  if (m_firstAction[s] == m_noAction)
+    m_nExpanded++;
+  size_t slot = m_actions.size ();
+  m_firstAction[s] = slot;
+  m_nActions[s] = static_cast<int> (actions.size ());
+  for (size_t a=0; a<actions.size (); a++)
+    {
+      m_actions.push_back (actions[a].first);
+      size_t first = m_successors.size ();
+      m_successors.resize (first + actions[a].second, -1);
+      m_probs.resize (first + actions[a].second, 0.0);
+      m_firstSuccessor.push_back (m_successors.size ());
+    }
+  return slot;
+}
+
+void StateGraph::setSuccessor (const size_t &slot, const int &outcome,
+			       const HmdpState *nextState, const double &prob)
+{
+  size_t e = m_firstSuccessor[slot] + outcome;
+  m_successors[e] = nextState->getGraphIndex ();
+  m_probs[e] = prob;
+}
+
+HmdpState* StateGraph::getSuccessor (const HmdpState *hst, const int &action, const int &outcome) const
+{
+  size_t slot = findActionSlot (hst, action);
+  if (slot == m_actions.size ())
+    return NULL;
+  size_t e = m_firstSuccessor[slot] + outcome;
+  if (e >= m_firstSuccessor[slot+1] || m_successors[e] < 0)
+    return NULL;
+  return m_states[m_successors[e]];
+}
+
+size_t StateGraph::findActionSlot (const HmdpState *hst, const int &action) const
+{
+  int s = hst->getGraphIndex ();
+  if (s < 0 || m_firstAction[s] == m_noAction)
+    return m_actions.size ();
+  size_t last = m_firstAction[s] + m_nActions[s];
+  for (size_t slot=m_firstAction[s]; slot<last; slot++)
+    if (m_actions[slot] == action)
+      return slot;
+  return m_actions.size ();
+}
+
+void StateGraph::buildPredecessors ()
+{
+  /* counts, then fills the predecessors of each state, in order of predecessor index.
+     Only the live successor ranges are visited: a re-expanded state leaves its former
+     ranges behind in the successor storage. */
+  size_t nstates = m_states.size ();
+  m_firstPred.assign (nstates + 1, 0);
+  for (size_t s=0; s<nstates; s++)
+    {
+      if (m_firstAction[s] == m_noAction)
+	continue;
+      for (size_t e=getSuccessorsBegin (s); e<getSuccessorsEnd (s); e++)
+	if (m_successors[e] >= 0)
+	  m_firstPred[m_successors[e] + 1]++;
+    }
+  for (size_t s=0; s<nstates; s++)
+    m_firstPred[s+1] += m_firstPred[s];
+  m_predStates.resize (m_firstPred[nstates]);
+  m_predProbs.resize (m_firstPred[nstates]);
+  std::vector<size_t> next (m_firstPred.begin (), m_firstPred.end () - 1);
+  for (size_t s=0; s<nstates; s++)
+    {
+      if (m_firstAction[s] == m_noAction)
+	continue;
+      size_t last = m_firstAction[s] + m_nActions[s];
+      for (size_t slot=m_firstAction[s]; slot<last; slot++)
+	for (size_t e=m_firstSuccessor[slot]; e<m_firstSuccessor[slot+1]; e++)
+	  if (m_successors[e] >= 0)
+	    {
+	      size_t p = next[m_successors[e]]++;
+	      m_predStates[p] = static_cast<int> (s);
+	      m_predProbs[p] = m_probs[e];
+	    }
+    }
+}
+
+void StateGraph::getComponents (std::vector<std::vector<int> > &components,
+				std::vector<bool> &cyclic, std::vector<int> &levels) const
+{
+  components.clear ();
+  cyclic.clear ();
+  levels.clear ();
+  size_t nstates = m_states.size ();
+  std::vector<int> index (nstates, -1), lowlink (nstates, 0), component (nstates, -1);
+  std::vector<bool> onStack (nstates, false), selfLoop (nstates, false);
+  std::vector<int> stack;
+  std::vector<std::pair<int,size_t> > calls;  /* explicit recursion: state and next successor entry. */
+  int counter = 0;
+  for (size_t r=0; r<nstates; r++)
+    {
+      if (index[r] >= 0 || ! isExpanded (r))
+	continue;
+      index[r] = lowlink[r] = counter++;
+      stack.push_back (r); onStack[r] = true;
+      calls.push_back (std::pair<int,size_t> (r, getSuccessorsBegin (r)));
+      while (! calls.empty ())
+	{
+	  int s = calls.back ().first;
+	  if (calls.back ().second < getSuccessorsEnd (s))
+	    {
+	      int t = m_successors[calls.back ().second++];
+	      if (t < 0 || ! isExpanded (t))
+		continue;
+	      if (t == s)
+		selfLoop[s] = true;
+	      if (index[t] < 0)
+		{
+		  index[t] = lowlink[t] = counter++;
+		  stack.push_back (t); onStack[t] = true;
+		  calls.push_back (std::pair<int,size_t> (t, getSuccessorsBegin (t)));
+		}
+	      else if (onStack[t])
+		lowlink[s] = std::min (lowlink[s], index[t]);
+	      continue;
+	    }
+	  
+	  /* all successors of s are done. */
+	  calls.pop_back ();
+	  if (! calls.empty ())
+	    {
+	      int p = calls.back ().first;
+	      lowlink[p] = std::min (lowlink[p], lowlink[s]);
+	    }
+	  if (lowlink[s] != index[s])
+	    continue;
+	  
+	  /* s is the root of a component. */
+	  int c = static_cast<int> (components.size ());
+	  components.push_back (std::vector<int> ());
+	  int t = -1;
+	  do
+	    {
+	      t = stack.back ();
+	      stack.pop_back (); onStack[t] = false;
+	      component[t] = c;
+	      components[c].push_back (t);
+	    }
+	  while (t != s);
+	  cyclic.push_back (components[c].size () > 1 || selfLoop[s]);
+	  
+	  /* successors components are complete, and come before. */
+	  int level = 0;
+	  for (size_t i=0; i<components[c].size (); i++)
+	    {
+	      int u = components[c][i];
+	      for (size_t e=getSuccessorsBegin (u); e<getSuccessorsEnd (u); e++)
+		{
+		  int v = m_successors[e];
+		  if (v >= 0 && component[v] >= 0 && component[v] != c)
+		    level = std::max (level, levels[component[v]] + 1);
+		}
+	    }
+	  levels.push_back (level);
+	}
+    }
+}
+
+void StateGraph::clear ()
+{
+  for (size_t s=0; s<m_states.size (); s++)
+    m_states[s]->setGraphIndex (-1);
+  m_states.clear ();
+  m_keys.clear ();
+  m_nExpanded = 0;
+  m_firstAction.clear ();
+  m_nActions.clear ();
+  m_actions.clear ();
+  m_firstSuccessor.assign (1, 0);
+  m_successors.clear ();
+  m_probs.clear ();
+  m_firstPred.assign (1, 0);
+  m_predStates.clear ();
+  m_predProbs.clear ();
+}
+
+void StateGraph::getExpandedStates (std::vector<HmdpState*> &states) const
+{
+  states.clear ();
+  states.reserve (m_nExpanded);
+  for (size_t s=0; s<m_states.size (); s++)
+    if (m_firstAction[s] != m_noAction)
+      states.push_back (m_states[s]);
+}
+
+} /* end of namespace */
@@ -0,0 +1,184 @@
+/**
+ * Copyright 2014 Emmanuel Benazera beniz@droidnik.fr
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * \brief graph of the discrete states explored from an initial state, with
+ *        states, successors and predecessors stored in contiguous arrays.
+ */
+
+#ifndef STATEGRAPH_H
+#define STATEGRAPH_H
+
+#include "HmdpState.h"
+#include <vector>
+#include <unordered_map>
+
+namespace hmdp_engine
+{
+
+/**
+ * \class StateGraph
+ * \brief explored states have dense indexes, in order of discovery. An expanded
+ *        state has a contiguous range of enabled actions, and each action a
+ *        contiguous range of successors, one per discrete outcome, with their
+ *        probabilities (compressed sparse rows). Ranges are reserved when a
+ *        state is expanded, and filled as its outcomes are explored.
+ *        The reverse (predecessors) index is built once the exploration is done.
+ */
+class StateGraph
+{
+ public:
+  StateGraph ();
+
+  /**
+   * \brief destructor. States are not deleted.
+   */
+  ~StateGraph ();
+
+  /**
+   * \brief looks up a state that is equal to the argument state at the discrete
+   *        and continuous level, by hash first.
+   * @param hst the state to be looked up.
+   * @return the state in the graph, NULL if none.
+   * @sa HmdpState::isEqual
+   */
+  HmdpState* findState (const HmdpState &hst) const;
+
+  /**
+   * \brief looks up the successor of a state through an action outcome, without
+   *        creating it.
+   * @param hst the predecessor state,
+   * @param changes changes of the outcome to the predecessor state.
+   * @return the successor state in the graph, NULL if none.
+   * @sa HmdpState::isEqualAfterChanges
+   */
+  HmdpState* findSuccessor (const HmdpState &hst, const StateChanges &changes) const;
+
+  /**
+   * \brief adds a state to the graph, and sets its index.
+   * @param hst state, not already in the graph.
+   * @return the state index.
+   */
+  int addState (HmdpState *hst);
+
+  /**
+   * \brief reserves the ranges of actions and successors of a state.
+   * @param hst state in the graph,
+   * @param actions enabled actions, as pairs of action index and number of outcomes.
+   * @return the slot of the first action, the others follow.
+   */
+  size_t expandState (const HmdpState *hst, const std::vector<std::pair<int,int> > &actions);
+
+  /**
+   * \brief sets a successor of an expanded state.
+   * @param slot action slot,
+   * @param outcome outcome of the action,
+   * @param nextState successor state, in the graph,
+   * @param prob probability of the outcome.
+   * @sa StateGraph::expandState
+   */
+  void setSuccessor (const size_t &slot, const int &outcome,
+		     const HmdpState *nextState, const double &prob);
+
+  /**
+   * \brief successor of a state by action and outcome.
+   * @param hst expanded state,
+   * @param action action index,
+   * @param outcome outcome of the action.
+   * @return successor state, NULL if none.
+   */
+  HmdpState* getSuccessor (const HmdpState *hst, const int &action, const int &outcome) const;
+
+  /**
+   * \brief slot of an action of a state.
+   * @param hst expanded state,
+   * @param action action index.
+   * @return the action slot, getNActionSlots () if the action is not enabled in the state.
+   */
+  size_t findActionSlot (const HmdpState *hst, const int &action) const;
+
+  /**
+   * \brief builds the predecessors index, from the successors of all expanded states.
+   */
+  void buildPredecessors ();
+
+  /**
+   * \brief strongly connected components of the expanded states (Tarjan), in reverse
+   *        topological order: successors of the states of a component are in the component
+   *        itself or in components that come before it. States that are not expanded have
+   *        no component.
+   * @param components filled up with the states of each component,
+   * @param cyclic filled up with whether each component has a cycle, i.e. more than one state or a self-loop,
+   * @param levels filled up with the level of each component: 0 if its states have no successor
+   *        outside the component, one more than the highest level of their successors components
+   *        otherwise. Components of a same level do not depend on each other.
+   */
+  void getComponents (std::vector<std::vector<int> > &components,
+		      std::vector<bool> &cyclic, std::vector<int> &levels) const;
+
+  /**
+   * \brief empties the graph, states are not deleted.
+   */
+  void clear ();
+
+  /* accessors */
+  size_t getNStates () const { return m_states.size (); }
+  size_t getNExpandedStates () const { return m_nExpanded; }
+  size_t getNActionSlots () const { return m_actions.size (); }
+  HmdpState* getState (const int &s) const { return m_states[s]; }
+  bool isExpanded (const int &s) const { return m_firstAction[s] != m_noAction; }
+
+  /**
+   * \brief fills up the expanded states, by index.
+   */
+  void getExpandedStates (std::vector<HmdpState*> &states) const;
+
+  /* successors of expanded state s, over all its actions, are in
+     [getSuccessorsBegin (s), getSuccessorsEnd (s)), -1 if not set. */
+  size_t getSuccessorsBegin (const int &s) const { return m_firstSuccessor[m_firstAction[s]]; }
+  size_t getSuccessorsEnd (const int &s) const { return m_firstSuccessor[m_firstAction[s] + m_nActions[s]]; }
+  int getSuccessorState (const size_t &e) const { return m_successors[e]; }
+
+  /* predecessors of state s are in [getPredecessorsBegin (s), getPredecessorsEnd (s)),
+     with one entry per (predecessor, action, outcome). */
+  size_t getPredecessorsBegin (const int &s) const { return m_firstPred[s]; }
+  size_t getPredecessorsEnd (const int &s) const { return m_firstPred[s+1]; }
+  int getPredecessor (const size_t &p) const { return m_predStates[p]; }
+  double getPredecessorProbability (const size_t &p) const { return m_predProbs[p]; }
+
+ private:
+  static const size_t m_noAction;  /**< first action of a state that is not expanded. */
+
+  std::vector<HmdpState*> m_states;  /**< states, by index. */
+  std::unordered_map<uint64_t,int> m_keys;  /**< state indexes, by hash (the next free key on collision). */
+  size_t m_nExpanded;  /**< number of expanded states. */
+
+  std::vector<size_t> m_firstAction;  /**< first action slot of each state. */
+  std::vector<int> m_nActions;  /**< number of enabled actions of each state. */
+  std::vector<int> m_actions;  /**< action index of each action slot. */
+  std::vector<size_t> m_firstSuccessor;  /**< first successor of each action slot, plus the end. */
+  std::vector<int> m_successors;  /**< successor states, -1 if not set yet. */
+  std::vector<double> m_probs;  /**< outcome probabilities. */
+
+  std::vector<size_t> m_firstPred;  /**< first predecessor of each state, plus the end. */
+  std::vector<int> m_predStates;  /**< predecessor states. */
+  std::vector<double> m_predProbs;  /**< probabilities of reaching the state from its predecessors. */
+};
+
+} /* end of namespace */
+
+#endif
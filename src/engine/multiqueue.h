@@ -0,0 +1,149 @@
+/**
+ * Copyright 2014 Emmanuel Benazera beniz@droidnik.fr
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * This is a relaxed concurrent min-priority queue (MultiQueue): elements are
+ * spread over several Fibonacci heaps, each with its own lock. A push goes to
+ * a random heap, a pop takes the smaller top of two random heaps. Popped elements
+ * are not strictly the minimum, but close to it with high probability, while
+ * threads seldom contend on the same lock.
+ */
+
+#ifndef MULTIQUEUE_H
+#define MULTIQUEUE_H
+
+#include "fiboheap.h"
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <random>
+#include <limits>
+
+template<class T>
+class MultiQueue
+{
+ public:
+  /**
+   * \brief constructor.
+   * @param nheaps number of underlying heaps, typically a small multiple
+   *        of the number of threads.
+   */
+  MultiQueue(const int &nheaps)
+    :m_heaps(std::max(nheaps,1)),m_size(0)
+    {
+      for (size_t i=0;i<m_heaps.size();i++)
+	m_heaps[i].m_top.store(std::numeric_limits<T>::max());
+    }
+
+  ~MultiQueue()
+    {
+    }
+
+  void push(T k, void *pl)
+  {
+    SubQueue &sq = m_heaps[pick()];
+    std::lock_guard<std::mutex> lock(sq.m_mutex);
+    sq.m_heap.push(k,pl);
+    sq.m_top.store(sq.m_heap.top());
+    ++m_size;
+  }
+
+  /**
+   * \brief pops an element of low key.
+   * @param k the popped element's key,
+   * @param pl the popped element's payload.
+   * @return false if the queue was found empty.
+   */
+  bool pop(T &k, void *&pl)
+  {
+    while (m_size.load() > 0)
+      {
+	/* two random choices, lock the heap with the smaller top, and retry on contention. */
+	size_t i = pick(), j = pick();
+	if (m_heaps[j].m_top.load() < m_heaps[i].m_top.load())
+	  i = j;
+	SubQueue &sq = m_heaps[i];
+	std::unique_lock<std::mutex> lock(sq.m_mutex,std::try_to_lock);
+	if (!lock.owns_lock())
+	  continue;
+	if (sq.m_heap.empty())
+	  {
+	    /* few elements left: scan the heaps rather than sampling empty ones. */
+	    lock.unlock();
+	    if (popAny(k,pl))
+	      return true;
+	    continue;
+	  }
+	popTop(sq,k,pl);
+	return true;
+      }
+    return false;
+  }
+
+  size_t size() const
+  {
+    return m_size.load();
+  }
+
+  bool empty() const
+  {
+    return m_size.load() == 0;
+  }
+
+ private:
+  struct SubQueue
+  {
+    std::mutex m_mutex;
+    FibHeap<T> m_heap;
+    std::atomic<T> m_top; /**< heap top key, readable without the lock. */
+  };
+
+  void popTop(SubQueue &sq, T &k, void *&pl)
+  {
+    typename FibHeap<T>::FibNode *x = sq.m_heap.topNode();
+    k = x->key;
+    pl = x->payload;
+    sq.m_heap.pop();
+    sq.m_top.store(sq.m_heap.empty() ? std::numeric_limits<T>::max() : sq.m_heap.top());
+    --m_size;
+  }
+
+  bool popAny(T &k, void *&pl)
+  {
+    for (size_t i=0;i<m_heaps.size();i++)
+      {
+	SubQueue &sq = m_heaps[i];
+	std::lock_guard<std::mutex> lock(sq.m_mutex);
+	if (!sq.m_heap.empty())
+	  {
+	    popTop(sq,k,pl);
+	    return true;
+	  }
+      }
+    return false;
+  }
+
+  size_t pick()
+  {
+    static thread_local std::minstd_rand rng(std::random_device{}());
+    return rng() % m_heaps.size();
+  }
+
+  std::vector<SubQueue> m_heaps;
+  std::atomic<size_t> m_size;
+};
+
+#endif
@@ -1668,47 +1668,48 @@ void HmdpPpddlLoader::applyNonResourceEffectChanges (const Effect& ef, ValueMap
 }
 
 void HmdpPpddlLoader::applyNonResourceEffectChanges (const Effect& ef, ValueMap &values, AtomSet &atoms, const int &probEfIndex, const int &pb)
+{
+  AtomList adds;
+  AtomList deletes;
+  HmdpPpddlLoader::getNonResourceEffectChanges (ef, values, atoms, probEfIndex, adds, deletes, pb);
+  
+  /* apply the changes */
+  for (AtomList::const_iterator ai = deletes.begin ();
+       ai != deletes.end (); ai++)
+    atoms.erase (*ai);
+  atoms.insert(adds.begin (), adds.end ());
+}
+
+void HmdpPpddlLoader::getNonResourceEffectChanges (const Effect& ef, ValueMap &values, const AtomSet &atoms, const int &probEfIndex,
+						   AtomList &adds, AtomList &deletes)
+{
+  HmdpPpddlLoader::getNonResourceEffectChanges(ef, values, atoms, probEfIndex, adds, deletes, 0);
+}
+
+void HmdpPpddlLoader::getNonResourceEffectChanges (const Effect& ef, ValueMap &values, const AtomSet &atoms, const int &probEfIndex,
+						   AtomList &adds, AtomList &deletes, const int &pb)
 {
   if (ef.getType () != EF_PROB)
     {
-      AtomList adds;
-      AtomList deletes;
       AssignmentList assignments;
       
       /* get the changes */
       ef.state_change (adds, deletes, assignments, atoms, values);
       
-      /* apply the changes */
-      for (AtomList::const_iterator ai = deletes.begin ();
-	   ai != deletes.end (); ai++)
-	atoms.erase (*ai);
-      atoms.insert(adds.begin (), adds.end ());
+      /* apply the changes to the non-resource values */
       for (AssignmentList::const_iterator ai = assignments.begin ();
 	   ai != assignments.end (); ai++)
 	{
 	  Function function = (*ai)->application ().function (); 
 	  if (!HmdpPpddlLoader::getProblem(pb)->domain().functions().isCVariable(function))
 	    (*ai)->affect (values);
-	  /*else
-	    { */ /* resources are set to their MAX value. */
-	      /*std::unordered_map<const Application*, Rational>::iterator vmi;
-		for (vmi = values.begin (); vmi != values.end (); vmi++)
-		if ((*vmi).first->function () == function)
-		{
-		std::string rscname 
-		= HmdpPpddlLoader::getFirstProblem()->domain().functions().name (function);
-		(*vmi).second
-		= Rational (lround (HmdpPpddlLoader::getCVariable (rscname).second.second), 1);
-		break;
-		}
-		} */
 	}
     }
   else
     {
       const ProbabilisticEffect &pef = static_cast<const ProbabilisticEffect&> (ef);
-      HmdpPpddlLoader::applyNonResourceEffectChanges (pef.effect (probEfIndex),
-						      values, atoms, probEfIndex, pb);
+      HmdpPpddlLoader::getNonResourceEffectChanges (pef.effect (probEfIndex),
+						    values, atoms, probEfIndex, adds, deletes, pb);
     }
 }
 
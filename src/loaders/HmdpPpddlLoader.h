@@ -90,6 +90,19 @@ class HmdpPpddlLoader
 					     const int &probEfIndex,
 					     const int &pb);
 
+  /* Same as above, except that the changes to the atoms are returned
+     instead of being applied. */
+  static void getNonResourceEffectChanges (const Effect &ef,
+					   ValueMap &values, const AtomSet &atoms,
+					   const int &probEfIndex,
+					   AtomList &adds, AtomList &deletes);
+
+  static void getNonResourceEffectChanges (const Effect &ef,
+					   ValueMap &values, const AtomSet &atoms,
+					   const int &probEfIndex,
+					   AtomList &adds, AtomList &deletes,
+					   const int &pb);
+
   static const Action& getAction (const size_t &id);
 
   static const Action& getAction (const size_t &id, const int &pb);
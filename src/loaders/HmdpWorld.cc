@@ -76,7 +76,7 @@ void HmdpWorld::loadWorld (const char *filename)
 	    = HmdpPpddlLoader::convertGoal (*(*gi).second, 
 					    HmdpWorld::m_boundedResources.size ());
 	  if (BspTreeOperations::m_asymetricOperators)
-	    cr->updateSubTreeMaxValue ();
+	    cr->updateSubTreeBounds (m_rscLow, m_rscHigh);
 	  HmdpWorld::m_goals[(*gi).first] = cr;
 	}
 
@@ -284,9 +284,35 @@ void HmdpWorld::applyNonResourceActionEffects (const size_t &id, HmdpState *hst,
   if (HmdpWorld::m_st == ST_PPDDL)
     {
       const Action &action = HmdpPpddlLoader::getAction (id);
-      HmdpPpddlLoader::applyNonResourceEffectChanges (action.effect (), 
-						      hst->getContState (), 
-						      hst->getDiscState (), probEfIndex);
+      AtomList adds;
+      AtomList deletes;
+      HmdpPpddlLoader::getNonResourceEffectChanges (action.effect (), 
+						    hst->getContState (), 
+						    hst->getDiscStateConst (), probEfIndex,
+						    adds, deletes);
+      hst->applyAtomChanges (adds, deletes);  /* updates the state hash. */
+    }
+  else
+#endif
+    {
+      /* TODO if needed. */
+    }
+}
+
+void HmdpWorld::getNonResourceActionChanges (const size_t &id, const HmdpState &hst,
+					     const int &probEfIndex, StateChanges &changes)
+{
+#ifdef HAVE_PPDDL
+  if (HmdpWorld::m_st == ST_PPDDL)
+    {
+      const Action &action = HmdpPpddlLoader::getAction (id);
+      changes.m_adds.clear ();
+      changes.m_deletes.clear ();
+      changes.m_values = hst.getContStateConst ();
+      HmdpPpddlLoader::getNonResourceEffectChanges (action.effect (), 
+						    changes.m_values, 
+						    hst.getDiscStateConst (), probEfIndex,
+						    changes.m_adds, changes.m_deletes);
     }
   else
 #endif
@@ -341,8 +367,8 @@ ContinuousReward* HmdpWorld::sumGoalReward (const HmdpState &hst,
 		}
 	      else
 		{
-		  BspTreeOperations::setIntersectionType (BTI_PLUS);
-		  BspTree *bt = BspTreeOperations::intersectTrees (totalR, (*gi).second,
+		  BspTree *bt = BspTreeOperations::intersectTrees (BspOpContext (BTI_PLUS),
+								   totalR, (*gi).second,
 								   HmdpWorld::getRscLowBounds (),
 								   HmdpWorld::getRscHighBounds ());
 		  BspTree::deleteBspTree (totalR);
@@ -363,7 +389,7 @@ ContinuousReward* HmdpWorld::sumGoalReward (const HmdpState &hst,
       /* TODO if needed. */
     }
   if (totalR && BspTreeOperations::m_asymetricOperators)
-    totalR->updateSubTreeMaxValue ();
+    totalR->updateSubTreeBounds (HmdpWorld::getRscLowBounds (), HmdpWorld::getRscHighBounds ());
   return totalR;
 }
 
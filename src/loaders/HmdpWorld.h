@@ -55,6 +55,18 @@ class HmdpWorld
   
   static void applyNonResourceActionEffects (const size_t &id, HmdpState *hst, const int &probEfIndex);
 
+  /**
+   * \brief computes the changes of an action outcome to the non-resource part of
+   *        a state, without applying them.
+   * @param id action id,
+   * @param hst the state the action is applied to,
+   * @param probEfIndex outcome index,
+   * @param changes the changes, filled up.
+   * @sa HmdpWorld::applyNonResourceActionEffects
+   */
+  static void getNonResourceActionChanges (const size_t &id, const HmdpState &hst,
+					   const int &probEfIndex, StateChanges &changes);
+
   /**
    * \brief sum and returns total reward from goal achieved in a given state.
    * @param hst the hybrid state,
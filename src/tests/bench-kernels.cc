@@ -0,0 +1,450 @@
+/**
+ * Copyright 2014 Emmanuel Benazera beniz@droidnik.fr
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BackupOperations.h"
+#include "ContinuousTransition.h"
+#include "ContinuousStateDistribution.h"
+#include "PiecewiseLinearValueFunction.h"
+#include "NormalDiscreteDistribution.h"
+#include "MDDiscreteDistribution.h"
+#include "Metrics.h"
+#ifdef HAVE_LP
+#include "LpSolve5.h"
+#endif
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <functional>
+
+using namespace std;
+using namespace hmdp_base;
+
+/* microbenchmarks of the tree kernels, on random trees.
+   usage: bench_kernels [dim] [leaves] [depth] [alphas] [runs] [ct_tiles] [kernel]
+   - dim: continuous space dimension (default 2),
+   - leaves: number of tiles of the random trees (default 256),
+   - depth: maximum number of cuts from the domain to a tile (default 16),
+   - alphas: linear functions per tile of the pwl trees (default 2),
+   - runs: runs per kernel (default 10),
+   - ct_tiles: number of tiles of the random continuous transitions (default 4),
+   - kernel: runs only the kernels whose name contains this string. */
+
+/* random linear functions (pwl leaves), or one of nalphas values (pwc leaves). */
+void randomLeafValues (PiecewiseLinearValueFunction *leaf, const int &sdim, const int &nalphas)
+{
+  AlphaVector *av = leaf->getAlphaVectorNth (0);
+  for (int k=0; k<=sdim; k++)
+    av->setAlphaNth (k, rand () / (double) RAND_MAX);
+  for (int j=1; j<nalphas; j++)
+    {
+      vector<double> alpha (sdim + 1);
+      for (int k=0; k<=sdim; k++)
+	alpha[k] = rand () / (double) RAND_MAX;
+      leaf->getAlphaVectors ()->push_back (new AlphaVector (sdim + 1, &alpha[0]));
+    }
+}
+
+void randomLeafValues (PiecewiseConstantValueFunction *leaf, const int &sdim, const int &nalphas)
+{
+  leaf->getAlphaVectorNth (0)->setAlphaNth (0, 1 + rand () % nalphas);
+}
+
+/* random guillotine partition of a box in nleaves tiles, with at most depth cuts
+   from the box to a tile. Leaves are copies of a leaf with values, or leaves without
+   values if nalphas is 0. */
+template <class T>
+BspTree* randomSubTree (const T &proto, vector<double> &low, vector<double> &high,
+			const int &nleaves, const int &depth, const int &nalphas)
+{
+  int sdim = static_cast<int> (low.size ());
+  if (nleaves <= 1 || depth == 0)
+    {
+      if (nalphas == 0)
+	return new T (sdim);
+      T *leaf = new T (proto);
+      randomLeafValues (leaf, sdim, nalphas);
+      return leaf;
+    }
+  int d = rand () % sdim;
+  double pos = low[d] + (0.25 + 0.5 * rand () / (double) RAND_MAX) * (high[d] - low[d]);
+  int nlt = 1 + rand () % (nleaves - 1);
+  T *node = new T (sdim, d, pos);
+  double b = high[d];
+  high[d] = pos;
+  node->setLowerTree (randomSubTree (proto, low, high, nlt, depth - 1, nalphas));
+  high[d] = b;
+  b = low[d];
+  low[d] = pos;
+  node->setGreaterTree (randomSubTree (proto, low, high, nleaves - nlt, depth - 1, nalphas));
+  low[d] = b;
+  return node;
+}
+
+/* random tree over the domain: the inner leaf of the domain frame (a box tree)
+   is replaced with a random partition. */
+template <class T>
+T* randomTree (T *frame, double *low, double *high,
+	       const int &nleaves, const int &depth, const int &nalphas)
+{
+  int sdim = frame->getSpaceDimension ();
+  BspTree *parent = frame;
+  for (int i=0; i<sdim; i++)
+    {
+      parent = parent->getLowerTree ();  /* lower bound node. */
+      if (i < sdim - 1)
+	parent = parent->getGreaterTree ();
+    }
+  T *proto = static_cast<T*> (parent->getGreaterTree ());
+  vector<double> l (low, low + sdim), h (high, high + sdim);
+  parent->setGreaterTree (randomSubTree (*proto, l, h, nleaves, depth, nalphas));
+  BspTree::deleteBspTree (proto);
+  return frame;
+}
+
+PiecewiseLinearValueFunction* randomPWL (const int &sdim, const int &nleaves, const int &depth,
+					 const int &nalphas, double *low, double *high)
+{
+  return randomTree (new PiecewiseLinearValueFunction (sdim, low, high), low, high,
+		     nleaves, depth, nalphas);
+}
+
+PiecewiseConstantValueFunction* randomPWC (const int &sdim, const int &nleaves, const int &depth,
+					   const int &nvalues, double *low, double *high)
+{
+  return randomTree (new PiecewiseConstantValueFunction (sdim, low, high, 0.0), low, high,
+		     nleaves, depth, nvalues);
+}
+
+double sumLeafValues (BspTreeAlpha *bt)
+{
+  if (bt->isLeaf ())
+    return bt->getAlphaVectors () ? bt->getAlphaVectorNth (0)->getAlphaNth (0) : 0.0;
+  return sumLeafValues (static_cast<BspTreeAlpha*> (bt->getLowerTree ()))
+    + sumLeafValues (static_cast<BspTreeAlpha*> (bt->getGreaterTree ()));
+}
+
+/* state distribution, with random probabilities that sum to one. */
+ContinuousStateDistribution* randomCSD (const int &sdim, const int &nleaves, const int &depth,
+					double *low, double *high)
+{
+  PiecewiseConstantValueFunction *pwc = randomPWC (sdim, nleaves, depth, 10, low, high);
+  pwc->multiplyByScalar (1.0 / sumLeafValues (pwc));
+  ContinuousStateDistribution *csd = new ContinuousStateDistribution (*pwc);
+  BspTree::deleteBspTree (pwc);
+  return csd;
+}
+
+/* continuous transition over n slabs of the domain along the first dimension, with
+   a gaussian relative consumption on every tile and dimension. */
+ContinuousTransition* randomCT (const int &sdim, const int &n, double *low, double *high)
+{
+  vector<vector<double> > lowPos (n, vector<double> (low, low + sdim)), highPos (n, vector<double> (high, high + sdim));
+  vector<double*> lowPosP, highPosP;
+  vector<vector<double> > epsilon (n, vector<double> (sdim, 0.001)), intervals (n, vector<double> (sdim, 1.0)),
+    means (n, vector<double> (sdim)), sds (n, vector<double> (sdim, 0.01));
+  vector<const double*> epsilonP, intervalsP, meansP, sdsP;
+  bool **relative = new bool*[n];
+  const discreteDistributionType **distrib = new const discreteDistributionType*[n];
+  for (int t=0; t<n; t++)
+    {
+      lowPos[t][0] = low[0] + t * (high[0] - low[0]) / n;
+      highPos[t][0] = low[0] + (t + 1) * (high[0] - low[0]) / n;
+      lowPosP.push_back (&lowPos[t][0]); highPosP.push_back (&highPos[t][0]);
+      for (int i=0; i<sdim; i++)
+	means[t][i] = -0.1 * rand () / (double) RAND_MAX;
+      epsilonP.push_back (&epsilon[t][0]); intervalsP.push_back (&intervals[t][0]);
+      meansP.push_back (&means[t][0]); sdsP.push_back (&sds[t][0]);
+      relative[t] = new bool[sdim];
+      discreteDistributionType *dt = new discreteDistributionType[sdim];
+      for (int i=0; i<sdim; i++)
+	{
+	  relative[t][i] = true;
+	  dt[i] = GAUSSIAN;
+	}
+      distrib[t] = dt;
+    }
+  ContinuousTransition *ct
+    = new ContinuousTransition (n, sdim, DISCRETIZATION_WRT_INTERVAL,
+				&lowPosP[0], &highPosP[0], low, high,
+				&epsilonP[0], &intervalsP[0], &meansP[0], &sdsP[0],
+				relative, distrib);
+  for (int t=0; t<n; t++)
+    {
+      delete []relative[t];
+      delete []distrib[t];
+    }
+  delete []relative;
+  delete []distrib;
+  return ct;
+}
+
+/**
+ * \brief accumulates the time and the pooled allocations (tree nodes and alpha vectors)
+ *        of the timed sections of a kernel.
+ */
+class BenchTimer
+{
+ public:
+  BenchTimer () : m_ms (0.0), m_allocs (0), m_bytes (0), m_output (0) {}
+
+  void start ()
+  {
+    m_allocs0 = Metrics::getAllocations ();
+    m_bytes0 = Metrics::getAllocatedBytes ();
+    m_start = chrono::steady_clock::now ();
+  }
+
+  void stop ()
+  {
+    m_ms += chrono::duration<double, milli> (chrono::steady_clock::now () - m_start).count ();
+    m_allocs += Metrics::getAllocations () - m_allocs0;
+    m_bytes += Metrics::getAllocatedBytes () - m_bytes0;
+  }
+
+  double m_ms;
+  long long m_allocs, m_bytes;
+  long m_output;  /* size of the kernel output (leaves or points). */
+
+ private:
+  chrono::steady_clock::time_point m_start;
+  long long m_allocs0, m_bytes0;
+};
+
+static const char *s_filter = NULL;
+
+/* runs a kernel, that times its own core with the timer it is given, and reports
+   the time and allocations per run, and the throughput in runs and input leaves. */
+void bench (const string &name, const int &runs, const long &input,
+	    const function<void (BenchTimer&)> &kernel)
+{
+  if (s_filter && name.find (s_filter) == string::npos)
+    return;
+  BenchTimer timer;
+  for (int r=0; r<runs; r++)
+    kernel (timer);
+  double ms = timer.m_ms / runs;
+  cout << left << setw (18) << name << right
+       << setw (10) << input << setw (10) << timer.m_output
+       << setw (12) << fixed << setprecision (4) << ms
+       << setw (12) << setprecision (1) << (ms > 0.0 ? 1000.0 / ms : 0.0)
+       << setw (14) << setprecision (0) << (ms > 0.0 ? input * 1000.0 / ms : 0.0)
+       << setw (12) << timer.m_allocs / runs
+       << setw (12) << setprecision (1) << timer.m_bytes / (1024.0 * runs) << endl;
+}
+
+void benchIntersection (const string &name, const BspTreeIntersectionType &btit,
+			BspTree *bt1, BspTree *bt2, const int &runs, const long &input,
+			double *low, double *high, const bool &bounds=false)
+{
+  bench (name, runs, input, [&] (BenchTimer &t)
+	 {
+	   BspOpContext ctx (btit);
+	   ctx.m_asymetricOperators = bounds;
+	   t.start ();
+	   BspTree *res = BspTreeOperations::intersectTrees (ctx, bt1, bt2, low, high);
+	   t.stop ();
+	   t.m_output = res->countLeaves ();
+	   BspTree::deleteBspTree (res);
+	 });
+}
+
+int main (int argc, char *argv[])
+{
+  int sdim = argc > 1 ? atoi (argv[1]) : 2;
+  int nleaves = argc > 2 ? atoi (argv[2]) : 256;
+  int depth = argc > 3 ? atoi (argv[3]) : 16;
+  int nalphas = argc > 4 ? atoi (argv[4]) : 2;
+  int runs = argc > 5 ? atoi (argv[5]) : 10;
+  int ctTiles = argc > 6 ? atoi (argv[6]) : 4;
+  s_filter = argc > 7 ? argv[7] : NULL;
+  srand (1);
+
+  /* tree operations options, as used by the solver. */
+  BspTreeOperations::m_piecesMerging = true;
+  BspTreeOperations::m_piecesMergingByValue = false;
+  BspTreeOperations::m_piecesMergingByAction = false;
+  BspTreeOperations::m_piecesMergingEquality = true;
+  BspTreeOperations::m_bspBalance = false;
+
+  /* domain */
+  vector<double> lowv (sdim, 0.0), highv (sdim, 1.0);
+  double *low = &lowv[0], *high = &highv[0];
+
+  /* random inputs */
+  PiecewiseLinearValueFunction *pwl1 = randomPWL (sdim, nleaves, depth, nalphas, low, high);
+  PiecewiseLinearValueFunction *pwl2 = randomPWL (sdim, nleaves, depth, nalphas, low, high);
+  PiecewiseLinearValueFunction *pwl0 = randomPWL (sdim, nleaves, depth, 0, low, high);  /* no values. */
+  PiecewiseConstantValueFunction *pwc1 = randomPWC (sdim, nleaves, depth, 2, low, high);
+  ContinuousStateDistribution *csd1 = randomCSD (sdim, nleaves, depth, low, high);
+  ContinuousStateDistribution *csd2 = randomCSD (sdim, nleaves, depth, low, high);
+  ContinuousTransition *ct = randomCT (sdim, ctTiles, low, high);
+  long input = pwl1->countLeaves ();
+
+  cout << "dim: " << sdim << " -- leaves: " << input << " -- depth: " << depth
+       << " -- alpha vectors per leaf: " << nalphas << " -- transition tiles: " << ctTiles
+       << " -- runs: " << runs << endl;
+  cout << left << setw (18) << "kernel" << right << setw (10) << "in" << setw (10) << "out"
+       << setw (12) << "ms/run" << setw (12) << "runs/s" << setw (14) << "in leaves/s"
+       << setw (12) << "allocs/run" << setw (12) << "KB/run" << endl;
+
+  Metrics::enable (true);
+
+  /* intersections (min and union have no leaf operations). */
+  benchIntersection ("intersect-init", BTI_INIT, pwl1, pwl0, runs, input, low, high);
+  benchIntersection ("intersect-max", BTI_MAX, pwl1, pwl2, runs, input, low, high);
+
+  /* max against a lower tree, without and with branch and bound on the value bounds. */
+  PiecewiseLinearValueFunction *pwl3
+    = static_cast<PiecewiseLinearValueFunction*> (BspTreeOperations::copyTree (pwl2));
+  pwl3->multiplyByScalar (0.1);
+  benchIntersection ("max-dominated", BTI_MAX, pwl1, pwl3, runs, input, low, high);
+  pwl1->updateSubTreeBounds (low, high);
+  pwl3->updateSubTreeBounds (low, high);
+  benchIntersection ("max-dominated-bb", BTI_MAX, pwl1, pwl3, runs, input, low, high, true);
+  BspTree::deleteBspTree (pwl3);
+  benchIntersection ("intersect-plus", BTI_PLUS, pwl1, pwl2, runs, input, low, high);
+  benchIntersection ("intersect-minus", BTI_MINUS, pwl1, pwl2, runs, input, low, high);
+  benchIntersection ("intersect-mult", BTI_MULT, pwl1, csd1, runs, input, low, high);
+  benchIntersection ("intersect-csddiff", BTI_CSD_DIFF, csd1, csd2, runs, csd1->countLeaves (), low, high);
+
+  /* crop to the center of the domain, shift by a tenth of the domain. */
+  vector<double> cropLow (sdim, 0.25), cropHigh (sdim, 0.75), shift (sdim, 0.1);
+  bench ("crop", runs, input, [&] (BenchTimer &t)
+	 {
+	   BspOpContext ctx;
+	   t.start ();
+	   BspTree *res = BspTreeOperations::cropTree (ctx, pwl1, &cropLow[0], &cropHigh[0]);
+	   t.stop ();
+	   t.m_output = res->countLeaves ();
+	   BspTree::deleteBspTree (res);
+	 });
+  bench ("shift", runs, input, [&] (BenchTimer &t)
+	 {
+	   BspOpContext ctx;
+	   BspTree *bt = BspTreeOperations::copyTree (pwl1);  /* shifted in place. */
+	   t.start ();
+	   BspTree *res = BspTreeOperations::shiftTree (ctx, bt, &shift[0], low, high);
+	   t.stop ();
+	   t.m_output = res->countLeaves ();
+	   BspTree::deleteBspTree (res);
+	 });
+
+  /* backup and front-up through the random transition. */
+  bench ("backup-ct2", runs, input, [&] (BenchTimer &t)
+	 {
+	   BspOpContext ctx;
+	   t.start ();
+	   ValueFunction *res = BackupOperations::backUpCT2 (ctx, pwl1, ct, low, high);
+	   t.stop ();
+	   t.m_output = res->countLeaves ();
+	   BspTree::deleteBspTree (res);
+	 });
+  bench ("frontup", runs, csd1->countLeaves (), [&] (BenchTimer &t)
+	 {
+	   t.start ();
+	   ContinuousStateDistribution *res = ContinuousStateDistribution::frontUp (csd1, ct, low, high, 1.0);
+	   t.stop ();
+	   t.m_output = res->countLeaves ();
+	   BspTree::deleteBspTree (res);
+	 });
+
+  /* expected value of a pwl value function under the random distribution. */
+  bench ("expectation", runs, input, [&] (BenchTimer &t)
+	 {
+	   t.start ();
+	   double e = pwl1->computeExpectation (csd1, low, high);
+	   t.stop ();
+	   t.m_output = (e == e) ? 1 : 0;  /* a single value. */
+	 });
+
+#ifdef HAVE_LP
+  /* pruning of sets of 4*alphas random linear functions over the domain, one set per leaf. */
+  vector<vector<vector<double> > > lf (nleaves, vector<vector<double> > (4 * nalphas, vector<double> (sdim + 1)));
+  for (int i=0; i<nleaves; i++)
+    for (size_t j=0; j<lf[i].size (); j++)
+      for (int k=0; k<=sdim; k++)
+	lf[i][j][k] = rand () / (double) RAND_MAX;
+  bench ("prune-lp", runs, nleaves, [&] (BenchTimer &t)
+	 {
+	   t.m_output = 0;
+	   for (int i=0; i<nleaves; i++)
+	     {
+	       vector<AlphaVector*> vav;
+	       for (size_t j=0; j<lf[i].size (); j++)
+		 vav.push_back (new AlphaVector (sdim + 1, &lf[i][j][0]));
+	       vector<AlphaVector*> res;
+	       t.start ();
+	       LpSolve5::pruneLP (&vav, low, high, &res);
+	       t.stop ();
+	       t.m_output += res.size ();
+	       for (size_t j=0; j<res.size (); j++)
+		 delete res[j];
+	       for (size_t j=0; j<vav.size (); j++)  /* vectors left over by the pruning, if any. */
+		 delete vav[j];
+	     }
+	 });
+#endif
+
+  /* convolution of two joint gaussian distributions, of about sqrt(leaves) points each
+     (the convolution is quadratic in the number of points). */
+  int nbins = max (2, static_cast<int> (pow (nleaves, 0.5 / sdim) + 0.5));
+  vector<NormalDiscreteDistribution*> ndds;
+  vector<DiscreteDistribution*> dds1, dds2;
+  for (int i=0; i<2*sdim; i++)
+    {
+      ndds.push_back (new NormalDiscreteDistribution (0.3 + 0.2 * (i % 2), 0.01, 0.001, 0.1 / nbins,
+						      DISCRETIZATION_WRT_THRESHOLD));
+      (i < sdim ? dds1 : dds2).push_back (ndds.back ());
+    }
+  MDDiscreteDistribution *mdd1 = MDDiscreteDistribution::jointDiscreteDistribution (sdim, &dds1[0]);
+  MDDiscreteDistribution *mdd2 = MDDiscreteDistribution::jointDiscreteDistribution (sdim, &dds2[0]);
+  vector<double> convLow (sdim, 0.0), convHigh (sdim, 2.0), low1 (sdim, 0.2), high1 (sdim, 0.7);
+  bench ("convolution", runs, mdd1->getNPoints (), [&] (BenchTimer &t)
+	 {
+	   t.start ();
+	   MDDiscreteDistribution *res
+	     = MDDiscreteDistribution::convoluteMDDiscreteDistributions (*mdd1, *mdd2, &convLow[0], &convHigh[0],
+									 &low1[0], &high1[0], &low1[0], &high1[0]);
+	   t.stop ();
+	   t.m_output = res->getNPoints ();
+	   delete res;
+	 });
+
+  /* merging of the leaves of a pwc value function with two distinct values. */
+  bench ("merge-leaves", runs, pwc1->countLeaves (), [&] (BenchTimer &t)
+	 {
+	   ValueFunction *vf = static_cast<ValueFunction*> (BspTreeOperations::copyTree (pwc1));
+	   t.start ();
+	   vf->mergeTreeLeaves (low, high);
+	   t.stop ();
+	   t.m_output = vf->countLeaves ();
+	   BspTree::deleteBspTree (vf);
+	 });
+
+  Metrics::enable (false);
+  delete mdd1; delete mdd2;
+  for (size_t i=0; i<ndds.size (); i++)
+    delete ndds[i];
+  BspTree::deleteBspTree (pwl1);
+  BspTree::deleteBspTree (pwl2);
+  BspTree::deleteBspTree (pwl0);
+  BspTree::deleteBspTree (pwc1);
+  BspTree::deleteBspTree (csd1);
+  BspTree::deleteBspTree (csd2);
+  BspTree::deleteBspTree (ct);
+}
@@ -0,0 +1,148 @@
+/**
+ * Copyright 2014 Emmanuel Benazera beniz@droidnik.fr
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FrozenValueFunction.h"
+#include "PiecewiseLinearValueFunction.h"
+#include "PiecewiseLinearReward.h"
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+
+using namespace std;
+using namespace hmdp_base;
+
+/* microbenchmark: point value and action lookups on a pwl value function,
+   one point at a time on the tree and on its frozen copy, and by batches. */
+
+void setLeavesActions (ValueFunction *vf, int *a)
+{
+  if (vf->isLeaf ())
+    {
+      if (vf->getAlphaVectors ())
+	for (unsigned int i=0; i<vf->getAlphaVectorsSize (); i++)
+	  vf->getAlphaVectorNth (i)->setAction ((*a)++);
+    }
+  else
+    {
+      setLeavesActions (static_cast<ValueFunction*> (vf->getLowerTree ()), a);
+      setLeavesActions (static_cast<ValueFunction*> (vf->getGreaterTree ()), a);
+    }
+}
+
+double elapsedMs (const chrono::steady_clock::time_point &start)
+{
+  return chrono::duration<double, milli> (chrono::steady_clock::now () - start).count ();
+}
+
+int main (int argc, char *argv[])
+{
+  int ntiles = argc > 1 ? atoi (argv[1]) : 16;  /* tiles per dimension. */
+  size_t npts = argc > 2 ? atoi (argv[2]) : 100000;
+  srand (1);
+
+  /* domain */
+  double low[2] = {0.0,0.0}, high[2] = {1.0,1.0};
+
+  /* grid of tiles, with two random linear functions per tile. */
+  int ntotal = ntiles * ntiles;
+  double **lowCorners = (double**) malloc (ntotal * sizeof (double*));
+  double **highCorners = (double**) malloc (ntotal * sizeof (double*));
+  int *linum = (int*) malloc (ntotal * sizeof (int));
+  double ***linear_values = (double***) malloc (ntotal * sizeof (double**));
+  for (int t=0; t<ntotal; t++)
+    {
+      lowCorners[t] = (double*) malloc (2 * sizeof (double));
+      highCorners[t] = (double*) malloc (2 * sizeof (double));
+      lowCorners[t][0] = (t / ntiles) / (double) ntiles;
+      lowCorners[t][1] = (t % ntiles) / (double) ntiles;
+      highCorners[t][0] = (t / ntiles + 1) / (double) ntiles;
+      highCorners[t][1] = (t % ntiles + 1) / (double) ntiles;
+      linum[t] = 2;
+      linear_values[t] = (double**) malloc (2 * sizeof (double*));
+      for (int j=0; j<2; j++)
+	{
+	  linear_values[t][j] = (double*) malloc (3 * sizeof (double));
+	  for (int k=0; k<3; k++)
+	    linear_values[t][j][k] = rand () / (double) RAND_MAX;
+	}
+    }
+  PiecewiseLinearReward *plr = new PiecewiseLinearReward (ntotal, 2, lowCorners, highCorners,
+							  low, high, linum, linear_values);
+  PiecewiseLinearValueFunction *plvf = new PiecewiseLinearValueFunction (*plr);
+  int a = 0;
+  setLeavesActions (plvf, &a);
+
+  /* random points, by dimension. */
+  double *xs = new double[npts], *ys = new double[npts];
+  for (size_t i=0; i<npts; i++)
+    {
+      xs[i] = rand () / (double) RAND_MAX;
+      ys[i] = rand () / (double) RAND_MAX;
+    }
+  const double *pos[2] = {xs, ys};
+  double *values = new double[npts], *fvalues = new double[npts], *bvalues = new double[npts];
+  int *actions = new int[npts], *factions = new int[npts], *bactions = new int[npts];
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now ();
+  double pt[2];
+  for (size_t i=0; i<npts; i++)
+    {
+      pt[0] = xs[i]; pt[1] = ys[i];
+      values[i] = plvf->getPointValue (pt);
+      actions[i] = plvf->getPointAction (pt);
+    }
+  double tree_ms = elapsedMs (start);
+
+  start = chrono::steady_clock::now ();
+  FrozenValueFunction fvf (*plvf);
+  double freeze_ms = elapsedMs (start);
+
+  start = chrono::steady_clock::now ();
+  for (size_t i=0; i<npts; i++)
+    {
+      pt[0] = xs[i]; pt[1] = ys[i];
+      fvalues[i] = fvf.getPointValue (pt);
+      factions[i] = fvf.getPointAction (pt);
+    }
+  double frozen_ms = elapsedMs (start);
+
+  start = chrono::steady_clock::now ();
+  fvf.getPointValues (pos, npts, bvalues, bactions);
+  double batch_ms = elapsedMs (start);
+
+  double maxdiff = 0.0;
+  size_t actdiff = 0;
+  for (size_t i=0; i<npts; i++)
+    {
+      maxdiff = max (maxdiff, max (fabs (values[i] - fvalues[i]), fabs (values[i] - bvalues[i])));
+      if (actions[i] != factions[i] || actions[i] != bactions[i])
+	actdiff++;
+    }
+
+  cout << "tree leaves: " << fvf.getNLeaves () << " -- points: " << npts << endl;
+  cout << "tree lookups: " << tree_ms << " ms\n";
+  cout << "freezing: " << freeze_ms << " ms\n";
+  cout << "frozen lookups: " << frozen_ms << " ms\n";
+  cout << "batched lookups: " << batch_ms << " ms\n";
+  cout << "max value difference: " << maxdiff << " -- action differences: " << actdiff << endl;
+
+  delete[] xs; delete[] ys;
+  delete[] values; delete[] fvalues; delete[] bvalues;
+  delete[] actions; delete[] factions; delete[] bactions;
+  BspTree::deleteBspTree (plr);
+  BspTree::deleteBspTree (plvf);
+}
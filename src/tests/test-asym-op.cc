@@ -55,7 +55,7 @@ int main ()
   PiecewiseConstantReward *cr1 = new PiecewiseConstantReward (4, 2, lowCornersCr1P, 
 							     highCornersCr1P,
 							     low, high, valuesCr1);
-  cr1->updateSubTreeMaxValue ();
+  cr1->updateSubTreeBounds (low, high);
   
   std::cout << "cr1:\n";
   cr1->print (std::cout, low, high);
@@ -71,7 +71,7 @@ int main ()
   PiecewiseConstantReward *cr2 = new PiecewiseConstantReward (1, 2, lowCornersCr2P, 
 							     highCornersCr2P,
 							     low, high, valuesCr2);
-  cr2->updateSubTreeMaxValue ();
+  cr2->updateSubTreeBounds (low, high);
 
   /* third reward. */
   double lowCornersCr3[2][2] = {{0.0,0.0}, {0.5, 0.0}};
@@ -84,7 +84,7 @@ int main ()
   PiecewiseConstantReward *cr3 = new PiecewiseConstantReward (2, 2, lowCornersCr3P, 
 							     highCornersCr3P,
 							     low, high, valuesCr3);
-  cr3->updateSubTreeMaxValue ();
+  cr3->updateSubTreeBounds (low, high);
   std::cout << "cr3:\n";
   cr3->print (std::cout, low, high);
 
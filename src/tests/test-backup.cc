@@ -144,4 +144,33 @@ int main ()
 
   std::cout << "bvf_merged:\n"; 
   bvf_merged->print (std::cout, low, high);
+
+  /* ----------------------------------------------------------------------------------- */
+  std::cout << "testing one-step pwc backup with concurrent outcomes...\n";
+  ThreadPool pool (4);
+  BspOpContext ctx;
+  ctx.m_pool = &pool;
+  ValueFunction *bvf_par = BackupOperations::backUp (ctx, vf, ct, cr, 0, low, high);
+  ValueFunction *bvf_diff = ValueFunctionOperations::subtractValueFunctions (bvf_merged, bvf_par,
+									     low, high);
+  double max_diff = 0.0;
+  bvf_diff->maxAbsValue (max_diff, low, high);
+  std::cout << "max difference between concurrent and sequential backups: "
+	    << max_diff << std::endl;
+
+  /* ----------------------------------------------------------------------------------- */
+  std::cout << "testing discounted pwc backup with a lazy discount...\n";
+  double gamma = 0.9;
+  ValueFunction *dvf = static_cast<ValueFunction*> (BspTreeOperations::copyTree (bvf_merged));
+  dvf->multiplyByScalar (gamma);
+  ValueFunction *bvf_eager = BackupOperations::backUp (dvf, ct, cr, 0, low, high);
+  ValueFunction *bvf_lazy = BackupOperations::backUp (BspOpContext (), bvf_merged, ct, cr, 0,
+						      low, high, gamma);
+  bvf_lazy->multiplyByScalar (gamma);
+  ValueFunction *bvf_ldiff = ValueFunctionOperations::subtractValueFunctions (bvf_eager, bvf_lazy,
+									      low, high);
+  double max_ldiff = 0.0;
+  bvf_ldiff->maxAbsValue (max_ldiff, low, high);
+  std::cout << "max difference between lazy and eager discounts: "
+	    << max_ldiff << std::endl;
 }
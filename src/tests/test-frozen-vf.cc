@@ -0,0 +1,165 @@
+/**
+ * Copyright 2014 Emmanuel Benazera beniz@droidnik.fr
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FrozenValueFunction.h"
+#include "PiecewiseConstantValueFunction.h"
+#include "PiecewiseLinearValueFunction.h"
+#include "PiecewiseConstantReward.h"
+#include "PiecewiseLinearReward.h"
+#include "ValueFunctionOperations.h"
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+
+using namespace std;
+using namespace hmdp_base;
+
+double** createPtrFrom2DArray (double ar[][2])
+{
+  double **res = (double**) malloc (4 * sizeof (double*));
+  for (int i=0; i<4; i++)
+    {
+      res[i] = (double*) malloc (2 * sizeof (double));
+      for (int j=0; j<2; j++)
+	res[i][j] = ar[i][j];
+    }
+  return res;
+}
+
+void setLeavesActions (ValueFunction *vf, int *a)
+{
+  if (vf->isLeaf ())
+    {
+      if (vf->getAlphaVectors ())
+	for (unsigned int i=0; i<vf->getAlphaVectorsSize (); i++)
+	  vf->getAlphaVectorNth (i)->setAction ((*a)++);
+    }
+  else
+    {
+      setLeavesActions (static_cast<ValueFunction*> (vf->getLowerTree ()), a);
+      setLeavesActions (static_cast<ValueFunction*> (vf->getGreaterTree ()), a);
+    }
+}
+
+void compareFrozen (ValueFunction *vf, ContinuousStateDistribution *csd,
+		    double *low, double *high, const bool &treeExpectation)
+{
+  FrozenValueFunction fvf (*vf);
+  cout << "nodes: " << fvf.getNNodes () << " -- leaves: " << fvf.getNLeaves () << endl;
+
+  double maxdiff = 0.0, maxbdiff = 0.0;
+  int actdiff = 0, bactdiff = 0;
+  double pos[2], xs[441], ys[441], bvalues[441];
+  int bactions[441];
+  const double *bpos[2] = {xs, ys};
+  for (int i=0; i<=20; i++)
+    for (int j=0; j<=20; j++)
+      {
+	xs[i*21+j] = low[0] + i * (high[0] - low[0]) / 20.0;
+	ys[i*21+j] = low[1] + j * (high[1] - low[1]) / 20.0;
+      }
+  fvf.getPointValues (bpos, 441, bvalues, bactions);
+  for (int k=0; k<441; k++)
+    {
+      pos[0] = xs[k]; pos[1] = ys[k];
+      double val = vf->getPointValue (pos);
+      int act = vf->getPointAction (pos);
+      maxdiff = max (maxdiff, fabs (val - fvf.getPointValue (pos)));
+      if (act != fvf.getPointAction (pos))
+	actdiff++;
+      maxbdiff = max (maxbdiff, fabs (val - bvalues[k]));
+      if (act != bactions[k])
+	bactdiff++;
+    }
+  cout << "max point value difference: " << maxdiff << endl;
+  cout << "point action differences: " << actdiff << endl;
+  cout << "max batched point value difference: " << maxbdiff << endl;
+  cout << "batched point action differences: " << bactdiff << endl;
+
+  double fexpect = fvf.computeExpectation (*csd, low, high);
+  if (! treeExpectation)
+    {
+      cout << "frozen expectation: " << fexpect << endl;
+      return;
+    }
+  double expect = vf->computeExpectation (csd, low, high);
+  cout << "expectation: " << expect << " -- frozen expectation: " << fexpect << endl;
+  cout << "expectation difference below 1e-9: " << (fabs (expect - fexpect) < 1e-9) << endl;
+}
+
+int main ()
+{
+  /* domain */
+  double low[2] = {0.0,0.0}, high[2] = {1.0,1.0};
+
+  /* tiles */
+  double lowCorners[4][2] = {{0.0,0.8},{0.0,0.0},{0.4,0.8},{0.4,0.0}};
+  double highCorners[4][2] = {{0.4,1.0},{0.4,0.8},{1.0,1.0},{1.0,0.8}};
+  double values[4] = {3.0, 5.0, 6.0, 10.0};
+
+  double **lowCornersP = createPtrFrom2DArray (lowCorners);
+  double **highCornersP = createPtrFrom2DArray (highCorners);
+
+  /* distribution, with a positive probability over the whole domain. */
+  PiecewiseConstantValueFunction *pvf = new PiecewiseConstantValueFunction (2, low, high, 0.2);
+  double lowd[2] = {0.5,0.3}, highd[2] = {1.0,1.0};
+  PiecewiseConstantValueFunction *pvfd = new PiecewiseConstantValueFunction (2, lowd, highd, 0.5);
+  ValueFunction *pvfs = ValueFunctionOperations::sumValueFunctions (pvf, pvfd, low, high);
+  ContinuousStateDistribution *csd = new ContinuousStateDistribution (*pvfs);
+
+  /* ------------------------------------------------------------------------------------- */
+  std::cout << "testing frozen pwc value function...\n";
+  PiecewiseConstantReward *pcr = new PiecewiseConstantReward (4, 2, lowCornersP, highCornersP,
+							      low, high, values);
+  PiecewiseConstantValueFunction *pcvf = new PiecewiseConstantValueFunction (*pcr);
+  int a = 0;
+  setLeavesActions (pcvf, &a);
+  compareFrozen (pcvf, csd, low, high, true);
+
+  /* ------------------------------------------------------------------------------------- */
+  std::cout << "testing frozen pwl value function...\n";
+  int linum[4] = {1,1,1,2};
+  double linear_values[4][2][3] = {{{2,3,-2},{0.0,0.0,0.0}},{{1,1,1},{0.0,0.0,0.0}},{{0.4,0.2,-0.09},{0.0,0.0,0.0}},{{0.1,0.6,0.03},{0.7,0.8,-0.2}}};
+  double ***linear_valuesP = (double ***) malloc (4 * sizeof (double **));
+  for (int i=0; i<4; i++)
+    {
+      linear_valuesP[i] = (double **) malloc (linum[i] * sizeof (double *));
+      for (int j=0; j<linum[i]; j++)
+	{
+	  linear_valuesP[i][j] = (double *) malloc (3 * sizeof (double));
+	  for (int k=0; k<3; k++)
+	    linear_valuesP[i][j][k] = linear_values[i][j][k];
+	}
+    }
+  PiecewiseLinearReward *plr = new PiecewiseLinearReward (4, 2, lowCornersP, highCornersP,
+							  low, high, linum, linear_valuesP);
+  PiecewiseLinearValueFunction *plvf = new PiecewiseLinearValueFunction (*plr);
+  a = 0;
+  setLeavesActions (plvf, &a);
+  /* the tree expectation of pwl value functions requires alpha vectors in
+     every leaf of the intersection, which the distribution's out-of-domain
+     leaves don't provide. */
+  compareFrozen (plvf, csd, low, high, false);
+
+  BspTree::deleteBspTree (pcr);
+  BspTree::deleteBspTree (pcvf);
+  BspTree::deleteBspTree (plr);
+  BspTree::deleteBspTree (plvf);
+  BspTree::deleteBspTree (csd);
+  BspTree::deleteBspTree (pvf);
+  BspTree::deleteBspTree (pvfd);
+  BspTree::deleteBspTree (pvfs);
+}
@@ -19,6 +19,8 @@
 #include "PiecewiseConstantReward.h"
 #include "ContinuousTransition.h"
 #include "BackupOperations.h"
+#include "ValueFunctionOperations.h"
+#include "BspTreeStore.h"
 #include <iostream>
 #include <fstream>
 #include <cstdlib>
@@ -167,6 +169,59 @@ int main ()
   output_pwc_vf.close ();
   output_pwc_vf_shift.close ();
 
+  /* ------------------------------------------------------------------------------------- */
+  std::cout << "testing hash-consing of value functions...\n";
+  BspTreeStore::enable (true);
+  ValueFunction *hvf1 = static_cast<ValueFunction*> (BspTreeStore::intern (BspTreeOperations::copyTree (pcvf3)));
+  ValueFunction *hvf2 = static_cast<ValueFunction*> (BspTreeStore::intern (BspTreeOperations::copyTree (pcvf3)));
+  ValueFunction *hvf3 = static_cast<ValueFunction*> (BspTreeOperations::shareTree (hvf1));
+  std::cout << "identical value functions are shared: " << (hvf1 == hvf2 && hvf2 == hvf3) << std::endl;
+  std::cout << "shared nodes: " << BspTreeStore::getNNodes () << " -- value function nodes: "
+	    << 2 * pcvf3->countLeaves () - 1 << std::endl;
+  std::cout << "shared value function equals the original: "
+	    << ValueFunctionOperations::identicalValueFunctions (hvf1, pcvf3) << std::endl;
+  BspTree::deleteBspTree (hvf1);
+  BspTree::deleteBspTree (hvf2);
+  BspTree::deleteBspTree (hvf3);
+  std::cout << "shared nodes once released: " << BspTreeStore::getNNodes () << std::endl;
+  BspTreeStore::enable (false);
+
+  /* ------------------------------------------------------------------------------------- */
+  std::cout << "testing residual of value functions...\n";
+  BspOpContext ctx;
+  ValueFunction *rvf = ValueFunctionOperations::subtractValueFunctions (ctx, pcvf1, pcvf3, low, high);
+  double residual = 0.0;
+  rvf->maxAbsValue (residual, low, high);
+  BspTree::deleteBspTree (rvf);
+  std::cout << "residual from subtraction: " << residual << " -- sup-norm difference: "
+	    << ValueFunctionOperations::supNormDifference (ctx, pcvf1, pcvf3, low, high) << std::endl;
+  std::cout << "sup-norm difference with early exit above 1: "
+	    << (ValueFunctionOperations::supNormDifference (ctx, pcvf1, pcvf3, low, high, 1.0) > 1.0)
+	    << " -- of identical value functions: "
+	    << ValueFunctionOperations::supNormDifference (ctx, pcvf3, pcvf3, low, high) << std::endl;
+
+  /* ------------------------------------------------------------------------------------- */
+  std::cout << "testing masking of value functions...\n";
+  ContinuousStateDistribution *mcsd = new ContinuousStateDistribution (2, 0, 0.5);
+  ContinuousStateDistribution *mcsdlt = new ContinuousStateDistribution (2);
+  ContinuousStateDistribution *mcsdge = new ContinuousStateDistribution (2);
+  mcsdlt->setProbability (0.0);
+  mcsdge->setProbability (1.0);
+  mcsd->setLowerTree (mcsdlt);
+  mcsd->setGreaterTree (mcsdge);
+  ValueFunction *mvf = ValueFunctionOperations::maskValueFunction (ctx, pcvf3, mcsd, low, high);
+  double mlow[2] = {0.5,0.0};
+  std::cout << "leaves: " << pcvf3->countLeaves () << " -- masked: " << mvf->countLeaves ()
+	    << " -- sup-norm difference where there is mass: "
+	    << ValueFunctionOperations::supNormDifference (ctx, pcvf3, mvf, mlow, high) << std::endl;
+  mcsdge->setProbability (0.0);
+  ValueFunction *mvf0 = ValueFunctionOperations::maskValueFunction (ctx, pcvf3, mcsd, low, high);
+  std::cout << "masked without mass: " << mvf0->countLeaves () << " leaf, with alpha vectors: "
+	    << (mvf0->getAlphaVectors () != 0) << std::endl;
+  BspTree::deleteBspTree (mvf);
+  BspTree::deleteBspTree (mvf0);
+  BspTree::deleteBspTree (mcsd);
+
   BspTree::deleteBspTree (ct);
   BspTree::deleteBspTree (pcr); 
   BspTree::deleteBspTree (pcvf1); 